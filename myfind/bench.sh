@@ -0,0 +1,156 @@
+#!/bin/sh
+#
+# @file bench.sh
+# Benchmark of myfind against GNU find.
+#
+# Generates a synthetic tree with gentree (once, kept for the next runs) and times
+# representative queries with myfind and with find, warm cache and cold cache:
+#
+#     make bench
+#     BENCH_RUNS=10 BENCH_MYFIND_ARGS="-j 4" GENTREE_ARGS="-d 5 -f 8" make bench
+#
+# Environment:
+#     BENCH_DIR          the tree, default /tmp/myfind-bench
+#     GENTREE_ARGS       shape of the tree, see gentree.c
+#     BENCH_RUNS         warm runs per query, the fastest counts (default 5)
+#     BENCH_MYFIND_ARGS  extra options for myfind, e.g. "-j 4" or "--io-uring"
+#     FIND               the baseline, default find
+#
+# The cold cache runs drop the page, dentry and inode caches and need root; without root
+# they are skipped. The system calls are counted with strace if it is installed.
+#
+# @author agent <agent@local>
+# @date 2026/10/17
+
+BENCH_DIR=${BENCH_DIR:-/tmp/myfind-bench}
+BENCH_RUNS=${BENCH_RUNS:-5}
+BENCH_MYFIND_ARGS=${BENCH_MYFIND_ARGS:-}
+FIND=${FIND:-find}
+MYFIND=${MYFIND:-./myfind}
+GENTREE=${GENTREE:-./gentree}
+if [ -z "${GENTREE_ARGS+set}" ]; then
+    GENTREE_ARGS="-d 4 -f 6 -n 40 -e zipf -l 5"
+    if [ 0 -eq "$(id -u)" ]; then
+        # a mix of owners, so -user has something to filter
+        GENTREE_ARGS="$GENTREE_ARGS -u 0,1,65534"
+    fi
+fi
+
+# the option variables are split into words, patterns in them must not be expanded
+set -f
+
+TRACE_FILE=$(mktemp) || exit 1
+trap 'rm -f "$TRACE_FILE"' EXIT
+
+# ---------------------------------------------------------------- functions --
+
+# now_ns: monotonic enough wall clock in nanoseconds
+now_ns()
+{
+    date +%s%N
+}
+
+# drop_caches: empties the page, dentry and inode caches, fails without root
+drop_caches()
+{
+    sync && echo 3 2>/dev/null > /proc/sys/vm/drop_caches
+}
+
+# run_query TOOL QUERY...: one run with the output thrown away, prints the seconds
+run_query()
+{
+    tool=$1
+    shift
+    start=$(now_ns)
+    if [ "$tool" = myfind ]; then
+        # shellcheck disable=SC2086
+        "$MYFIND" "$BENCH_DIR" "$@" $BENCH_MYFIND_ARGS > /dev/null
+    else
+        "$FIND" "$BENCH_DIR" "$@" > /dev/null
+    fi
+    end=$(now_ns)
+    awk -v ns=$((end - start)) 'BEGIN { printf "%.4f\n", ns / 1e9 }'
+}
+
+# count_syscalls TOOL QUERY...: system calls of one run, - without strace
+count_syscalls()
+{
+    tool=$1
+    shift
+    if ! command -v strace > /dev/null 2>&1; then
+        echo -
+        return
+    fi
+    if [ "$tool" = myfind ]; then
+        # shellcheck disable=SC2086
+        strace -f -qq -o "$TRACE_FILE" "$MYFIND" "$BENCH_DIR" "$@" $BENCH_MYFIND_ARGS > /dev/null
+    else
+        strace -f -qq -o "$TRACE_FILE" "$FIND" "$BENCH_DIR" "$@" > /dev/null
+    fi
+    # a call interrupted by another thread shows up twice, unfinished and resumed
+    grep -vc 'resumed>' "$TRACE_FILE"
+}
+
+# bench_query QUERY...: the lines of the table for one query, both tools
+bench_query()
+{
+    for tool in myfind find; do
+        calls=$(count_syscalls $tool "$@")
+
+        if [ "$COLD" = yes ]; then
+            drop_caches
+            report "$*" $tool cold "$(run_query $tool "$@")" "$calls"
+        fi
+
+        run_query $tool "$@" > /dev/null
+        best=
+        run=0
+        while [ $run -lt "$BENCH_RUNS" ]; do
+            seconds=$(run_query $tool "$@")
+            best=$(awk -v a="$seconds" -v b="${best:-$seconds}" 'BEGIN { print (a < b) ? a : b }')
+            run=$((run + 1))
+        done
+        report "$*" $tool warm "$best" "$calls"
+    done
+}
+
+# report QUERY TOOL CACHE SECONDS SYSCALLS: one line of the table
+report()
+{
+    awk -v query="$1" -v tool="$2" -v cache="$3" -v seconds="$4" -v calls="$5" \
+            -v entries="$ENTRIES" 'BEGIN {
+        rate = (seconds > 0) ? entries / seconds : 0
+        printf "%-20s %-7s %-5s %10.4f %12.0f %10s\n", query, tool, cache, seconds, rate, calls
+    }'
+}
+
+# ------------------------------------------------------------------- main --
+
+if [ ! -x "$MYFIND" ] || [ ! -x "$GENTREE" ]; then
+    echo "$0: build first: make myfind gentree" >&2
+    exit 1
+fi
+
+# the tree is generated again only if its shape changed
+if [ ! -d "$BENCH_DIR" ] || [ "$(cat "$BENCH_DIR.args" 2>/dev/null)" != "$GENTREE_ARGS" ]; then
+    rm -rf "$BENCH_DIR" "$BENCH_DIR.args"
+    # shellcheck disable=SC2086
+    "$GENTREE" $GENTREE_ARGS "$BENCH_DIR" || exit 1
+    echo "$GENTREE_ARGS" > "$BENCH_DIR.args"
+fi
+ENTRIES=$("$FIND" "$BENCH_DIR" | wc -l)
+
+COLD=yes
+if ! drop_caches; then
+    echo "$0: cannot drop the caches (needs root), cold cache runs are skipped" >&2
+    COLD=no
+fi
+
+echo "tree $BENCH_DIR: $ENTRIES entries (gentree $GENTREE_ARGS)"
+echo "myfind options: ${BENCH_MYFIND_ARGS:-none}, warm: fastest of $BENCH_RUNS runs"
+printf "%-20s %-7s %-5s %10s %12s %10s\n" query tool cache seconds files/s syscalls
+
+bench_query -name '*.c'
+bench_query -type f
+bench_query -user "$(id -un)"
+bench_query -ls
@@ -0,0 +1,107 @@
+#!/bin/sh
+#
+# @file check.sh
+# Checks of the option combinations myfind refuses and of paths longer than PATH_MAX.
+#
+# The checks run ./myfind on scratch trees. A refused combination must fail without writing
+# anything to stdout, so that no action was carried out half way. In a tree deeper than
+# PATH_MAX the complete paths must be found and printed, without an error:
+#
+#     make check
+#
+# @author agent <agent@local>
+# @date 2026/10/17
+#
+
+MYFIND=${MYFIND:-./myfind}
+
+TREE=$(mktemp -d) || exit 1
+trap 'rm -rf "$TREE"' EXIT
+mkdir "$TREE/dir" && touch "$TREE/dir/file" || exit 1
+
+# 2 * 15 levels of 200 characters, about 6000 bytes; every half is created relative to the
+# first one, as the shell and the kernel refuse paths longer than PATH_MAX
+DEEP=$TREE/deep
+DEEP_HALF=$(printf '%0200d' 0)
+level=1
+while [ $level -lt 15 ]; do
+    DEEP_HALF=$DEEP_HALF/$(printf '%0200d' $level)
+    level=$((level + 1))
+done
+DEEP_LEAF=$DEEP/$DEEP_HALF/$DEEP_HALF/leaf.txt
+mkdir "$DEEP" || exit 1
+(
+    cd "$DEEP" && mkdir -p "$DEEP_HALF" && cd "$DEEP_HALF" && mkdir -p "$DEEP_HALF" \
+            && touch "$DEEP_HALF/leaf.txt"
+) || exit 1
+
+FAILED=0
+
+# ---------------------------------------------------------------- functions --
+
+# expect_failure ARGUMENTS...: myfind on the scratch tree must fail and print nothing
+expect_failure()
+{
+    if output=$("$MYFIND" "$TREE" "$@" 2>/dev/null); then
+        echo "FAIL: myfind TREE $*: succeeded"
+        FAILED=$((FAILED + 1))
+    elif [ -n "$output" ]; then
+        echo "FAIL: myfind TREE $*: printed $output"
+        FAILED=$((FAILED + 1))
+    else
+        echo "ok:   myfind TREE $*"
+    fi
+}
+
+# expect_path ARGUMENTS...: myfind on the deep tree must print exactly the path of the leaf
+expect_path()
+{
+    # the arguments may contain the long path as well
+    label=$(echo "$*" | cut -c 1-60)
+    if ! output=$("$MYFIND" "$DEEP" "$@" 2>&1); then
+        echo "FAIL: myfind DEEP $label: failed"
+        FAILED=$((FAILED + 1))
+    elif [ "$output" != "$DEEP_LEAF" ]; then
+        echo "FAIL: myfind DEEP $label: printed $(echo "$output" | cut -c 1-60)..."
+        FAILED=$((FAILED + 1))
+    else
+        echo "ok:   myfind DEEP $label"
+    fi
+}
+
+# ------------------------------------------------------------------- main --
+
+if [ ! -x "$MYFIND" ]; then
+    echo "$0: build first: make myfind" >&2
+    exit 1
+fi
+
+# --group-by prints the groups only, the actions would be dropped
+expect_failure --group-by type -exec echo X {} \;
+expect_failure --group-by type -execdir echo X {} \;
+expect_failure --group-by type -exec echo X {} +
+expect_failure --group-by user -ls
+expect_failure --group-by group -print
+expect_failure --group-by type -name file -o -print
+expect_failure --group-by type -prune
+
+# --group-by sums up the whole table, it cannot stop early
+expect_failure --group-by type -quit
+expect_failure --group-by type -name file -quit
+expect_failure --group-by type -limit 1
+
+# paths longer than PATH_MAX are printed and matched in full
+expect_path -name leaf.txt
+expect_path -path "$DEEP_LEAF"
+expect_path -j 4 -name leaf.txt
+expect_path --prefetch 4 -name leaf.txt
+
+# -execdir runs in the directory of the leaf, test only finds it there
+expect_path -name leaf.txt -execdir test -f {} \; -print
+expect_path -name leaf.txt -execdir test -f {} + -print
+
+if [ 0 -ne $FAILED ]; then
+    echo "$FAILED check(s) failed"
+    exit 1
+fi
+echo "all checks passed"
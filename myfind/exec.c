@@ -0,0 +1,539 @@
+/**
+ * @file exec.c
+ * \brief -exec and -execdir for myfind.
+ *
+ * The commands are started with posix_spawnp(), which uses vfork()/clone() and does not copy
+ * the address space of the traversal like fork() would.
+ *
+ * A "{} +" command collects the paths of the matches and runs once the next one would not fit
+ * into the argument space (ARG_MAX less the environment). Up to --exec-jobs such batches run
+ * at the same time while the traversal goes on; the workers share the pool. A ";" command is
+ * also a test, so the traversal waits for it.
+ *
+ * -execdir changes into the directory through the descriptor the traversal holds, so it works
+ * in directories whose path is longer than the kernel resolves. A batch keeps a duplicate of
+ * the descriptor, the traversal may have left the directory when the batch runs.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "exec.h"
+#include "stats.h"
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((2 == __GLIBC__) && (__GLIBC_MINOR__ >= 29)))
+/** posix_spawn() can change the directory of the child, by path and by descriptor. */
+#define HAVE_SPAWN_CHDIR 1
+#else
+#define HAVE_SPAWN_CHDIR 0
+#endif
+
+/** Argument space left to the command, like xargs does. */
+#define EXEC_HEADROOM 2048
+
+/** Argument space if ARG_MAX is unknown, the POSIX minimum. */
+#define EXEC_MIN_ARG_SPACE 4096
+
+/** Initial size of the paths of a batch. */
+#define EXEC_INITIAL_PATHS (16 * 1024)
+
+/** Placeholder for the path. */
+#define EXEC_PLACEHOLDER "{}"
+
+/** Prefix of the base name for -execdir, a name starting with "-" is no option then. */
+#define EXEC_DIR_PREFIX "./"
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+extern char** environ;
+
+/** Children of the batches running, oldest first. */
+static pid_t* sbatch_pids = NULL;
+
+/** Number of batches running. */
+static int srunning = 0;
+
+/** Number of batches which may run at the same time. */
+static int sjobs = 1;
+
+/** A batch exited with a status other than 0. */
+static int sfailed = 0;
+
+/** Bytes of a command line the paths and the arguments may take, 0 until computed. */
+static size_t sarg_space = 0;
+
+/** Guards the pool, the workers start batches concurrently. */
+static pthread_mutex_t spool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t get_arg_space(void);
+static size_t get_command_size(const ExecCommand* command);
+static int spawn(const char* const* argv, const char* dir, const int dir_fd, pid_t* pid);
+static void close_dir_fd(ExecBatch* batch);
+static char* replace_placeholder(const char* arg, const char* path);
+static void reap_batch(void);
+static int wait_child(const pid_t pid);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+void exec_init(const int jobs)
+{
+    sjobs = (jobs < 1) ? 1 : jobs;
+}
+
+int exec_run(const ExecCommand* command, const char* dir, const int dir_fd, const char* path,
+        int* status)
+{
+    char** argv = (char**) calloc(command->count + 1, sizeof(char*));
+    char* dir_path = NULL;
+    pid_t pid = 0;
+    int error = 0;
+    int i = 0;
+
+    *status = -1;
+    if (command->in_dir)
+    {
+        dir_path = (char*) malloc(strlen(EXEC_DIR_PREFIX) + strlen(path) + 1);
+        if (NULL != dir_path)
+        {
+            strcpy(dir_path, EXEC_DIR_PREFIX);
+            strcat(dir_path, path);
+            path = dir_path;
+        }
+    }
+    if ((NULL == argv) || (command->in_dir && (NULL == dir_path)))
+    {
+        free(argv);
+        free(dir_path);
+        return ENOMEM;
+    }
+    for (i = 0; (0 == error) && (i < command->count); ++i)
+    {
+        argv[i] = replace_placeholder(command->args[i], path);
+        error = (NULL == argv[i]) ? ENOMEM : 0;
+    }
+    if (0 == error)
+    {
+        error = spawn((const char* const*) argv, dir, dir_fd, &pid);
+    }
+    if (0 == error)
+    {
+        *status = wait_child(pid);
+    }
+
+    for (i = 0; i < command->count; ++i)
+    {
+        free(argv[i]);
+    }
+    free(argv);
+    free(dir_path);
+    return error;
+}
+
+int exec_batch_fits(const ExecCommand* command, const ExecBatch* batch, const char* dir,
+        const char* path)
+{
+    size_t size = get_command_size(command) + batch->length
+            + (batch->count + 1) * sizeof(char*) + strlen(EXEC_DIR_PREFIX) + strlen(path) + 1;
+
+    if (0 == batch->count)
+    {
+        /* a path which does not fit on its own still runs, and fails */
+        return 1;
+    }
+    if ((NULL != dir) && (0 != strcmp(dir, batch->dir)))
+    {
+        /* -execdir: every batch runs in one directory */
+        return 0;
+    }
+    return size <= get_arg_space();
+}
+
+int exec_batch_add(ExecBatch* batch, const char* dir, const int dir_fd, const char* path)
+{
+    const char* prefix = (NULL == dir) ? "" : EXEC_DIR_PREFIX;
+    size_t size = strlen(prefix) + strlen(path) + 1;
+
+    if (0 == batch->count)
+    {
+        batch->dir_fd = -1;
+    }
+    if ((0 == batch->count) && (NULL != dir))
+    {
+        free(batch->dir);
+        batch->dir = strdup(dir);
+        if (NULL == batch->dir)
+        {
+            return ENOMEM;
+        }
+        if (dir_fd >= 0)
+        {
+            /* without a descriptor left the batch changes into the directory by its path */
+            batch->dir_fd = fcntl(dir_fd, F_DUPFD_CLOEXEC, 0);
+            if (-1 != batch->dir_fd)
+            {
+                stats_open_fds(1);
+            }
+        }
+    }
+    if (batch->length + size > batch->capacity)
+    {
+        size_t capacity = (0 == batch->capacity) ? EXEC_INITIAL_PATHS : batch->capacity;
+        char* paths = NULL;
+
+        while (batch->length + size > capacity)
+        {
+            capacity *= 2;
+        }
+        paths = (char*) realloc(batch->paths, capacity);
+        if (NULL == paths)
+        {
+            return ENOMEM;
+        }
+        batch->paths = paths;
+        batch->capacity = capacity;
+    }
+
+    strcpy(batch->paths + batch->length, prefix);
+    strcat(batch->paths + batch->length, path);
+    batch->length += size;
+    ++batch->count;
+
+    return 0;
+}
+
+int exec_batch_run(const ExecCommand* command, ExecBatch* batch)
+{
+    const char** argv = NULL;
+    const char* path = batch->paths;
+    pid_t pid = 0;
+    size_t i = 0;
+    int error = 0;
+
+    if (0 == batch->count)
+    {
+        return 0;
+    }
+    argv = (const char**) malloc((command->count + batch->count + 1) * sizeof(char*));
+    if (NULL == argv)
+    {
+        return ENOMEM;
+    }
+    memcpy(argv, command->args, command->count * sizeof(char*));
+    for (i = 0; i < batch->count; ++i)
+    {
+        argv[command->count + i] = path;
+        path += strlen(path) + 1;
+    }
+    argv[command->count + batch->count] = NULL;
+
+    pthread_mutex_lock(&spool_lock);
+    if (NULL == sbatch_pids)
+    {
+        sbatch_pids = (pid_t*) malloc(sjobs * sizeof(pid_t));
+        error = (NULL == sbatch_pids) ? ENOMEM : 0;
+    }
+    while ((0 == error) && (srunning >= sjobs))
+    {
+        reap_batch();
+    }
+    if (0 == error)
+    {
+        error = spawn(argv, command->in_dir ? batch->dir : NULL, batch->dir_fd, &pid);
+    }
+    if (0 == error)
+    {
+        sbatch_pids[srunning++] = pid;
+    }
+    pthread_mutex_unlock(&spool_lock);
+
+    free(argv);
+    close_dir_fd(batch);
+    batch->length = 0;
+    batch->count = 0;
+    return error;
+}
+
+void exec_batch_free(ExecBatch* batch)
+{
+    if (0 != batch->count)
+    {
+        close_dir_fd(batch);
+    }
+    free(batch->paths);
+    free(batch->dir);
+    memset(batch, 0, sizeof(*batch));
+}
+
+int exec_wait(void)
+{
+    int failed = 0;
+
+    pthread_mutex_lock(&spool_lock);
+    while (srunning > 0)
+    {
+        reap_batch();
+    }
+    free(sbatch_pids);
+    sbatch_pids = NULL;
+    failed = sfailed;
+    pthread_mutex_unlock(&spool_lock);
+
+    return failed ? -1 : 0;
+}
+
+/**
+ *
+ * \brief Bytes of a command line the arguments may take.
+ *
+ * \return ARG_MAX less the environment and some headroom.
+ */
+static size_t get_arg_space(void)
+{
+    if (0 == sarg_space)
+    {
+        long arg_max = sysconf(_SC_ARG_MAX);
+        size_t environment = 0;
+        char** variable = environ;
+
+        for (; (NULL != variable) && (NULL != *variable); ++variable)
+        {
+            environment += strlen(*variable) + 1 + sizeof(char*);
+        }
+        if ((arg_max > 0) && ((size_t) arg_max > environment + EXEC_HEADROOM + EXEC_MIN_ARG_SPACE))
+        {
+            sarg_space = (size_t) arg_max - environment - EXEC_HEADROOM;
+        }
+        else
+        {
+            sarg_space = EXEC_MIN_ARG_SPACE;
+        }
+    }
+    return sarg_space;
+}
+
+/**
+ *
+ * \brief Bytes of a command line the fixed arguments of a command take.
+ *
+ * \param command the command.
+ *
+ * \return size of the strings and their pointers.
+ */
+static size_t get_command_size(const ExecCommand* command)
+{
+    size_t size = sizeof(char*);
+    int i = 0;
+
+    for (i = 0; i < command->count; ++i)
+    {
+        size += strlen(command->args[i]) + 1 + sizeof(char*);
+    }
+    return size;
+}
+
+/**
+ *
+ * \brief Starts a child.
+ *
+ * \param argv the command and its arguments, NULL terminated; the command is looked up in PATH.
+ * \param dir directory to run in, NULL for the current one.
+ * \param dir_fd descriptor of dir, used instead of its path; -1 if there is none.
+ * \param pid receives the process id.
+ *
+ * \return 0 on success, else errno.
+ */
+static int spawn(const char* const* argv, const char* dir, const int dir_fd, pid_t* pid)
+{
+    posix_spawn_file_actions_t actions;
+    int error = 0;
+
+    if (NULL == dir)
+    {
+        return posix_spawnp(pid, argv[0], NULL, NULL, (char* const*) argv, environ);
+    }
+
+#if HAVE_SPAWN_CHDIR
+    error = posix_spawn_file_actions_init(&actions);
+    if (0 != error)
+    {
+        return error;
+    }
+    error = (dir_fd >= 0) ? posix_spawn_file_actions_addfchdir_np(&actions, dir_fd)
+            : posix_spawn_file_actions_addchdir_np(&actions, dir);
+    if (0 == error)
+    {
+        error = posix_spawnp(pid, argv[0], &actions, NULL, (char* const*) argv, environ);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+#else
+    (void) actions;
+    *pid = fork();
+    if (0 == *pid)
+    {
+        if (0 == ((dir_fd >= 0) ? fchdir(dir_fd) : chdir(dir)))
+        {
+            execvp(argv[0], (char* const*) argv);
+        }
+        _exit(127);
+    }
+    error = (-1 == *pid) ? errno : 0;
+#endif /* HAVE_SPAWN_CHDIR */
+
+    return error;
+}
+
+/**
+ *
+ * \brief Closes the duplicate of the directory descriptor of a batch.
+ *
+ * \param batch the batch, not empty.
+ *
+ * \return void
+ */
+static void close_dir_fd(ExecBatch* batch)
+{
+    if (-1 != batch->dir_fd)
+    {
+        close(batch->dir_fd);
+        batch->dir_fd = -1;
+        stats_open_fds(-1);
+    }
+}
+
+/**
+ *
+ * \brief Replaces every "{}" of an argument by the path, like find does.
+ *
+ * \param arg the argument.
+ * \param path the path.
+ *
+ * \return the new argument, free() it; NULL out of memory.
+ */
+static char* replace_placeholder(const char* arg, const char* path)
+{
+    const size_t path_length = strlen(path);
+    const size_t placeholder_length = strlen(EXEC_PLACEHOLDER);
+    const char* found = arg;
+    size_t length = strlen(arg);
+    char* result = NULL;
+    char* dest = NULL;
+
+    for (found = strstr(arg, EXEC_PLACEHOLDER); NULL != found;
+            found = strstr(found + placeholder_length, EXEC_PLACEHOLDER))
+    {
+        length += path_length - placeholder_length;
+    }
+    result = (char*) malloc(length + 1);
+    if (NULL == result)
+    {
+        return NULL;
+    }
+
+    dest = result;
+    for (found = strstr(arg, EXEC_PLACEHOLDER); NULL != found;
+            found = strstr(arg, EXEC_PLACEHOLDER))
+    {
+        memcpy(dest, arg, found - arg);
+        dest += found - arg;
+        memcpy(dest, path, path_length);
+        dest += path_length;
+        arg = found + placeholder_length;
+    }
+    strcpy(dest, arg);
+
+    return result;
+}
+
+/**
+ *
+ * \brief Waits for one running batch, spool_lock is held.
+ *
+ * A batch which has already exited is taken first, else the oldest one is waited for.
+ *
+ * \return void
+ */
+static void reap_batch(void)
+{
+    int found = 0;
+    int status = 0;
+    int i = 0;
+
+    for (i = 0; i < srunning; ++i)
+    {
+        pid_t pid = waitpid(sbatch_pids[i], &status, WNOHANG);
+
+        if ((pid == sbatch_pids[i]) || ((-1 == pid) && (ECHILD == errno)))
+        {
+            found = 1;
+            break;
+        }
+    }
+    if (!found)
+    {
+        i = 0;
+        status = wait_child(sbatch_pids[0]);
+        if (0 != status)
+        {
+            sfailed = 1;
+        }
+    }
+    else if (!WIFEXITED(status) || (0 != WEXITSTATUS(status)))
+    {
+        sfailed = 1;
+    }
+
+    memmove(sbatch_pids + i, sbatch_pids + i + 1, (srunning - i - 1) * sizeof(pid_t));
+    --srunning;
+}
+
+/**
+ *
+ * \brief Waits for a child to terminate.
+ *
+ * \param pid the child.
+ *
+ * \return its exit status, -1 if it did not exit normally.
+ */
+static int wait_child(const pid_t pid)
+{
+    int status = 0;
+
+    while (-1 == waitpid(pid, &status, 0))
+    {
+        if (EINTR != errno)
+        {
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/*
+ * =================================================================== eof ==
+ */
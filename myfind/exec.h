@@ -0,0 +1,152 @@
+/**
+ * @file exec.h
+ * \brief -exec and -execdir for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _EXEC_H_
+#define _EXEC_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stddef.h>
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * A command of -exec or -execdir as given on the command line.
+ */
+typedef struct execCommandStruct
+{
+    /** The command and its arguments, "{}" is replaced by the path; pointing into argv. */
+    const char** args;
+    /** Number of args, without the "{}" of a batch. */
+    int count;
+    /** Terminated by "{} +": the paths are appended, as many as fit into one command line. */
+    int batch;
+    /** -execdir: run in the directory of the file, with "./" and the base name as path. */
+    int in_dir;
+} ExecCommand;
+
+/**
+ * Paths collected for one run of a "{} +" command.
+ */
+typedef struct execBatchStruct
+{
+    /** The paths, '\0' terminated one after the other; "./" and the base name for -execdir. */
+    char* paths;
+    /** Number of bytes used in paths. */
+    size_t length;
+    /** Size of paths. */
+    size_t capacity;
+    /** Number of paths. */
+    size_t count;
+    /** Directory the command runs in (-execdir), NULL otherwise. */
+    char* dir;
+    /** Duplicate of the descriptor of dir, -1 if there is none; only valid if count > 0. */
+    int dir_fd;
+} ExecBatch;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Sets the number of batches which may run at the same time.
+ *
+ * \param jobs number of children, at least 1.
+ *
+ * \return void
+ */
+extern void exec_init(const int jobs);
+
+/**
+ *
+ * \brief Runs a command for one file and waits for it (terminated by ";").
+ *
+ * \param command the command.
+ * \param dir directory to run in (-execdir), NULL for the current one.
+ * \param dir_fd descriptor of dir, the child changes into it instead of dir; -1 if none.
+ * \param path the path replacing "{}", the base name for -execdir.
+ * \param status receives the exit status, -1 if the command did not exit normally.
+ *
+ * \return 0 on success, else errno (the command could not be started).
+ */
+extern int exec_run(const ExecCommand* command, const char* dir, const int dir_fd,
+        const char* path, int* status);
+
+/**
+ *
+ * \brief Checks whether a path can be added to a batch without running it first.
+ *
+ * \param command the command of the batch.
+ * \param batch the batch.
+ * \param dir directory of the path (-execdir), NULL otherwise.
+ * \param path the path.
+ *
+ * \return non 0 if the path fits, 0 if the batch has to be run first.
+ */
+extern int exec_batch_fits(const ExecCommand* command, const ExecBatch* batch, const char* dir,
+        const char* path);
+
+/**
+ *
+ * \brief Adds a path to a batch.
+ *
+ * The first path of a -execdir batch duplicates dir_fd, the batch changes into the directory
+ * through it when it runs.
+ *
+ * \param batch the batch.
+ * \param dir directory of the path (-execdir), NULL otherwise.
+ * \param dir_fd descriptor of dir, -1 if none.
+ * \param path the path, the base name for -execdir.
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+extern int exec_batch_add(ExecBatch* batch, const char* dir, const int dir_fd,
+        const char* path);
+
+/**
+ *
+ * \brief Starts the command with the paths of a batch and empties the batch.
+ *
+ * Waits for a running batch to finish if the limit of exec_init() is reached. Does nothing
+ * for an empty batch.
+ *
+ * \param command the command of the batch.
+ * \param batch the batch.
+ *
+ * \return 0 on success, else errno (the command could not be started).
+ */
+extern int exec_batch_run(const ExecCommand* command, ExecBatch* batch);
+
+/**
+ *
+ * \brief Frees the paths of a batch without running it.
+ *
+ * \param batch the batch.
+ *
+ * \return void
+ */
+extern void exec_batch_free(ExecBatch* batch);
+
+/**
+ *
+ * \brief Waits for all batches started so far.
+ *
+ * \return 0 if every batch exited with status 0, else -1.
+ */
+extern int exec_wait(void);
+
+#endif /* _EXEC_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,496 @@
+/**
+ * @file fsindex.c
+ * \brief On-disk index of a directory tree for myfind.
+ *
+ * --build-index saves a traversal into a file: a header, one fixed size record per file in
+ * the order of the traversal, and the names. --index maps the file and examines the records
+ * instead of the file system, like locate(1) but with the stat fields of the predicates.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "fsindex.h"
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Magic number at the start of an index file. */
+#define INDEX_MAGIC "MYFINDIX"
+
+/** Version of the format. */
+#define INDEX_VERSION 2
+
+/** Number of records of a new writer. */
+#define INDEX_INITIAL_RECORDS 1024
+
+/** Size of the names of a new writer. */
+#define INDEX_INITIAL_NAMES (16 * 1024)
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+static int write_all(const int fd, const void* data, const size_t size);
+static int check_index(IndexFile* index);
+static size_t hash_child(const uint32_t parent, const char* name);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+void index_writer_init(IndexWriter* writer, const uint32_t flags)
+{
+    memset(writer, 0, sizeof(IndexWriter));
+    writer->flags = flags;
+}
+
+int index_writer_add(IndexWriter* writer, const uint32_t parent, const char* name,
+        const struct stat* info, uint32_t* record)
+{
+    IndexRecord source;
+
+    index_record_fill(&source, info);
+    return index_writer_add_record(writer, parent, name, &source, record);
+}
+
+int index_writer_add_record(IndexWriter* writer, const uint32_t parent, const char* name,
+        const IndexRecord* source, uint32_t* record)
+{
+    size_t name_size = strlen(name) + 1;
+    IndexRecord* entry = NULL;
+
+    if (writer->count >= INDEX_NO_PARENT)
+    {
+        return EOVERFLOW;
+    }
+    if (writer->count == writer->capacity)
+    {
+        size_t capacity = (0 == writer->capacity) ? INDEX_INITIAL_RECORDS : 2 * writer->capacity;
+        IndexRecord* records = (IndexRecord*) realloc(writer->records,
+                capacity * sizeof(IndexRecord));
+
+        if (NULL == records)
+        {
+            return ENOMEM;
+        }
+        writer->records = records;
+        writer->capacity = capacity;
+    }
+    if (writer->names_length + name_size > writer->names_capacity)
+    {
+        size_t capacity = (0 == writer->names_capacity) ? INDEX_INITIAL_NAMES
+                : writer->names_capacity;
+        char* names = NULL;
+
+        while (writer->names_length + name_size > capacity)
+        {
+            capacity *= 2;
+        }
+        names = (char*) realloc(writer->names, capacity);
+        if (NULL == names)
+        {
+            return ENOMEM;
+        }
+        writer->names = names;
+        writer->names_capacity = capacity;
+    }
+
+    entry = &writer->records[writer->count];
+    *entry = *source;
+    entry->name_offset = writer->names_length;
+    entry->parent = parent;
+
+    memcpy(writer->names + writer->names_length, name, name_size);
+    writer->names_length += name_size;
+    *record = (uint32_t) writer->count++;
+
+    return 0;
+}
+
+int index_writer_write(const IndexWriter* writer, const int fd)
+{
+    IndexHeader header;
+    int error = 0;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.record_size = sizeof(IndexRecord);
+    header.flags = writer->flags;
+    header.record_count = writer->count;
+    header.names_size = writer->names_length;
+
+    error = write_all(fd, &header, sizeof(header));
+    if (0 == error)
+    {
+        error = write_all(fd, writer->records, writer->count * sizeof(IndexRecord));
+    }
+    if (0 == error)
+    {
+        error = write_all(fd, writer->names, writer->names_length);
+    }
+
+    return error;
+}
+
+int index_writer_save(const IndexWriter* writer, const char* file_name)
+{
+    char* temp_name = NULL;
+    size_t name_length = strlen(file_name);
+    int error = 0;
+    int fd = -1;
+
+    /* write next to the old index and replace it at once, running queries keep their copy */
+    temp_name = (char*) malloc(name_length + sizeof(".tmp"));
+    if (NULL == temp_name)
+    {
+        return ENOMEM;
+    }
+    memcpy(temp_name, file_name, name_length);
+    memcpy(temp_name + name_length, ".tmp", sizeof(".tmp"));
+
+    fd = open(temp_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (-1 == fd)
+    {
+        error = errno;
+    }
+    if (0 == error)
+    {
+        error = index_writer_write(writer, fd);
+    }
+    if ((-1 != fd) && (close(fd) < 0) && (0 == error))
+    {
+        error = errno;
+    }
+    if ((0 == error) && (rename(temp_name, file_name) < 0))
+    {
+        error = errno;
+    }
+    if ((0 != error) && (-1 != fd))
+    {
+        unlink(temp_name);
+    }
+    free(temp_name);
+
+    return error;
+}
+
+void index_writer_free(IndexWriter* writer)
+{
+    free(writer->records);
+    free(writer->names);
+    memset(writer, 0, sizeof(IndexWriter));
+}
+
+int index_open(IndexFile* index, const char* file_name)
+{
+    int error = 0;
+    int fd = open(file_name, O_RDONLY | O_CLOEXEC);
+
+    if (-1 == fd)
+    {
+        memset(index, 0, sizeof(IndexFile));
+        return errno;
+    }
+    error = index_open_fd(index, fd);
+    close(fd);
+
+    return error;
+}
+
+int index_open_fd(IndexFile* index, const int fd)
+{
+    struct stat info;
+    int error = 0;
+
+    memset(index, 0, sizeof(IndexFile));
+    if (fstat(fd, &info) < 0)
+    {
+        error = errno;
+    }
+    else if ((size_t) info.st_size < sizeof(IndexHeader))
+    {
+        error = EINVAL;
+    }
+    else
+    {
+        index->map_size = (size_t) info.st_size;
+        index->map = mmap(NULL, index->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == index->map)
+        {
+            error = errno;
+            index->map = NULL;
+        }
+    }
+
+    if (0 == error)
+    {
+        error = check_index(index);
+    }
+    if (0 != error)
+    {
+        index_close(index);
+        return error;
+    }
+
+    /* the records are read in order */
+    (void) madvise(index->map, index->map_size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+int index_load_tree(IndexFile* index)
+{
+    uint32_t* last_child = NULL;
+    size_t slot_count = 1;
+    size_t i = 0;
+
+    /* at most half of the slots are used */
+    while (slot_count < 2 * index->count)
+    {
+        slot_count *= 2;
+    }
+    index->first_child = (uint32_t*) malloc(index->count * sizeof(uint32_t));
+    index->next_sibling = (uint32_t*) malloc(index->count * sizeof(uint32_t));
+    index->slots = (uint32_t*) malloc(slot_count * sizeof(uint32_t));
+    last_child = (uint32_t*) malloc(index->count * sizeof(uint32_t));
+    if ((NULL == index->first_child) || (NULL == index->next_sibling) || (NULL == index->slots)
+            || (NULL == last_child))
+    {
+        free(last_child);
+        return ENOMEM;
+    }
+    index->slot_mask = slot_count - 1;
+    memset(index->first_child, 0xff, index->count * sizeof(uint32_t));
+    memset(index->next_sibling, 0xff, index->count * sizeof(uint32_t));
+    memset(index->slots, 0xff, slot_count * sizeof(uint32_t));
+
+    for (i = 1; i < index->count; ++i)
+    {
+        const uint32_t parent = index->records[i].parent;
+        size_t slot = hash_child(parent, index->names + index->records[i].name_offset);
+
+        /* the parent comes first, so the entries of a directory are linked in order */
+        if (INDEX_NO_RECORD == index->first_child[parent])
+        {
+            index->first_child[parent] = (uint32_t) i;
+        }
+        else
+        {
+            index->next_sibling[last_child[parent]] = (uint32_t) i;
+        }
+        last_child[parent] = (uint32_t) i;
+
+        while (INDEX_NO_RECORD != index->slots[slot & index->slot_mask])
+        {
+            ++slot;
+        }
+        index->slots[slot & index->slot_mask] = (uint32_t) i;
+    }
+    free(last_child);
+
+    return 0;
+}
+
+uint32_t index_find_child(const IndexFile* index, const uint32_t parent, const char* name)
+{
+    size_t slot = hash_child(parent, name);
+
+    for (;; ++slot)
+    {
+        const uint32_t record = index->slots[slot & index->slot_mask];
+
+        if ((INDEX_NO_RECORD == record) || ((index->records[record].parent == parent)
+                && (0 == strcmp(index->names + index->records[record].name_offset, name))))
+        {
+            return record;
+        }
+    }
+}
+
+int index_dir_unchanged(const IndexRecord* record, const struct stat* info)
+{
+    return S_ISDIR(info->st_mode) && S_ISDIR(record->mode)
+            && (record->ino == (uint64_t) info->st_ino)
+            && (record->mtime == (int64_t) info->st_mtim.tv_sec)
+            && (record->mtime_nsec == (uint32_t) info->st_mtim.tv_nsec)
+            && (record->ctime == (int64_t) info->st_ctim.tv_sec)
+            && (record->ctime_nsec == (uint32_t) info->st_ctim.tv_nsec);
+}
+
+void index_close(IndexFile* index)
+{
+    free(index->first_child);
+    free(index->next_sibling);
+    free(index->slots);
+    if (NULL != index->map)
+    {
+        munmap(index->map, index->map_size);
+    }
+    memset(index, 0, sizeof(IndexFile));
+}
+
+const char* index_record_name(const IndexFile* index, const IndexRecord* record)
+{
+    return index->names + record->name_offset;
+}
+
+void index_record_fill(IndexRecord* record, const struct stat* info)
+{
+    memset(record, 0, sizeof(IndexRecord));
+    record->ino = (uint64_t) info->st_ino;
+    record->size = (uint64_t) info->st_size;
+    record->blocks = (uint64_t) info->st_blocks;
+    record->mtime = (int64_t) info->st_mtim.tv_sec;
+    record->mtime_nsec = (uint32_t) info->st_mtim.tv_nsec;
+    record->ctime = (int64_t) info->st_ctim.tv_sec;
+    record->ctime_nsec = (uint32_t) info->st_ctim.tv_nsec;
+    record->mode = (uint32_t) info->st_mode;
+    record->uid = (uint32_t) info->st_uid;
+    record->gid = (uint32_t) info->st_gid;
+    record->nlink = (uint32_t) info->st_nlink;
+}
+
+void index_record_stat(const IndexRecord* record, struct stat* info)
+{
+    memset(info, 0, sizeof(struct stat));
+    info->st_ino = (ino_t) record->ino;
+    info->st_size = (off_t) record->size;
+    info->st_blocks = (blkcnt_t) record->blocks;
+    info->st_mtim.tv_sec = (time_t) record->mtime;
+    info->st_mtim.tv_nsec = (long) record->mtime_nsec;
+    info->st_ctim.tv_sec = (time_t) record->ctime;
+    info->st_ctim.tv_nsec = (long) record->ctime_nsec;
+    info->st_mode = (mode_t) record->mode;
+    info->st_uid = (uid_t) record->uid;
+    info->st_gid = (gid_t) record->gid;
+    info->st_nlink = (nlink_t) record->nlink;
+}
+
+/**
+ *
+ * \brief Writes a buffer completely.
+ *
+ * \param fd file to write to.
+ * \param data the buffer.
+ * \param size size of the buffer.
+ *
+ * \return 0 on success, else errno.
+ */
+static int write_all(const int fd, const void* data, const size_t size)
+{
+    const char* next = (const char*) data;
+    size_t left = size;
+
+    while (left > 0)
+    {
+        ssize_t written = write(fd, next, left);
+
+        if (written < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return errno;
+        }
+        next += written;
+        left -= (size_t) written;
+    }
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Checks the format of a mapped index and sets up the pointers into it.
+ *
+ * Every record has to be in range, so the queries need no checks: the names are terminated
+ * and the parent of a record comes before it, as the traversal adds them.
+ *
+ * \param index the mapped file.
+ *
+ * \return 0 if the index is valid, else EINVAL.
+ */
+static int check_index(IndexFile* index)
+{
+    const IndexHeader* header = (const IndexHeader*) index->map;
+    size_t available = index->map_size - sizeof(IndexHeader);
+    size_t i = 0;
+
+    if ((0 != memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)))
+            || (INDEX_VERSION != header->version) || (sizeof(IndexRecord) != header->record_size)
+            || (0 == header->record_count)
+            || (header->record_count > available / sizeof(IndexRecord)))
+    {
+        return EINVAL;
+    }
+    available -= header->record_count * sizeof(IndexRecord);
+    if ((0 == header->names_size) || (header->names_size != available))
+    {
+        return EINVAL;
+    }
+
+    index->header = header;
+    index->records = (const IndexRecord*) (header + 1);
+    index->count = (size_t) header->record_count;
+    index->names = (const char*) (index->records + index->count);
+    if ('\0' != index->names[header->names_size - 1])
+    {
+        return EINVAL;
+    }
+
+    for (i = 0; i < index->count; ++i)
+    {
+        const IndexRecord* record = &index->records[i];
+
+        if ((record->name_offset >= header->names_size)
+                || ((0 == i) ? (INDEX_NO_PARENT != record->parent) : (record->parent >= i)))
+        {
+            return EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Hash value of an entry of a directory, FNV-1a over the name seeded with the parent.
+ *
+ * \param parent record of the directory.
+ * \param name name of the entry.
+ *
+ * \return hash value.
+ */
+static size_t hash_child(const uint32_t parent, const char* name)
+{
+    uint64_t hash = 14695981039346656037ULL ^ parent;
+
+    for (; '\0' != *name; ++name)
+    {
+        hash ^= (unsigned char) *name;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) hash;
+}
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,330 @@
+/**
+ * @file fsindex.h
+ * \brief On-disk index of a directory tree for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _FSINDEX_H_
+#define _FSINDEX_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Parent of the root record. */
+#define INDEX_NO_PARENT UINT32_MAX
+
+/** No such record. */
+#define INDEX_NO_RECORD UINT32_MAX
+
+/** Header flag: the start path was given on the command line and is examined itself. */
+#define INDEX_FLAG_PATH_GIVEN 1U
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * Start of an index file, followed by the records and the names.
+ *
+ * All numbers are in the byte order of the machine which built the index.
+ */
+typedef struct indexHeaderStruct
+{
+    /** "MYFINDIX". */
+    char magic[8];
+    /** Version of the format. */
+    uint32_t version;
+    /** sizeof(IndexRecord), guards against a different layout. */
+    uint32_t record_size;
+    /** INDEX_FLAG_... of the traversal. */
+    uint32_t flags;
+    /** Reserved, 0. */
+    uint32_t reserved;
+    /** Number of records. */
+    uint64_t record_count;
+    /** Size of the names, which follow the records. */
+    uint64_t names_size;
+} IndexHeader;
+
+/**
+ * One file of the tree, the records are in the order of the traversal.
+ *
+ * Only the fields the predicates and -ls look at are kept.
+ */
+typedef struct indexRecordStruct
+{
+    /** st_ino. */
+    uint64_t ino;
+    /** st_size. */
+    uint64_t size;
+    /** st_blocks. */
+    uint64_t blocks;
+    /** st_mtime. */
+    int64_t mtime;
+    /** st_ctime. */
+    int64_t ctime;
+    /** Offset of the '\0' terminated name in the names. */
+    uint64_t name_offset;
+    /** Index of the record of the parent directory, INDEX_NO_PARENT for the root. */
+    uint32_t parent;
+    /** st_mode. */
+    uint32_t mode;
+    /** st_uid. */
+    uint32_t uid;
+    /** st_gid. */
+    uint32_t gid;
+    /** st_nlink. */
+    uint32_t nlink;
+    /** Nanoseconds of st_mtim. */
+    uint32_t mtime_nsec;
+    /** Nanoseconds of st_ctim. */
+    uint32_t ctime_nsec;
+    /** Reserved, 0. */
+    uint32_t reserved;
+} IndexRecord;
+
+/**
+ * Collects the records of a traversal in memory until it is saved.
+ */
+typedef struct indexWriterStruct
+{
+    /** Records collected so far. */
+    IndexRecord* records;
+    /** Number of records. */
+    size_t count;
+    /** Number of records there is room for. */
+    size_t capacity;
+    /** Names of the records, '\0' terminated one after the other. */
+    char* names;
+    /** Number of bytes used in names. */
+    size_t names_length;
+    /** Size of names. */
+    size_t names_capacity;
+    /** INDEX_FLAG_... to be saved. */
+    uint32_t flags;
+} IndexWriter;
+
+/**
+ * A mapped index file.
+ */
+typedef struct indexFileStruct
+{
+    /** Mapping of the whole file. */
+    void* map;
+    /** Size of the mapping. */
+    size_t map_size;
+    /** Header of the file. */
+    const IndexHeader* header;
+    /** Records of the file. */
+    const IndexRecord* records;
+    /** Number of records. */
+    size_t count;
+    /** Names of the records. */
+    const char* names;
+    /** First entry of every record, INDEX_NO_RECORD if none, see index_load_tree(). */
+    uint32_t* first_child;
+    /** Next entry of the same directory of every record, INDEX_NO_RECORD if none. */
+    uint32_t* next_sibling;
+    /** Hash map from parent and name to record, INDEX_NO_RECORD marks a free slot. */
+    uint32_t* slots;
+    /** Number of slots - 1, the number of slots is a power of two. */
+    size_t slot_mask;
+} IndexFile;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Sets up an empty writer.
+ *
+ * \param writer to be set up.
+ * \param flags INDEX_FLAG_... of the traversal.
+ *
+ * \return void
+ */
+extern void index_writer_init(IndexWriter* writer, const uint32_t flags);
+
+/**
+ *
+ * \brief Appends the record of a file, the parent has to be added before its entries.
+ *
+ * \param writer the writer.
+ * \param parent record of the parent directory, INDEX_NO_PARENT for the root.
+ * \param name name of the file within its parent, the path as given for the root.
+ * \param info file information.
+ * \param record receives the index of the new record.
+ *
+ * \return 0 on success, ENOMEM or EOVERFLOW (too many records).
+ */
+extern int index_writer_add(IndexWriter* writer, const uint32_t parent, const char* name,
+        const struct stat* info, uint32_t* record);
+
+/**
+ *
+ * \brief Appends a record whose stat fields are already filled in.
+ *
+ * \param writer the writer.
+ * \param parent record of the parent directory, INDEX_NO_PARENT for the root.
+ * \param name name of the file within its parent, the path as given for the root.
+ * \param source the stat fields, see index_record_fill().
+ * \param record receives the index of the new record.
+ *
+ * \return 0 on success, ENOMEM or EOVERFLOW (too many records).
+ */
+extern int index_writer_add_record(IndexWriter* writer, const uint32_t parent, const char* name,
+        const IndexRecord* source, uint32_t* record);
+
+/**
+ *
+ * \brief Writes the index to an open file.
+ *
+ * \param writer the writer.
+ * \param fd file to write to, at its current offset.
+ *
+ * \return 0 on success, else errno.
+ */
+extern int index_writer_write(const IndexWriter* writer, const int fd);
+
+/**
+ *
+ * \brief Writes the records to a file, which is replaced atomically.
+ *
+ * \param writer the writer.
+ * \param file_name the index file.
+ *
+ * \return 0 on success, else errno.
+ */
+extern int index_writer_save(const IndexWriter* writer, const char* file_name);
+
+/**
+ *
+ * \brief Frees the records of a writer.
+ *
+ * \param writer the writer.
+ *
+ * \return void
+ */
+extern void index_writer_free(IndexWriter* writer);
+
+/**
+ *
+ * \brief Maps an index file and checks its format.
+ *
+ * \param index receives the mapping.
+ * \param file_name the index file.
+ *
+ * \return 0 on success, else errno (EINVAL if the file is no valid index).
+ */
+extern int index_open(IndexFile* index, const char* file_name);
+
+/**
+ *
+ * \brief Maps an index from an open file and checks its format.
+ *
+ * \param index receives the mapping.
+ * \param fd the index file, may be closed afterwards.
+ *
+ * \return 0 on success, else errno (EINVAL if the file is no valid index).
+ */
+extern int index_open_fd(IndexFile* index, const int fd);
+
+/**
+ *
+ * \brief Sets up the lookups of the entries of a directory, for an incremental rebuild.
+ *
+ * \param index opened by index_open().
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+extern int index_load_tree(IndexFile* index);
+
+/**
+ *
+ * \brief Finds the entry of a directory by name.
+ *
+ * \param index set up by index_load_tree().
+ * \param parent record of the directory.
+ * \param name name of the entry.
+ *
+ * \return the record of the entry, INDEX_NO_RECORD if the directory had no such entry.
+ */
+extern uint32_t index_find_child(const IndexFile* index, const uint32_t parent,
+        const char* name);
+
+/**
+ *
+ * \brief Checks whether a directory is unchanged since the index was built.
+ *
+ * Creating, removing and renaming entries updates the mtime of a directory. The ctime is
+ * updated as well and can not be set back by utimes(), so both together tell whether the
+ * listing of the record is still valid. The entries themselves may have changed.
+ *
+ * \param record record of the directory.
+ * \param info current file information of the directory.
+ *
+ * \return non 0 if the directory still has the entries of the record.
+ */
+extern int index_dir_unchanged(const IndexRecord* record, const struct stat* info);
+
+/**
+ *
+ * \brief Unmaps an index file.
+ *
+ * \param index opened by index_open().
+ *
+ * \return void
+ */
+extern void index_close(IndexFile* index);
+
+/**
+ *
+ * \brief Name of a record.
+ *
+ * \param index the index.
+ * \param record the record.
+ *
+ * \return '\0' terminated name within the mapping.
+ */
+extern const char* index_record_name(const IndexFile* index, const IndexRecord* record);
+
+/**
+ *
+ * \brief Copies the stat fields kept in a record from the file information.
+ *
+ * \param record receives the fields, parent and name are 0.
+ * \param info file information.
+ *
+ * \return void
+ */
+extern void index_record_fill(IndexRecord* record, const struct stat* info);
+
+/**
+ *
+ * \brief Fills the stat fields kept in a record, the others are 0.
+ *
+ * \param record the record.
+ * \param info receives the file information.
+ *
+ * \return void
+ */
+extern void index_record_stat(const IndexRecord* record, struct stat* info);
+
+#endif /* _FSINDEX_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,537 @@
+/**
+ * @file gentree.c
+ * \brief Synthetic tree generator for the myfind benchmark.
+ *
+ * Creates a reproducible directory tree for bench.sh (make bench):
+ *
+ *     ./gentree [-d depth] [-f fan-out] [-n files] [-b bytes] [-e uniform|zipf]
+ *               [-u uid,uid,...] [-l percent] [-s seed] DIR
+ *
+ * Every directory down to the given depth gets fan-out subdirectories and the given number of
+ * entries. The extensions of the names are drawn uniformly or Zipf distributed (.c most often,
+ * then .h, ...), the owners from the list of user ids (needs root, else they are left alone),
+ * and the given percentage of the entries are symbolic links to a sibling. Regular files are
+ * sparse with a random size below the given number of bytes. The same options and seed give
+ * the same tree.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Depth of the tree if -d is not given. */
+#define DEFAULT_DEPTH 4
+
+/** Subdirectories per directory if -f is not given. */
+#define DEFAULT_FANOUT 6
+
+/** Entries per directory if -n is not given. */
+#define DEFAULT_FILES 40
+
+/** Upper limit of the file sizes if -b is not given. */
+#define DEFAULT_BYTES 65536
+
+/** Percentage of symbolic links if -l is not given. */
+#define DEFAULT_SYMLINKS 5
+
+/** Seed if -s is not given. */
+#define DEFAULT_SEED 1
+
+/** Most user ids -u takes. */
+#define MAX_UIDS 64
+
+/** Shortest random part of a name. */
+#define MIN_NAME_LENGTH 4
+
+/** Longest random part of a name. */
+#define MAX_NAME_LENGTH 16
+
+/** Room for the name of an entry: kind, index, random part and extension. */
+#define MAX_ENTRY_NAME 64
+
+/** Convert the numbers of the options as decimal numbers. */
+#define NUMBER_BASE 10
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * The shape of the tree, from the command line.
+ */
+typedef struct treeShapeStruct
+{
+    /** Levels of subdirectories below the root. */
+    long depth;
+    /** Subdirectories per directory. */
+    long fanout;
+    /** Entries per directory, besides the subdirectories. */
+    long files;
+    /** File sizes are below this. */
+    long bytes;
+    /** Percentage of the entries which are symbolic links. */
+    long symlinks;
+    /** Extensions Zipf distributed instead of uniformly. */
+    int zipf;
+    /** Owners of the entries. */
+    uid_t uids[MAX_UIDS];
+    /** Number of uids, 0 to keep the owner. */
+    int uid_count;
+} TreeShape;
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+/** Extensions of the entries, most frequent first with -e zipf. */
+static const char* const EXTENSIONS[] =
+{ ".c", ".h", ".o", ".txt", ".log", ".json", ".md", ".py", ".so", "" };
+
+/** Number of EXTENSIONS. */
+static const int EXTENSION_COUNT = (int) (sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]));
+
+/** State of the random number generator. */
+static uint64_t srandom_state = DEFAULT_SEED;
+
+/** Number of directories created, for the summary. */
+static unsigned long sdirectories = 0;
+
+/** Number of regular files created, for the summary. */
+static unsigned long sfiles = 0;
+
+/** Number of symbolic links created, for the summary. */
+static unsigned long slinks = 0;
+
+/** chown() failed with EPERM once, the owners are left alone from then on. */
+static int schown_denied = 0;
+
+/** Name of the program for the messages. */
+static const char* sprogram_name = "gentree";
+
+static int make_tree(const TreeShape* shape, char* path, const size_t length, const long level);
+static int make_entry(const TreeShape* shape, char* path, const size_t length, const long index,
+        const char* previous);
+static void set_owner(const TreeShape* shape, const char* path);
+static void make_name(char* name, const size_t size, const char* prefix, const long index,
+        const char* extension);
+static const char* pick_extension(const TreeShape* shape);
+static uint64_t next_random(void);
+static long parse_number(const char* text, const char option);
+static int parse_uids(const char* text, TreeShape* shape);
+static void print_usage(void);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Parses the options and creates the tree.
+ *
+ * \param argc number of arguments.
+ * \param argv the arguments.
+ *
+ * \return EXIT_SUCCESS on success  EXIT_FAILURE on error.
+ */
+int main(int argc, char* argv[])
+{
+    TreeShape shape;
+    char path[PATH_MAX];
+    int option = 0;
+    long number = 0;
+
+    memset(&shape, 0, sizeof(shape));
+    shape.depth = DEFAULT_DEPTH;
+    shape.fanout = DEFAULT_FANOUT;
+    shape.files = DEFAULT_FILES;
+    shape.bytes = DEFAULT_BYTES;
+    shape.symlinks = DEFAULT_SYMLINKS;
+    sprogram_name = argv[0];
+
+    while (-1 != (option = getopt(argc, argv, "d:f:n:b:e:u:l:s:")))
+    {
+        switch (option)
+        {
+        case 'd':
+            shape.depth = parse_number(optarg, 'd');
+            break;
+        case 'f':
+            shape.fanout = parse_number(optarg, 'f');
+            break;
+        case 'n':
+            shape.files = parse_number(optarg, 'n');
+            break;
+        case 'b':
+            shape.bytes = parse_number(optarg, 'b');
+            break;
+        case 'l':
+            shape.symlinks = parse_number(optarg, 'l');
+            break;
+        case 's':
+            number = parse_number(optarg, 's');
+            if (number < 0)
+            {
+                print_usage();
+                return EXIT_FAILURE;
+            }
+            srandom_state = (uint64_t) number;
+            break;
+        case 'e':
+            if ((0 != strcmp("uniform", optarg)) && (0 != strcmp("zipf", optarg)))
+            {
+                print_usage();
+                return EXIT_FAILURE;
+            }
+            shape.zipf = (0 == strcmp("zipf", optarg));
+            break;
+        case 'u':
+            if (0 != parse_uids(optarg, &shape))
+            {
+                print_usage();
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if ((optind + 1 != argc) || (shape.depth < 0) || (shape.fanout < 0) || (shape.files < 0)
+            || (shape.symlinks < 0) || (shape.symlinks > 100) || (shape.bytes < 1)
+            || (strlen(argv[optind]) + MAX_ENTRY_NAME >= sizeof(path)))
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (0 == srandom_state)
+    {
+        /* xorshift gets stuck at 0 */
+        srandom_state = DEFAULT_SEED;
+    }
+
+    strcpy(path, argv[optind]);
+    if ((-1 == mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) && (EEXIST != errno))
+    {
+        fprintf(stderr, "%s: `%s': %s\n", sprogram_name, path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (0 != make_tree(&shape, path, strlen(path), 0))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (printf("%lu directories, %lu files, %lu symbolic links\n", sdirectories, sfiles, slinks)
+            < 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *
+ * \brief Fills a directory with entries and subdirectories, recursively.
+ *
+ * \param shape the shape of the tree.
+ * \param path path of the directory, the names of the entries are appended in place.
+ * \param length length of path.
+ * \param level depth of the directory, 0 for the root.
+ *
+ * \return 0 on success, else -1 (the error is printed).
+ */
+static int make_tree(const TreeShape* shape, char* path, const size_t length, const long level)
+{
+    char previous[MAX_ENTRY_NAME];
+    long i = 0;
+
+    previous[0] = '\0';
+    for (i = 0; i < shape->files; ++i)
+    {
+        if (0 != make_entry(shape, path, length, i, previous))
+        {
+            return -1;
+        }
+        /* the next link points at this entry */
+        snprintf(previous, sizeof(previous), "%s", strrchr(path, '/') + 1);
+        path[length] = '\0';
+    }
+
+    for (i = 0; (level < shape->depth) && (i < shape->fanout); ++i)
+    {
+        size_t sub_length = 0;
+
+        path[length] = '/';
+        make_name(path + length + 1, PATH_MAX - length - 1, "d", i, "");
+        sub_length = strlen(path);
+        if ((sub_length + MAX_ENTRY_NAME >= PATH_MAX)
+                || ((-1 == mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH))
+                        && (EEXIST != errno)))
+        {
+            fprintf(stderr, "%s: `%s': %s\n", sprogram_name, path,
+                    (sub_length + MAX_ENTRY_NAME >= PATH_MAX) ? "Path too long"
+                            : strerror(errno));
+            return -1;
+        }
+        set_owner(shape, path);
+        ++sdirectories;
+        if (0 != make_tree(shape, path, sub_length, level + 1))
+        {
+            return -1;
+        }
+        path[length] = '\0';
+    }
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Creates one entry of a directory, a regular file or a symbolic link.
+ *
+ * \param shape the shape of the tree.
+ * \param path path of the directory, the name of the entry is appended and left there.
+ * \param length length of the path of the directory.
+ * \param index number of the entry in the directory.
+ * \param previous name of the entry before, the target of a link; empty for the first.
+ *
+ * \return 0 on success, else -1 (the error is printed).
+ */
+static int make_entry(const TreeShape* shape, char* path, const size_t length, const long index,
+        const char* previous)
+{
+    const int link = ('\0' != previous[0])
+            && ((long) (next_random() % 100) < shape->symlinks);
+    int error = 0;
+
+    path[length] = '/';
+    make_name(path + length + 1, PATH_MAX - length - 1, link ? "l" : "f", index,
+            pick_extension(shape));
+
+    if (link)
+    {
+        error = (-1 == symlink(previous, path)) && (EEXIST != errno);
+        ++slinks;
+    }
+    else
+    {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+        /* sparse, only the size is stored */
+        error = (-1 == fd) || (-1 == ftruncate(fd, (off_t) (next_random() % shape->bytes)));
+        if ((-1 != fd) && (-1 == close(fd)))
+        {
+            error = 1;
+        }
+        ++sfiles;
+    }
+    if (error)
+    {
+        fprintf(stderr, "%s: `%s': %s\n", sprogram_name, path, strerror(errno));
+        return -1;
+    }
+    set_owner(shape, path);
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Gives an entry one of the user ids of -u, without following links.
+ *
+ * \param shape the shape of the tree.
+ * \param path the entry.
+ *
+ * \return void
+ */
+static void set_owner(const TreeShape* shape, const char* path)
+{
+    uid_t uid = 0;
+
+    if (0 == shape->uid_count)
+    {
+        return;
+    }
+    /* drawn even if it is not set, so the names do not depend on being root */
+    uid = shape->uids[next_random() % shape->uid_count];
+    if (!schown_denied && (-1 == lchown(path, uid, (gid_t) -1)) && (EPERM == errno))
+    {
+        fprintf(stderr, "%s: changing the owner needs root, -u is ignored\n", sprogram_name);
+        schown_denied = 1;
+    }
+}
+
+/**
+ *
+ * \brief Builds a random name which is unique within its directory.
+ *
+ * \param name receives the name.
+ * \param size size of name.
+ * \param prefix kind of the entry, "d", "f" or "l".
+ * \param index number of the entry in the directory, makes the name unique.
+ * \param extension extension of the name.
+ *
+ * \return void
+ */
+static void make_name(char* name, const size_t size, const char* prefix, const long index,
+        const char* extension)
+{
+    char random_part[MAX_NAME_LENGTH + 1];
+    const int length = MIN_NAME_LENGTH
+            + (int) (next_random() % (MAX_NAME_LENGTH - MIN_NAME_LENGTH + 1));
+    int i = 0;
+
+    for (i = 0; i < length; ++i)
+    {
+        random_part[i] = (char) ('a' + next_random() % 26);
+    }
+    random_part[length] = '\0';
+    snprintf(name, size, "%s%ld_%s%s", prefix, index, random_part, extension);
+}
+
+/**
+ *
+ * \brief Draws the extension of a name.
+ *
+ * With -e zipf the k-th extension comes with a probability proportional to 1/k, like the
+ * file types of a source tree, else all are equally likely.
+ *
+ * \param shape the shape of the tree.
+ *
+ * \return the extension, "" for none.
+ */
+static const char* pick_extension(const TreeShape* shape)
+{
+    double total = 0.0;
+    double draw = 0.0;
+    int i = 0;
+
+    if (!shape->zipf)
+    {
+        return EXTENSIONS[next_random() % EXTENSION_COUNT];
+    }
+
+    for (i = 0; i < EXTENSION_COUNT; ++i)
+    {
+        total += 1.0 / (i + 1);
+    }
+    draw = total * (double) (next_random() >> 11) / (double) (UINT64_C(1) << 53);
+    for (i = 0; i < EXTENSION_COUNT - 1; ++i)
+    {
+        draw -= 1.0 / (i + 1);
+        if (draw < 0.0)
+        {
+            break;
+        }
+    }
+    return EXTENSIONS[i];
+}
+
+/**
+ *
+ * \brief Next number of the xorshift64* generator, the same seed gives the same sequence.
+ *
+ * \return a random number.
+ */
+static uint64_t next_random(void)
+{
+    srandom_state ^= srandom_state >> 12;
+    srandom_state ^= srandom_state << 25;
+    srandom_state ^= srandom_state >> 27;
+
+    return srandom_state * UINT64_C(2685821657736338717);
+}
+
+/**
+ *
+ * \brief Converts the argument of an option to a number.
+ *
+ * \param text the argument.
+ * \param option the option, for the error message.
+ *
+ * \return the number, -1 if it is not one (rejected by the range checks of main()).
+ */
+static long parse_number(const char* text, const char option)
+{
+    char* end = NULL;
+    long number = 0;
+
+    errno = 0;
+    number = strtol(text, &end, NUMBER_BASE);
+    if ((0 != errno) || (end == text) || ('\0' != *end))
+    {
+        fprintf(stderr, "%s: argument of -%c is not a number: `%s'\n", sprogram_name, option,
+                text);
+        return -1;
+    }
+    return number;
+}
+
+/**
+ *
+ * \brief Parses the comma separated user ids of -u.
+ *
+ * \param text the argument.
+ * \param shape receives the user ids.
+ *
+ * \return 0 on success, else -1.
+ */
+static int parse_uids(const char* text, TreeShape* shape)
+{
+    const char* current = text;
+
+    shape->uid_count = 0;
+    while ('\0' != *current)
+    {
+        char* end = NULL;
+        long uid = 0;
+
+        errno = 0;
+        uid = strtol(current, &end, NUMBER_BASE);
+        if ((0 != errno) || (end == current) || (uid < 0) || (shape->uid_count >= MAX_UIDS)
+                || ((',' != *end) && ('\0' != *end)))
+        {
+            return -1;
+        }
+        shape->uids[shape->uid_count++] = (uid_t) uid;
+        current = (',' == *end) ? end + 1 : end;
+    }
+    return (shape->uid_count > 0) ? 0 : -1;
+}
+
+/**
+ *
+ * \brief Prints the usage on stderr.
+ *
+ * \return void
+ */
+static void print_usage(void)
+{
+    fprintf(stderr, "Usage: %s [-d depth] [-f fan-out] [-n files] [-b bytes] [-e uniform|zipf]\n"
+            "          [-u uid,uid,...] [-l symlink percent] [-s seed] DIR\n", sprogram_name);
+}
+
+/*
+ * =================================================================== eof ==
+ */
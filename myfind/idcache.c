@@ -0,0 +1,400 @@
+/**
+ * @file idcache.c
+ * \brief User and group name cache for myfind.
+ *
+ * Hash maps from user id to user name and from group id to group name. getpwuid() and
+ * getgrgid() may go through NSS (LDAP, ...) which is expensive, so each id is resolved once.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pwd.h>
+#include <grp.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "idcache.h"
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Number of slots of a new cache, must be a power of two. */
+#define IDCACHE_INITIAL_SLOTS 64
+
+/** Buffer size for getpwuid_r()/getgrgid_r() if sysconf() does not know better. */
+#define IDCACHE_NSS_BUFFER 1024
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * One slot of the open addressing hash map.
+ */
+typedef struct idCacheEntryStruct
+{
+    /** User or group id. */
+    unsigned long id;
+    /** Name of the id, NULL if the id is unknown to the data base. */
+    char* name;
+    /** Slot is occupied. */
+    int used;
+} IdCacheEntry;
+
+/**
+ * Hash map from id to name.
+ */
+typedef struct idCacheStruct
+{
+    /** Readers look up, the writer resolves and inserts. */
+    pthread_rwlock_t lock;
+    /** Slots, capacity is a power of two. */
+    IdCacheEntry* slots;
+    /** Number of slots. */
+    size_t capacity;
+    /** Number of used slots. */
+    size_t count;
+    /** Number of times the data base was asked, for --stats. */
+    unsigned long lookups;
+} IdCache;
+
+/**
+ * Resolves an id through the data base.
+ *
+ * Returns 0 and the name (malloc'ed, NULL for unknown ids) or an errno value.
+ */
+typedef int (*IdResolver)(const unsigned long id, char** name);
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+/** Cache of user names. */
+static IdCache susers = { PTHREAD_RWLOCK_INITIALIZER, NULL, 0, 0, 0 };
+
+/** Cache of group names. */
+static IdCache sgroups = { PTHREAD_RWLOCK_INITIALIZER, NULL, 0, 0, 0 };
+
+static const char* lookup(IdCache* cache, const unsigned long id, IdResolver resolver);
+static IdCacheEntry* find_slot(IdCacheEntry* slots, const size_t capacity, const unsigned long id);
+static int insert(IdCache* cache, const unsigned long id, char* name);
+static int resolve_user(const unsigned long id, char** name);
+static int resolve_group(const unsigned long id, char** name);
+static size_t get_nss_buffer_size(const int name);
+static void free_cache(IdCache* cache);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+const char* idcache_user_name(const uid_t uid)
+{
+    return lookup(&susers, (unsigned long) uid, resolve_user);
+}
+
+const char* idcache_group_name(const gid_t gid)
+{
+    return lookup(&sgroups, (unsigned long) gid, resolve_group);
+}
+
+void idcache_lookups(unsigned long* users, unsigned long* groups)
+{
+    pthread_rwlock_rdlock(&susers.lock);
+    *users = susers.lookups;
+    pthread_rwlock_unlock(&susers.lock);
+    pthread_rwlock_rdlock(&sgroups.lock);
+    *groups = sgroups.lookups;
+    pthread_rwlock_unlock(&sgroups.lock);
+}
+
+void idcache_free(void)
+{
+    free_cache(&susers);
+    free_cache(&sgroups);
+}
+
+/**
+ *
+ * \brief Looks up an id, resolves and remembers it on a miss.
+ *
+ * \param cache to look into.
+ * \param id user or group id.
+ * \param resolver asks the data base on a miss.
+ *
+ * \return name of the id, NULL if unknown.
+ */
+static const char* lookup(IdCache* cache, const unsigned long id, IdResolver resolver)
+{
+    IdCacheEntry* slot = NULL;
+    const char* result = NULL;
+    char* name = NULL;
+    int found = 0;
+
+    pthread_rwlock_rdlock(&cache->lock);
+    if (NULL != cache->slots)
+    {
+        slot = find_slot(cache->slots, cache->capacity, id);
+        found = slot->used;
+        result = slot->name;
+    }
+    pthread_rwlock_unlock(&cache->lock);
+    if (found)
+    {
+        return result;
+    }
+
+    /* miss: only one thread resolves, the others wait for its result */
+    pthread_rwlock_wrlock(&cache->lock);
+    if (NULL != cache->slots)
+    {
+        slot = find_slot(cache->slots, cache->capacity, id);
+        if (slot->used)
+        {
+            result = slot->name;
+            pthread_rwlock_unlock(&cache->lock);
+            return result;
+        }
+    }
+
+    ++cache->lookups;
+    if (0 == resolver(id, &name))
+    {
+        if (0 == insert(cache, id, name))
+        {
+            result = name;
+        }
+        else
+        {
+            /* out of memory, answer this time without remembering */
+            result = NULL;
+            free(name);
+        }
+    }
+    pthread_rwlock_unlock(&cache->lock);
+
+    return result;
+}
+
+/**
+ *
+ * \brief Finds the slot of an id, linear probing.
+ *
+ * \param slots hash map.
+ * \param capacity number of slots, a power of two.
+ * \param id to look for.
+ *
+ * \return the slot holding the id or the free slot where it belongs.
+ */
+static IdCacheEntry* find_slot(IdCacheEntry* slots, const size_t capacity, const unsigned long id)
+{
+    /* multiplicative hashing, ids are often consecutive numbers */
+    size_t index = (size_t) ((id * 2654435761UL) & (capacity - 1));
+
+    while (slots[index].used && (slots[index].id != id))
+    {
+        index = (index + 1) & (capacity - 1);
+    }
+    return &slots[index];
+}
+
+/**
+ *
+ * \brief Inserts an id, the hash map grows at a load factor of 3/4.
+ *
+ * Must be called with the write lock held.
+ *
+ * \param cache to insert into.
+ * \param id user or group id.
+ * \param name of the id, NULL for unknown ids, owned by the cache afterwards.
+ *
+ * \return 0 on success, ENOMEM if the hash map could not grow.
+ */
+static int insert(IdCache* cache, const unsigned long id, char* name)
+{
+    IdCacheEntry* slot = NULL;
+    size_t i = 0;
+
+    if ((cache->count + 1) * 4 > cache->capacity * 3)
+    {
+        size_t capacity = (0 == cache->capacity) ? IDCACHE_INITIAL_SLOTS : 2 * cache->capacity;
+        IdCacheEntry* slots = (IdCacheEntry*) calloc(capacity, sizeof(IdCacheEntry));
+
+        if (NULL == slots)
+        {
+            return ENOMEM;
+        }
+        for (i = 0; i < cache->capacity; ++i)
+        {
+            if (cache->slots[i].used)
+            {
+                *find_slot(slots, capacity, cache->slots[i].id) = cache->slots[i];
+            }
+        }
+        free(cache->slots);
+        cache->slots = slots;
+        cache->capacity = capacity;
+    }
+
+    slot = find_slot(cache->slots, cache->capacity, id);
+    slot->id = id;
+    slot->name = name;
+    slot->used = 1;
+    ++cache->count;
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Resolves a user id with the reentrant getpwuid_r().
+ *
+ * \param id user id.
+ * \param name receives the user name (malloc'ed) or NULL if the user does not exist.
+ *
+ * \return 0 on success, otherwise errno value of the data base query.
+ */
+static int resolve_user(const unsigned long id, char** name)
+{
+    struct passwd pwd;
+    struct passwd* found = NULL;
+    size_t size = get_nss_buffer_size(_SC_GETPW_R_SIZE_MAX);
+    char* buffer = NULL;
+    int error = 0;
+
+    *name = NULL;
+    do
+    {
+        char* bigger = (char*) realloc(buffer, size);
+
+        if (NULL == bigger)
+        {
+            free(buffer);
+            return ENOMEM;
+        }
+        buffer = bigger;
+        error = getpwuid_r((uid_t) id, &pwd, buffer, size, &found);
+        size *= 2;
+    } while (ERANGE == error);
+
+    if ((0 == error) && (NULL != found))
+    {
+        *name = strdup(found->pw_name);
+        if (NULL == *name)
+        {
+            error = ENOMEM;
+        }
+    }
+    else if ((ENOENT == error) || (ESRCH == error) || (EBADF == error) || (EPERM == error))
+    {
+        /* all of these mean "not found" according to getpwuid_r(3) */
+        error = 0;
+    }
+    free(buffer);
+
+    return error;
+}
+
+/**
+ *
+ * \brief Resolves a group id with the reentrant getgrgid_r().
+ *
+ * \param id group id.
+ * \param name receives the group name (malloc'ed) or NULL if the group does not exist.
+ *
+ * \return 0 on success, otherwise errno value of the data base query.
+ */
+static int resolve_group(const unsigned long id, char** name)
+{
+    struct group grp;
+    struct group* found = NULL;
+    size_t size = get_nss_buffer_size(_SC_GETGR_R_SIZE_MAX);
+    char* buffer = NULL;
+    int error = 0;
+
+    *name = NULL;
+    do
+    {
+        char* bigger = (char*) realloc(buffer, size);
+
+        if (NULL == bigger)
+        {
+            free(buffer);
+            return ENOMEM;
+        }
+        buffer = bigger;
+        error = getgrgid_r((gid_t) id, &grp, buffer, size, &found);
+        size *= 2;
+    } while (ERANGE == error);
+
+    if ((0 == error) && (NULL != found))
+    {
+        *name = strdup(found->gr_name);
+        if (NULL == *name)
+        {
+            error = ENOMEM;
+        }
+    }
+    else if ((ENOENT == error) || (ESRCH == error) || (EBADF == error) || (EPERM == error))
+    {
+        /* all of these mean "not found" according to getgrgid_r(3) */
+        error = 0;
+    }
+    free(buffer);
+
+    return error;
+}
+
+/**
+ *
+ * \brief Suggested buffer size for the reentrant data base functions.
+ *
+ * \param name _SC_GETPW_R_SIZE_MAX or _SC_GETGR_R_SIZE_MAX.
+ *
+ * \return buffer size in bytes.
+ */
+static size_t get_nss_buffer_size(const int name)
+{
+    long size = sysconf(name);
+
+    return (size > 0) ? (size_t) size : IDCACHE_NSS_BUFFER;
+}
+
+/**
+ *
+ * \brief Frees a cache and its names.
+ *
+ * \param cache to be freed.
+ *
+ * \return void
+ */
+static void free_cache(IdCache* cache)
+{
+    size_t i = 0;
+
+    pthread_rwlock_wrlock(&cache->lock);
+    for (i = 0; i < cache->capacity; ++i)
+    {
+        free(cache->slots[i].name);
+    }
+    free(cache->slots);
+    cache->slots = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+    pthread_rwlock_unlock(&cache->lock);
+}
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,72 @@
+/**
+ * @file idcache.h
+ * \brief User and group name cache for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _IDCACHE_H_
+#define _IDCACHE_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <sys/types.h>
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Get the name of a user id.
+ *
+ * The user data base is asked only once per user id, known and unknown ids are remembered.
+ * Can be called by several threads at the same time.
+ *
+ * \param uid user id to look up.
+ *
+ * \return name of the user, valid until idcache_free(), NULL if there is no such user.
+ */
+extern const char* idcache_user_name(const uid_t uid);
+
+/**
+ *
+ * \brief Get the name of a group id.
+ *
+ * The group data base is asked only once per group id, known and unknown ids are remembered.
+ * Can be called by several threads at the same time.
+ *
+ * \param gid group id to look up.
+ *
+ * \return name of the group, valid until idcache_free(), NULL if there is no such group.
+ */
+extern const char* idcache_group_name(const gid_t gid);
+
+/**
+ *
+ * \brief Get the number of times the user and group data bases were asked (getpwuid_r(),
+ * getgrgid_r()), i.e. the cache misses.
+ *
+ * \param users receives the number of user lookups.
+ * \param groups receives the number of group lookups.
+ *
+ * \return void
+ */
+extern void idcache_lookups(unsigned long* users, unsigned long* groups);
+
+/**
+ *
+ * \brief Frees all cached names.
+ *
+ * \return void
+ */
+extern void idcache_free(void);
+
+#endif /* _IDCACHE_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,143 @@
+/**
+ * @file latency_shim.c
+ * \brief Latency shim for myfind.
+ *
+ * LD_PRELOAD library which delays every metadata lookup like a FUSE or network file system
+ * would, to try out --prefetch on a local disk:
+ *
+ *     make latency_shim.so
+ *     MYFIND_LATENCY_US=2000 LD_PRELOAD=./latency_shim.so ./myfind DIR --prefetch 32
+ *
+ * fstatat(), lstat(), stat() and openat() sleep MYFIND_LATENCY_US microseconds (default 1000)
+ * before they are carried out. Other threads are not blocked by the delay.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Delay of a lookup if MYFIND_LATENCY_US is not set. */
+#define DEFAULT_LATENCY_US 1000
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+static void delay(void);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+int fstatat(int dir_fd, const char* path, struct stat* info, int flags)
+{
+    static int (*next)(int, const char*, struct stat*, int) = NULL;
+
+    if (NULL == next)
+    {
+        *(void**) &next = dlsym(RTLD_NEXT, "fstatat");
+    }
+    delay();
+    return next(dir_fd, path, info, flags);
+}
+
+int lstat(const char* path, struct stat* info)
+{
+    static int (*next)(const char*, struct stat*) = NULL;
+
+    if (NULL == next)
+    {
+        *(void**) &next = dlsym(RTLD_NEXT, "lstat");
+    }
+    delay();
+    return next(path, info);
+}
+
+int stat(const char* path, struct stat* info)
+{
+    static int (*next)(const char*, struct stat*) = NULL;
+
+    if (NULL == next)
+    {
+        *(void**) &next = dlsym(RTLD_NEXT, "stat");
+    }
+    delay();
+    return next(path, info);
+}
+
+int openat(int dir_fd, const char* path, int flags, ...)
+{
+    static int (*next)(int, const char*, int, ...) = NULL;
+    mode_t mode = 0;
+
+    if (NULL == next)
+    {
+        *(void**) &next = dlsym(RTLD_NEXT, "openat");
+    }
+    if (0 != (flags & O_CREAT))
+    {
+        va_list args;
+
+        va_start(args, flags);
+        mode = (mode_t) va_arg(args, int);
+        va_end(args);
+    }
+    delay();
+    return next(dir_fd, path, flags, mode);
+}
+
+/**
+ *
+ * \brief Sleeps for the configured latency of a lookup.
+ *
+ * \return void
+ */
+static void delay(void)
+{
+    static long latency = -1;
+    struct timespec duration;
+    int saved_errno = errno;
+
+    if (latency < 0)
+    {
+        const char* value = getenv("MYFIND_LATENCY_US");
+
+        latency = (NULL == value) ? DEFAULT_LATENCY_US : strtol(value, NULL, 10);
+        if (latency < 0)
+        {
+            latency = 0;
+        }
+    }
+
+    duration.tv_sec = latency / 1000000;
+    duration.tv_nsec = (latency % 1000000) * 1000;
+    while ((-1 == nanosleep(&duration, &duration)) && (EINTR == errno))
+    {
+        /* interrupted, sleep the rest */
+    }
+    errno = saved_errno;
+}
+
+/*
+ * =================================================================== eof ==
+ */
@@ -36,6 +36,23 @@
 #include <unistd.h>
 #include <limits.h>
 #include <libgen.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif /* __linux__ */
+#include "idcache.h"
+#include "output.h"
+#include "pattern.h"
+#include "uring.h"
+#include "prefetch.h"
+#include "fsindex.h"
+#include "serve.h"
+#include "table.h"
+#include "exec.h"
+#include "stats.h"
 
 /*
  * --------------------------------------------------------------- defines --
@@ -43,6 +60,79 @@
 /** DEBUG_OUTPUT 0 is without debug_print(), else debug_print() function is active. */
 #define DEBUG_OUTPUT 0
 
+/** Maximum number of worker threads accepted for -j. */
+#define MAX_WORKERS 256
+
+/** Maximum number of "{} +" commands running at the same time accepted for --exec-jobs. */
+#define MAX_EXEC_JOBS 256
+
+/** Initial depth of the directory stack of a worker. */
+#define WALK_INITIAL_DEPTH 32
+
+/** Maximum number of directory entries read ahead and stat'ed as one batch (readdir()). */
+#define DIR_BATCH_ENTRIES 4096
+
+#ifdef SYS_getdents64
+/** Directories are read with getdents64 into a large buffer instead of with readdir(). */
+#define HAVE_GETDENTS64 1
+#else /* SYS_getdents64 */
+#define HAVE_GETDENTS64 0
+#endif /* SYS_getdents64 */
+
+/** Size of the getdents64 buffer of a worker, the records of one call form a batch. */
+#define DIRENT_BUFFER_SIZE (1024 * 1024)
+
+/** Number of stat requests a worker keeps in flight with --io-uring. */
+#define STAT_RING_ENTRIES 256
+
+/** Maximum number of prefetch helpers (--prefetch). */
+#define MAX_PREFETCH 1024
+
+/** Maximum number of directories a worker keeps opened ahead (--prefetch), bounds the fds. */
+#define PREFETCH_MAX_DIRS 256
+
+/** Flags of openat() for the directories of the traversal. */
+#define DIR_OPEN_FLAGS (O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)
+
+/** Initial number of entries of a directory batch. */
+#define DIR_BATCH_INITIAL_ENTRIES 64
+
+/** Initial number of task slots of a work-stealing deque. */
+#define DEQUE_INITIAL_CAPACITY 64
+
+/** Space needed by an -ls line besides path, user and group name. */
+#define LS_LINE_RESERVE 256
+
+/** Number of minutes remembered by the -ls time cache of a worker, a power of two. */
+#define TIME_CACHE_SLOTS 64
+
+/** Length of the -ls time text "Mon dd HH:MM". */
+#define LS_TIME_LENGTH 12
+
+/** Width of the number of files of a --group-by line. */
+#define GROUP_FILES_WIDTH 10
+
+/** Width of the number of bytes of a --group-by line. */
+#define GROUP_BYTES_WIDTH 16
+
+/** Space needed by a --group-by line besides the value of the field. */
+#define GROUP_LINE_WIDTH (GROUP_FILES_WIDTH + GROUP_BYTES_WIDTH + 2)
+
+/** Size of a user or group id rendered as a number, or of a type character. */
+#define MAX_GROUP_KEY 16
+
+/** Width of the label column of the --stats report. */
+#define STATS_LABEL_WIDTH 24
+
+/** Width of a number column of the --stats report. */
+#define STATS_VALUE_WIDTH 12
+
+/** Size of an instruction rendered for the --stats report, longer patterns are cut off. */
+#define MAX_STATS_INSTRUCTION 64
+
+/** Nanoseconds per millisecond, the unit of the times of the --stats report. */
+#define NS_PER_MS 1000000.0
+
 /*
  * -------------------------------------------------------------- typedefs --
  */
@@ -63,6 +153,349 @@ typedef enum booleanEnum
     TRUE
 } boolean;
 
+/**
+ * Operation codes of the compiled predicate program.
+ */
+typedef enum opcodeEnum
+{
+    /** Filter -type, operand is the type character. */
+    OP_TYPE,
+    /** Filter -user, operand is the user id. */
+    OP_USER,
+    /** Filter -nouser. */
+    OP_NOUSER,
+    /** Filter -name, operand is the glob pattern. */
+    OP_NAME,
+    /** Filter -name-from or several -name joined by -o, operand is the set of glob patterns. */
+    OP_NAME_SET,
+    /** Filter -path, operand is the glob pattern. */
+    OP_PATH,
+    /** Action -ls. */
+    OP_LS,
+    /** Action -print. */
+    OP_PRINT,
+    /** Action -exec/-execdir, operand is the index of the command; a test when ended by ";". */
+    OP_EXEC,
+    /** Action -prune, a directory reaching it is not descended into. */
+    OP_PRUNE,
+    /** Action -quit, stops the traversal. */
+    OP_QUIT
+} Opcode;
+
+/**
+ * One instruction of the compiled predicate program, operands are decoded at compile time.
+ */
+typedef struct instructionStruct
+{
+    /** What to do. */
+    Opcode op;
+    /** An action preceded by at least one filter. */
+    boolean after_filter;
+    /** There is an -ls action at or after this instruction within its clause. */
+    boolean ls_follows;
+    /** Operand of filters with an argument. */
+    union
+    {
+        /** File type character of -type. */
+        char type;
+        /** User id of -user, resolved at compile time. */
+        uid_t uid;
+        /** Compiled pattern of -name/-path. */
+        const Pattern* pattern;
+        /** Compiled patterns of OP_NAME_SET. */
+        const PatternSet* pattern_set;
+        /** Index of the command of OP_EXEC in the program. */
+        int exec;
+    } arg;
+} Instruction;
+
+/**
+ * Instructions between two -o, evaluated like a program without -o.
+ */
+typedef struct clauseStruct
+{
+    /** Index of the first instruction. */
+    int start;
+    /** Index after the last instruction. */
+    int end;
+    /** The clause contains at least one filter. */
+    boolean has_filter;
+    /** The clause contains at least one action. */
+    boolean has_action;
+    /** The clause contains -print or -ls, not only -exec or -quit. */
+    boolean has_output;
+} Clause;
+
+/**
+ * The command line compiled into a flat instruction array, do_file() interprets it.
+ */
+typedef struct programStruct
+{
+    /** Instructions in command line order. */
+    Instruction* code;
+    /** Number of instructions. */
+    int length;
+    /** Clauses joined by -o, there is at least one. */
+    Clause* clauses;
+    /** Number of clauses. */
+    int clause_count;
+    /** Compiled patterns of -name/-path, the instructions point into it. */
+    Pattern* patterns;
+    /** Number of compiled patterns. */
+    int pattern_count;
+    /** Compiled pattern sets of OP_NAME_SET, the instructions point into it. */
+    PatternSet* pattern_sets;
+    /** Number of compiled pattern sets. */
+    int pattern_set_count;
+    /** Commands of -exec/-execdir, the instructions refer to them by index. */
+    ExecCommand* execs;
+    /** Number of commands. */
+    int exec_count;
+    /** The program contains at least one action, -prune does not count. */
+    boolean has_action;
+    /** The program contains -prune. */
+    boolean has_prune;
+    /** Initial match state, only a start path given on the command line can match. */
+    boolean initial_match;
+} Program;
+
+/**
+ * Field whose values --group-by sums up the matches for.
+ */
+typedef enum groupByEnum
+{
+    /** No --group-by, the actions print the matches. */
+    GROUP_BY_NONE,
+    /** Owner of the files. */
+    GROUP_BY_USER,
+    /** Group of the files. */
+    GROUP_BY_GROUP,
+    /** Type of the files, like -type. */
+    GROUP_BY_TYPE
+} GroupBy;
+
+/**
+ * A directory entry handed to do_file().
+ *
+ * The complete path is only built on demand (see get_entry_path()), the traversal itself works
+ * with directory file descriptors.
+ */
+typedef struct fileEntryStruct
+{
+    /** Path of the directory containing the entry. */
+    const char* dir_path;
+    /** Name of the entry within its directory (its base name). */
+    const char* name;
+    /** Complete path of the entry, NULL until built. */
+    const char* path;
+    /** Descriptor of the directory containing the entry, -1 if none is open. */
+    int dir_fd;
+} FileEntry;
+
+/**
+ * One minute of local time rendered for -ls.
+ */
+typedef struct timeCacheEntryStruct
+{
+    /** First second of the minute. */
+    time_t start;
+    /** First second after the minute, start == end marks an empty slot. */
+    time_t end;
+    /** The minute rendered as "Mon dd HH:MM". */
+    char text[LS_TIME_LENGTH];
+} TimeCacheEntry;
+
+#if HAVE_GETDENTS64
+/**
+ * Directory record as returned by getdents64.
+ */
+typedef struct linuxDirent64Struct
+{
+    /** Inode number. */
+    uint64_t d_ino;
+    /** Offset of the next record. */
+    int64_t d_off;
+    /** Length of this record. */
+    unsigned short d_reclen;
+    /** File type. */
+    unsigned char d_type;
+    /** Name, '\0' terminated. */
+    char d_name[];
+} LinuxDirent64;
+#endif /* HAVE_GETDENTS64 */
+
+/**
+ * A directory entry read ahead, with its file information.
+ */
+typedef struct batchEntryStruct
+{
+    /** Inode number as reported by the directory. */
+    ino_t ino;
+    /** Offset of the name in the names of the batch. */
+    size_t name_offset;
+    /** File type as reported by the directory (d_type), DT_UNKNOWN if not known. */
+    unsigned char type;
+    /** 0 if info is valid, else errno of fstatat(). */
+    int error;
+    /** File information, only st_mode is valid when the predicates do not need more. */
+    StatType info;
+    /** Lookup by the prefetch helpers (--prefetch). */
+    PrefetchRequest lookup;
+} BatchEntry;
+
+/**
+ * Entries read ahead from a directory. They are stat'ed together and examined in readdir order.
+ */
+typedef struct dirBatchStruct
+{
+    /** Entries of the batch. */
+    BatchEntry* entries;
+    /** Number of entries. */
+    size_t count;
+    /** Index of the next entry to be examined. */
+    size_t next;
+    /** Number of entries the batch has room for. */
+    size_t capacity;
+    /** Names of the entries, '\0' terminated one after the other. */
+    char* names;
+    /** Number of bytes used in names. */
+    size_t names_length;
+    /** Size of names. */
+    size_t names_capacity;
+    /** Index of the next entry whose directory may be opened ahead (--prefetch). */
+    size_t open_next;
+    /** Number of directories of the batch opened ahead and not yet entered (--prefetch). */
+    size_t opened_ahead;
+    /** The directory has been read completely. */
+    boolean end;
+} DirBatch;
+
+/**
+ * An entry of a batch to be stat'ed, sorted by inode number with --inode-order.
+ */
+typedef struct statOrderStruct
+{
+    /** Inode number of the entry. */
+    ino_t ino;
+    /** Index of the entry in the batch. */
+    size_t index;
+} StatOrder;
+
+/**
+ * An open directory on the stack of the iterative traversal.
+ */
+typedef struct walkFrameStruct
+{
+    /** Stream of the directory, not used with getdents64. */
+    DIR* handle;
+    /** File descriptor of the directory, its entries are examined relative to it. */
+    int fd;
+    /** Length of the path of the directory in the path arena. */
+    size_t path_length;
+    /** Depth of the directory below the start path, 0 for the start path. */
+    int level;
+    /** Index record of the directory (--build-index). */
+    uint32_t record;
+    /** Record of the directory in the previous index, INDEX_NO_RECORD if none. */
+    uint32_t old_record;
+    /** The directory is unchanged since the previous index, its entries are taken from there. */
+    boolean reuse;
+    /** Entries read ahead, kept while the subdirectories are traversed. */
+    DirBatch batch;
+} WalkFrame;
+
+/**
+ * A directory which still has to be traversed by one of the workers.
+ */
+typedef struct dirTaskStruct
+{
+    /** Path of the directory, owned by the task. */
+    char* path;
+    /** Depth of the directory below the start path. */
+    int level;
+} DirTask;
+
+/**
+ * Work-stealing deque of directory tasks.
+ *
+ * The owning worker pushes and pops at the bottom (LIFO, depth first and cache friendly),
+ * idle workers steal from the top (FIFO, the biggest subtrees).
+ */
+typedef struct taskDequeStruct
+{
+    /** Protects all members below. */
+    pthread_mutex_t lock;
+    /** Ring buffer of tasks. */
+    DirTask* tasks;
+    /** Number of slots in tasks. */
+    size_t capacity;
+    /** Index of the oldest task (top). */
+    size_t head;
+    /** Number of tasks stored. */
+    size_t count;
+} TaskDeque;
+
+/**
+ * Per thread state: every worker has its own buffers and its own deque.
+ */
+typedef struct workerContextStruct
+{
+    /** Buffer for reading current directory/file. */
+    char* path_buffer;
+    /** Size of path_buffer, at least the maximum path length, grown for deeper paths. */
+    size_t path_buffer_capacity;
+    /** Buffer for getting the base name of a given directory. */
+    char* basename_buffer;
+    /** Print buffer for printout on stderr. */
+    char* print_buffer;
+    /** Buffer for printout on stdout. */
+    OutputBuffer output;
+    /** Recently rendered modification times for -ls, indexed by minute. */
+    TimeCacheEntry time_cache[TIME_CACHE_SLOTS];
+    /** Stack of the directories being traversed, reused for every task. */
+    WalkFrame* frames;
+    /** Number of frames the stack has room for. */
+    size_t frame_capacity;
+    /** Path of the directory on top of the stack, components are appended and cut off in place. */
+    char* path_arena;
+    /** Size of path_arena. */
+    size_t arena_capacity;
+    /** Entries of a batch to be stat'ed in this order (--inode-order, --io-uring). */
+    StatOrder* stat_order;
+    /** Number of entries stat_order has room for. */
+    size_t stat_order_capacity;
+    /** Requests for the io_uring, one per entry of stat_order. */
+    StatRequest* stat_requests;
+    /** Number of requests stat_requests has room for. */
+    size_t stat_request_capacity;
+    /** io_uring of the worker (--io-uring). */
+    StatRing ring;
+    /** ring is set up. */
+    boolean ring_ready;
+    /** io_uring is not available or failed, stat synchronously. */
+    boolean ring_failed;
+    /** Buffer for getdents64, DIRENT_BUFFER_SIZE. */
+    char* dirent_buffer;
+    /** Number of directories opened ahead on the whole stack (--prefetch). */
+    size_t opened_ahead;
+    /** Paths collected for every "{} +" command of the program, NULL until the first one. */
+    ExecBatch* exec_batches;
+    /** Number of exec_batches. */
+    int exec_batch_count;
+    /** -prune was reached for the file just examined, its subtree is skipped. */
+    boolean prune;
+    /** The file just examined already counts against -limit. */
+    boolean counted;
+    /** Counters of --stats, added to those of the main thread when the worker is done. */
+    StatsCounters stats;
+    /** Index of the worker in the pool. */
+    int id;
+    /** Thread handle of the worker. */
+    pthread_t thread;
+    /** Directories waiting to be traversed. */
+    TaskDeque deque;
+} WorkerContext;
+
 /*
  * --------------------------------------------------------------- globals --
  */
@@ -71,11 +504,41 @@ typedef enum booleanEnum
  * --------------------------------------------------------------- static --
  */
 
-/** Buffer for reading current directory/file. */
-static char* spath_buffer = NULL;
+/** Context of the main thread, used for argument checking and sequential traversal. */
+static WorkerContext smain_context;
+
+/** Context of the calling thread, holds the path, base name and print buffers. */
+static _Thread_local WorkerContext* scurrent_context = NULL;
+
+/** Worker contexts for -j. */
+static WorkerContext* sworkers = NULL;
+
+/** Number of workers traversing directories, 1 means sequential recursion. */
+static int sworker_count = 1;
 
-/** Buffer for getting the base name of a given directory. */
-static char* sbasename_buffer = NULL;
+/** Tasks pushed but not completely processed yet, the traversal is done at 0. */
+static atomic_long stasks_pending = 0;
+
+/** Tasks currently sitting in any deque. */
+static atomic_long stasks_queued = 0;
+
+/** Result of the parallel traversal, EXIT_FAILURE once a worker failed. */
+static atomic_int sworker_result = EXIT_SUCCESS;
+
+/** Set by -quit and once -limit is reached, every worker leaves its traversal. */
+static atomic_int sstopped = FALSE;
+
+/** Files acted upon so far, for -limit. */
+static atomic_long smatches = 0;
+
+/** Protects sidle_workers and is used with swork_available. */
+static pthread_mutex_t sidle_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Signalled when a task has been queued or the traversal is finished. */
+static pthread_cond_t swork_available = PTHREAD_COND_INITIALIZER;
+
+/** Number of workers sleeping on swork_available. */
+static int sidle_workers = 0;
 
 /** Maximum path length of file system. */
 static long int smax_path = 0;
@@ -86,18 +549,32 @@ static const char* sprogram_arg0 = NULL;
 /** Maximum buffer size for print buffer.*/
 static const long MAX_PRINT_BUFFER = 1000;
 
-/** Print buffer for printout on stderr. */
-static char* sprint_buffer = NULL;
-
 /** Want to convert user id number into decimal number. */
 static const int USERID_BASE = 10;
 
+/** Want to convert the number of jobs into decimal number. */
+static const int JOBS_BASE = 10;
+
+/** Want to convert -maxdepth and -mindepth into decimal number. */
+static const int DEPTH_BASE = 10;
+
+/** Want to convert -limit into decimal number. */
+static const int LIMIT_BASE = 10;
+
+/** Month names of the -ls time, as strftime() "%b" in the C locale. */
+static const char* const MONTH_NAMES[] =
+{ "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
 /** User text string for supported parameter user. */
 static const char* PARAM_STR_USER = "-user";
 /** User text string for supported parameter nouser. */
 static const char* PARAM_STR_NOUSER = "-nouser";
 /** User text string for supported parameter name. */
 static const char* PARAM_STR_NAME = "-name";
+/** User text string for supported parameter name-from (file with one pattern per line). */
+static const char* PARAM_STR_NAME_FROM = "-name-from";
+/** User text string for the operator or. */
+static const char* PARAM_STR_OR = "-o";
 /** Output string for supported parameter path. */
 static const char* PARAM_STR_PATH = "-path";
 /** User text for supported parameter type. */
@@ -108,6 +585,107 @@ static const char* PARAM_STR_TYPE_VALS = "bcdflps";
 static const char* PARAM_STR_LS = "-ls";
 /** User text for supported parameter user. */
 static const char* PARAM_STR_PRINT = "-print";
+/** User text for supported parameter prune (do not descend into a matching directory). */
+static const char* PARAM_STR_PRUNE = "-prune";
+/** User text for supported parameter maxdepth (deepest level examined). */
+static const char* PARAM_STR_MAXDEPTH = "-maxdepth";
+/** User text for supported parameter mindepth (shallowest level examined). */
+static const char* PARAM_STR_MINDEPTH = "-mindepth";
+/** User text for supported parameter quit (stop at the first file reaching it). */
+static const char* PARAM_STR_QUIT = "-quit";
+/** User text for supported parameter limit (stop after that many files acted upon). */
+static const char* PARAM_STR_LIMIT = "-limit";
+/** User text for supported parameter exec. */
+static const char* PARAM_STR_EXEC = "-exec";
+/** User text for supported parameter execdir (exec in the directory of the file). */
+static const char* PARAM_STR_EXECDIR = "-execdir";
+/** User text for the end of an -exec command run once per file. */
+static const char* PARAM_STR_EXEC_END = ";";
+/** User text for the end of an -exec command run with as many files as fit. */
+static const char* PARAM_STR_EXEC_BATCH_END = "+";
+/** User text for the placeholder of the file in an -exec command. */
+static const char* PARAM_STR_EXEC_PLACEHOLDER = "{}";
+/** User text for supported parameter exec-jobs ("{} +" commands running at the same time). */
+static const char* PARAM_STR_EXEC_JOBS = "--exec-jobs";
+/** User text for supported parameter jobs (number of worker threads). */
+static const char* PARAM_STR_JOBS = "-j";
+/** User text for supported parameter inode-order (stat in inode order). */
+static const char* PARAM_STR_INODE_ORDER = "--inode-order";
+/** User text for supported parameter io-uring (stat batches with io_uring). */
+static const char* PARAM_STR_IO_URING = "--io-uring";
+/** User text for supported parameter prefetch (lookups in flight). */
+static const char* PARAM_STR_PREFETCH = "--prefetch";
+/** User text for supported parameter build-index (save the tree to an index). */
+static const char* PARAM_STR_BUILD_INDEX = "--build-index";
+/** User text for supported parameter index (examine an index). */
+static const char* PARAM_STR_INDEX = "--index";
+/** User text for supported parameter serve (keep the tree current and serve it). */
+static const char* PARAM_STR_SERVE = "--serve";
+/** User text for supported parameter group-by (sum up the matches per value of a field). */
+static const char* PARAM_STR_GROUP_BY = "--group-by";
+/** User text for supported parameter stats (report counters and timings on stderr). */
+static const char* PARAM_STR_STATS = "--stats";
+
+/** The command line compiled by main(). */
+static Program sprogram;
+
+/** Traversal plan: some predicate or action needs the inode data, d_type is not sufficient. */
+static boolean sneed_stat = FALSE;
+
+/** Traversal plan: stat the entries of a directory in inode order (--inode-order). */
+static boolean sinode_order = FALSE;
+
+/** Traversal plan: stat the entries of a directory batch with io_uring (--io-uring). */
+static boolean suse_uring = FALSE;
+
+/** Traversal plan: number of prefetch helpers, 0 for none (--prefetch). */
+static int sprefetch = 0;
+
+/** Deepest level below the start path which is examined (-maxdepth), INT_MAX for no limit. */
+static int smax_depth = INT_MAX;
+
+/** Shallowest level below the start path which is examined (-mindepth), 0 for the start path. */
+static int smin_depth = 0;
+
+/** Number of files acted upon before the traversal stops (-limit), 0 for no limit. */
+static long slimit = 0;
+
+/** Traversal plan: deepest level read from the directories, an index gets the whole tree. */
+static int swalk_depth = INT_MAX;
+
+/** Index file to be built instead of examining the files (--build-index), NULL if none. */
+static const char* sbuild_index = NULL;
+
+/** Socket to serve the tree on after the traversal (--serve), NULL if none. */
+static const char* sserve_socket = NULL;
+
+/** Field the matches are summed up for (--group-by), GROUP_BY_NONE to print them. */
+static GroupBy sgroup_by = GROUP_BY_NONE;
+
+/** The traversal records the tree instead of examining the files (--build-index, --serve,
+ * --group-by). */
+static boolean srecord_tree = FALSE;
+
+/** Count and time the traversal and report it on stderr at the end (--stats). */
+static boolean sstats = FALSE;
+
+/** Start of the traversal for the wall time of --stats. */
+static uint64_t sstats_start = 0;
+
+/** Records of the traversal for --build-index and --serve. */
+static IndexWriter sindex_writer;
+
+/** Previous version of the --build-index file, the listings of unchanged directories are reused. */
+static IndexFile sold_index;
+
+/** sold_index is loaded. */
+static boolean sold_index_ready = FALSE;
+
+/** Index file or --serve socket to be examined instead of the file system (--index). */
+static const char* sindex_file = NULL;
+
+/** Traversal plan: StatFields the predicates and actions need. */
+static int sstat_fields = STAT_FIELDS_TYPE;
 
 /** The user has given a directory after the program name. */
 static int parameter_directory_given = TRUE;
@@ -129,35 +707,98 @@ inline static int get_max_path_length(void);
 inline static char* get_print_buffer(void);
 inline static const char* get_program_argument_0(void);
 inline static char* get_path_buffer(void);
+inline static char* get_base_name_buffer(void);
+inline static OutputBuffer* get_output_buffer(void);
 
 static void print_usage(void);
 static void print_error(const char* message);
 static int init(const char** program_args);
 static void cleanup(boolean exit);
-
-static int do_file(const char* file_name, StatType* file_info, const char* const* params);
-static int do_dir(const char* dir_name, const char* const* params);
-
-static boolean user_exist(const char* user_name, const boolean search_for_uid);
+static int init_context(WorkerContext* context, const int id);
+static void free_context(WorkerContext* context);
+
+static Instruction* emit_instruction(const Opcode op, const char* text);
+static const Pattern* compile_pattern(const char* source, const int flags);
+static PatternSet* new_pattern_set(void);
+static void read_name_patterns(const char* file_name, PatternSet* set);
+static void start_clause(void);
+static void merge_name_clauses(void);
+static boolean is_name_clause(const Clause* clause);
+static void optimize_program(void);
+static void free_program(void);
+static int get_filter_cost(const Opcode op);
+static boolean do_exec(const int exec, FileEntry* entry);
+static boolean count_match(void);
+static void stop_traversal(void);
+static int finish_exec(WorkerContext* context);
+
+static int do_file(FileEntry* entry, StatType* file_info);
+static boolean do_clause(const Clause* clause, FileEntry* entry, StatType* file_info);
+static int do_dir(const int parent_fd, const char* dir_name, const char* dir_path,
+        const int level);
+static boolean open_frame(WalkFrame* frame, const int dir_fd, const size_t path_length);
+static void close_frame(WalkFrame* frame);
+static int open_dir(WorkerContext* context, WalkFrame* frame, BatchEntry* batch_entry);
+static void prefetch_dirs(WorkerContext* context, WalkFrame* frame);
+static boolean read_batch(WorkerContext* context, WalkFrame* frame);
+static boolean reuse_batch(WalkFrame* frame);
+static void match_old_dir(WalkFrame* frame, const uint32_t old_record, const StatType* file_info);
+static boolean add_to_batch(DirBatch* batch, const ino_t ino, const unsigned char type,
+        const char* name);
+static void stat_batch(WorkerContext* context, WalkFrame* frame);
+static boolean stat_batch_ring(WorkerContext* context, WalkFrame* frame, const size_t pending);
+static void stat_batch_prefetch(WorkerContext* context, WalkFrame* frame, const size_t pending);
+static void stat_entry(const WalkFrame* frame, BatchEntry* batch_entry);
+static int compare_inodes(const void* left, const void* right);
+static boolean reserve_walk(WorkerContext* context, const size_t depth, const size_t path_length);
+static const char* get_entry_path(FileEntry* entry);
+
+static boolean add_record(const uint32_t parent, const char* name, const StatType* file_info,
+        uint32_t* record);
+static int query_index(const char* file_name);
+static int query_table(const IndexRecord* records, const size_t count, const char* names,
+        const uint32_t flags);
+static boolean select_clause(const FileTable* table, const Clause* clause, const size_t first,
+        uint64_t* bitmap);
+static int select_depth(const FileTable* table, uint64_t* bitmap);
+static void print_groups(const TableGroup* groups, const size_t count);
+static void print_stats(void);
+static void format_instruction(const Instruction* instruction, char* buffer, const size_t size);
+static uint64_t start_phase(void);
+static void end_phase(uint64_t* phase, const uint64_t started);
+static void load_old_index(const char* start_path, const uint32_t flags);
+
+static int run_workers(const char* start_dir);
+static int traverse(const char* start_dir);
+static void* worker_main(void* arg);
+static boolean schedule_dir(char* dir_name, const int level);
+static boolean next_task(WorkerContext* context, DirTask* task);
+static boolean deque_push(TaskDeque* deque, const DirTask* task);
+static boolean deque_pop(TaskDeque* deque, DirTask* task);
+static boolean deque_steal(TaskDeque* deque, DirTask* task);
+
+static boolean resolve_user(const char* user, uid_t* uid);
 static boolean has_no_user(StatType* file_info);
 
 static char get_file_type(const StatType* file_info);
+static mode_t get_type_mode(const char type);
 
-static boolean filter_name(const char* path_to_examine, const int current_param,
-        const char* const* params);
-static boolean filter_path(const char* path_to_examine, const int current_param,
-        const char* const* params);
+static boolean filter_name(const char* name_to_examine, const Pattern* pattern);
+static boolean filter_name_set(const char* name_to_examine, const PatternSet* set);
+static boolean filter_path(const char* path_to_examine, const Pattern* pattern);
 static boolean filter_nouser(StatType* file_info);
-static boolean filter_user(const int current_param, const char* const* params, StatType* file_info);
-static boolean filter_type(const int current_param, const char* const* params, StatType* file_info);
+static boolean filter_user(const uid_t uid, StatType* file_info);
+static boolean filter_type(const char type, StatType* file_info);
 
-static void print_file_change_time(const StatType* file_info);
-static void print_file_permissions(const StatType* file_info);
-static void print_user_group(const StatType* file_info);
+static char* print_file_change_time(char* dest, const StatType* file_info);
+static char* print_file_permissions(char* dest, const StatType* file_info);
+static char* print_user_group(char* dest, const StatType* file_info, const char* user_name,
+        const char* group_name);
 
 static void print_detail_ls(const char* file_path, StatType* file_info);
 static void print_detail_print(const char* file_path);
-static void combine_ls(const StatType* file_info);
+static char* combine_ls(char* dest, const StatType* file_info, const char* user_name,
+        const char* group_name);
 
 /**
  *
@@ -182,6 +823,7 @@ int main(int argc, const char* argv[])
     StatType stbuf;
     int current_argument = 1; /* the first argument is the program name anyway */
     int test_char = '\0';
+    uid_t uid = 0;
 
     result = init(argv);
     if (EXIT_SUCCESS != result)
@@ -197,14 +839,39 @@ int main(int argc, const char* argv[])
     test_char = *argv[1];
     path_given = (test_char == '-') ? FALSE : TRUE;
 
-    /* check the input arguments first */
+    /* the program has at most one instruction per argument */
+    sprogram.code = (Instruction*) malloc(argc * sizeof(Instruction));
+    sprogram.clauses = (Clause*) malloc(argc * sizeof(Clause));
+    sprogram.patterns = (Pattern*) malloc(argc * sizeof(Pattern));
+    sprogram.pattern_sets = (PatternSet*) malloc(argc * sizeof(PatternSet));
+    sprogram.execs = (ExecCommand*) malloc(argc * sizeof(ExecCommand));
+    if ((NULL == sprogram.code) || (NULL == sprogram.clauses) || (NULL == sprogram.patterns)
+            || (NULL == sprogram.pattern_sets) || (NULL == sprogram.execs))
+    {
+        print_error("malloc() failed: Out of memory.");
+        cleanup(TRUE);
+    }
+    sprogram.initial_match = path_given;
+    start_clause();
+
+    /* check the input arguments first and compile them */
     while (current_argument < argc)
     {
         if (0 == strcmp(PARAM_STR_USER, argv[current_argument]))
         {
             /* found -user */
+            sneed_stat = TRUE;
+            sstat_fields |= STAT_FIELDS_OWNER;
             if ((current_argument + 1) < argc)
             {
+                if (!resolve_user(argv[current_argument + 1], &uid))
+                {
+                    snprintf(get_print_buffer(), MAX_PRINT_BUFFER,
+                            "`%s' is not the name of a known user", argv[current_argument + 1]);
+                    print_error(get_print_buffer());
+                    cleanup(TRUE);
+                }
+                emit_instruction(OP_USER, NULL)->arg.uid = uid;
                 current_argument += 2;
                 continue;
             }
@@ -218,26 +885,76 @@ int main(int argc, const char* argv[])
         if (0 == strcmp(PARAM_STR_NOUSER, argv[current_argument]))
         {
             /* found -nouser */
+            sneed_stat = TRUE;
+            sstat_fields |= STAT_FIELDS_OWNER;
+            emit_instruction(OP_NOUSER, NULL);
             current_argument += 1;
             continue;
         }
         if (0 == strcmp(PARAM_STR_LS, argv[current_argument]))
         {
             /* found -ls */
+            sneed_stat = TRUE;
+            sstat_fields |= STAT_FIELDS_ALL;
+            emit_instruction(OP_LS, NULL);
             current_argument += 1;
             continue;
         }
         if (0 == strcmp(PARAM_STR_PRINT, argv[current_argument]))
         {
             /* found -print */
+            emit_instruction(OP_PRINT, NULL);
             current_argument += 1;
             continue;
         }
+        if (0 == strcmp(PARAM_STR_PRUNE, argv[current_argument]))
+        {
+            /* found -prune */
+            emit_instruction(OP_PRUNE, NULL);
+            current_argument += 1;
+            continue;
+        }
+        if (0 == strcmp(PARAM_STR_QUIT, argv[current_argument]))
+        {
+            /* found -quit */
+            emit_instruction(OP_QUIT, NULL);
+            current_argument += 1;
+            continue;
+        }
+        if ((0 == strcmp(PARAM_STR_EXEC, argv[current_argument]))
+                || (0 == strcmp(PARAM_STR_EXECDIR, argv[current_argument])))
+        {
+            /* found -exec or -execdir, the command ends with ";" or with "{} +" */
+            ExecCommand* command = &sprogram.execs[sprogram.exec_count];
+            int end = current_argument + 1;
+
+            while ((end < argc) && (0 != strcmp(PARAM_STR_EXEC_END, argv[end]))
+                    && ((0 != strcmp(PARAM_STR_EXEC_BATCH_END, argv[end]))
+                            || (0 != strcmp(PARAM_STR_EXEC_PLACEHOLDER, argv[end - 1]))))
+            {
+                ++end;
+            }
+            command->args = &argv[current_argument + 1];
+            command->batch = (end < argc) && (0 == strcmp(PARAM_STR_EXEC_BATCH_END, argv[end]));
+            command->count = end - current_argument - 1 - command->batch;
+            command->in_dir = (0 == strcmp(PARAM_STR_EXECDIR, argv[current_argument]));
+            if ((end >= argc) || (command->count < 1))
+            {
+                snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "Missing argument to `%s'.",
+                        argv[current_argument]);
+                print_error(get_print_buffer());
+                cleanup(TRUE);
+            }
+            emit_instruction(OP_EXEC, NULL)->arg.exec = sprogram.exec_count++;
+            current_argument = end + 1;
+            continue;
+        }
         if (0 == strcmp(PARAM_STR_NAME, argv[current_argument]))
         {
             /* found -name */
             if (argc > (current_argument + 1))
             {
+                emit_instruction(OP_NAME, argv[current_argument + 1]);
                 current_argument += 2;
                 continue;
             }
@@ -248,11 +965,46 @@ int main(int argc, const char* argv[])
             }
         }
 
+        if (0 == strcmp(PARAM_STR_NAME_FROM, argv[current_argument]))
+        {
+            /* found -name-from */
+            if (argc > (current_argument + 1))
+            {
+                PatternSet* set = new_pattern_set();
+
+                read_name_patterns(argv[current_argument + 1], set);
+                emit_instruction(OP_NAME_SET, NULL)->arg.pattern_set = set;
+                current_argument += 2;
+                continue;
+            }
+            else
+            {
+                print_error("Missing argument to `-name-from'.");
+                cleanup(TRUE);
+            }
+        }
+
+        if (0 == strcmp(PARAM_STR_OR, argv[current_argument]))
+        {
+            /* found -o */
+            const Clause* clause = &sprogram.clauses[sprogram.clause_count - 1];
+
+            if (clause->start == clause->end)
+            {
+                print_error("Missing expression before `-o'.");
+                cleanup(TRUE);
+            }
+            start_clause();
+            current_argument += 1;
+            continue;
+        }
+
         if (0 == strcmp(PARAM_STR_PATH, argv[current_argument]))
         {
             /* found -path */
             if (argc > (current_argument + 1))
             {
+                emit_instruction(OP_PATH, argv[current_argument + 1]);
                 current_argument += 2;
                 continue;
             }
@@ -287,6 +1039,7 @@ int main(int argc, const char* argv[])
                     print_error(get_print_buffer());
                     return EXIT_FAILURE;
                 }
+                emit_instruction(OP_TYPE, next_argument);
                 current_argument += 2;
                 continue;
             }
@@ -297,429 +1050,3489 @@ int main(int argc, const char* argv[])
             }
         }
 
-        if (current_argument > 1)
+        if (0 == strcmp(PARAM_STR_INODE_ORDER, argv[current_argument]))
         {
-            /* we have an unknown option */
-            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "Invalid predicate `%s'.",
-                    argv[current_argument]);
-            print_error(get_print_buffer());
-            cleanup(TRUE);
+            /* found --inode-order */
+            sinode_order = TRUE;
+            current_argument += 1;
+            continue;
         }
-        ++current_argument;
-    }
 
-    /* determine the directory for start */
-    get_path_buffer()[0] = '\0';
-    start_dir = (char*) malloc(get_max_path_length() * sizeof(char));
-    if (NULL == start_dir)
-    {
-        free(start_dir);
-        start_dir = NULL;
-        print_error("malloc() failed: Out of memory.");
-        cleanup(TRUE);
-    }
+        if (0 == strcmp(PARAM_STR_STATS, argv[current_argument]))
+        {
+            /* found --stats */
+            sstats = TRUE;
+            current_argument += 1;
+            continue;
+        }
 
-    /* build complete path to file (DIR/FILE) */
-    snprintf(get_path_buffer(), get_max_path_length(), "%s", argv[1]);
+        if (0 == strcmp(PARAM_STR_IO_URING, argv[current_argument]))
+        {
+            /* found --io-uring */
+            suse_uring = TRUE;
+            current_argument += 1;
+            continue;
+        }
 
-    parameter_directory_given = TRUE;
-    /*get information about the file and catch errors*/
-    if (!path_given)
-    {
-        /* no search path defined - we set it to work directory and start */
-        parameter_directory_given = FALSE;
-        result = do_dir(".", argv);
-    }
-    else if (-1 != lstat(get_path_buffer(), &stbuf))
-    {
-        /*search path defined */
-        result = do_file(argv[1], &stbuf, argv);
-        if (S_ISDIR(stbuf.st_mode))
+        if (0 == strcmp(PARAM_STR_PREFETCH, argv[current_argument]))
         {
-            found_dir = get_path_buffer();
-            strcpy(start_dir, found_dir);
-            /* this condition should not happen, but its better to be safe */
-            if (NULL == found_dir)
+            /* found --prefetch */
+            if (argc > (current_argument + 1))
             {
-                /* use current directory */
-                parameter_directory_given = FALSE;
-                strcpy(start_dir, ".");
+                char* end_ptr = NULL;
+                long helpers = 0;
+
+                errno = 0;
+                helpers = strtol(argv[current_argument + 1], &end_ptr, JOBS_BASE);
+                if ((0 != errno) || ('\0' != *end_ptr) || (helpers < 0)
+                        || (helpers > MAX_PREFETCH))
+                {
+                    snprintf(get_print_buffer(), MAX_PRINT_BUFFER,
+                            "Argument of --prefetch must be a number between 0 and %d.",
+                            MAX_PREFETCH);
+                    print_error(get_print_buffer());
+                    cleanup(TRUE);
+                }
+                sprefetch = (int) helpers;
+                current_argument += 2;
+                continue;
+            }
+            else
+            {
+                print_error("Missing argument to `--prefetch'.");
+                cleanup(TRUE);
             }
-            result = do_dir(start_dir, argv);
         }
-    }
-
-    /* cleanup */
-    free(start_dir);
-    start_dir = NULL;
-    cleanup(FALSE);
 
-    return result;
-}
+        if (0 == strcmp(PARAM_STR_GROUP_BY, argv[current_argument]))
+        {
+            /* found --group-by */
+            if (argc > (current_argument + 1))
+            {
+                const char* field = argv[current_argument + 1];
 
-#if DEBUG_OUTPUT != 0
-/**
- *
- * \brief debug_output prints debug messages.
- *
- * Does not append \n to message output.
- *
- * \param message output on stdout.
- * \return void
- *
- */
-void debug_print(const char* message)
-{
-    int written = 0;
+                if (0 == strcmp("user", field))
+                {
+                    sgroup_by = GROUP_BY_USER;
+                }
+                else if (0 == strcmp("group", field))
+                {
+                    sgroup_by = GROUP_BY_GROUP;
+                }
+                else if (0 == strcmp("type", field))
+                {
+                    sgroup_by = GROUP_BY_TYPE;
+                }
+                else
+                {
+                    print_error("Argument of --group-by must be `user', `group' or `type'.");
+                    cleanup(TRUE);
+                }
+                current_argument += 2;
+                continue;
+            }
+            else
+            {
+                print_error("Missing argument to `--group-by'.");
+                cleanup(TRUE);
+            }
+        }
 
-    written = printf("DGB: %s", message);
-    if (written < 0)
-    {
-        fprintf(stderr, "DBG: debug_print() failed.");
-    }
+        if ((0 == strcmp(PARAM_STR_BUILD_INDEX, argv[current_argument]))
+                || (0 == strcmp(PARAM_STR_INDEX, argv[current_argument]))
+                || (0 == strcmp(PARAM_STR_SERVE, argv[current_argument])))
+        {
+            /* found --build-index, --index or --serve */
+            if (argc > (current_argument + 1))
+            {
+                if (0 == strcmp(PARAM_STR_INDEX, argv[current_argument]))
+                {
+                    sindex_file = argv[current_argument + 1];
+                }
+                else if (0 == strcmp(PARAM_STR_SERVE, argv[current_argument]))
+                {
+                    sserve_socket = argv[current_argument + 1];
+                }
+                else
+                {
+                    sbuild_index = argv[current_argument + 1];
+                }
+                current_argument += 2;
+                continue;
+            }
+            else
+            {
+                snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "Missing argument to `%s'.",
+                        argv[current_argument]);
+                print_error(get_print_buffer());
+                cleanup(TRUE);
+            }
+        }
+
+        if ((0 == strcmp(PARAM_STR_MAXDEPTH, argv[current_argument]))
+                || (0 == strcmp(PARAM_STR_MINDEPTH, argv[current_argument])))
+        {
+            /* found -maxdepth or -mindepth, they apply to the whole program */
+            if (argc > (current_argument + 1))
+            {
+                char* end_ptr = NULL;
+                long levels = 0;
+
+                errno = 0;
+                levels = strtol(argv[current_argument + 1], &end_ptr, DEPTH_BASE);
+                if ((0 != errno) || ('\0' != *end_ptr) || (levels < 0) || (levels > INT_MAX))
+                {
+                    snprintf(get_print_buffer(), MAX_PRINT_BUFFER,
+                            "Argument of %s must be a non-negative number.",
+                            argv[current_argument]);
+                    print_error(get_print_buffer());
+                    cleanup(TRUE);
+                }
+                if (0 == strcmp(PARAM_STR_MAXDEPTH, argv[current_argument]))
+                {
+                    smax_depth = (int) levels;
+                }
+                else
+                {
+                    smin_depth = (int) levels;
+                }
+                current_argument += 2;
+                continue;
+            }
+            else
+            {
+                snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "Missing argument to `%s'.",
+                        argv[current_argument]);
+                print_error(get_print_buffer());
+                cleanup(TRUE);
+            }
+        }
+
+        if (0 == strcmp(PARAM_STR_LIMIT, argv[current_argument]))
+        {
+            /* found -limit */
+            if (argc > (current_argument + 1))
+            {
+                char* end_ptr = NULL;
+
+                errno = 0;
+                slimit = strtol(argv[current_argument + 1], &end_ptr, LIMIT_BASE);
+                if ((0 != errno) || ('\0' != *end_ptr) || (slimit < 1))
+                {
+                    print_error("Argument of -limit must be a positive number.");
+                    cleanup(TRUE);
+                }
+                current_argument += 2;
+                continue;
+            }
+            else
+            {
+                print_error("Missing argument to `-limit'.");
+                cleanup(TRUE);
+            }
+        }
+
+        if (0 == strcmp(PARAM_STR_EXEC_JOBS, argv[current_argument]))
+        {
+            /* found --exec-jobs */
+            if (argc > (current_argument + 1))
+            {
+                char* end_ptr = NULL;
+                long jobs = 0;
+
+                errno = 0;
+                jobs = strtol(argv[current_argument + 1], &end_ptr, JOBS_BASE);
+                if ((0 != errno) || ('\0' != *end_ptr) || (jobs < 1) || (jobs > MAX_EXEC_JOBS))
+                {
+                    snprintf(get_print_buffer(), MAX_PRINT_BUFFER,
+                            "Argument of --exec-jobs must be a number between 1 and %d.",
+                            MAX_EXEC_JOBS);
+                    print_error(get_print_buffer());
+                    cleanup(TRUE);
+                }
+                exec_init((int) jobs);
+                current_argument += 2;
+                continue;
+            }
+            else
+            {
+                print_error("Missing argument to `--exec-jobs'.");
+                cleanup(TRUE);
+            }
+        }
+
+        if (0 == strcmp(PARAM_STR_JOBS, argv[current_argument]))
+        {
+            /* found -j */
+            if (argc > (current_argument + 1))
+            {
+                char* end_ptr = NULL;
+                long jobs = 0;
+
+                errno = 0;
+                jobs = strtol(argv[current_argument + 1], &end_ptr, JOBS_BASE);
+                if ((0 != errno) || ('\0' != *end_ptr) || (jobs < 1) || (jobs > MAX_WORKERS))
+                {
+                    snprintf(get_print_buffer(), MAX_PRINT_BUFFER,
+                            "Argument of -j must be a number between 1 and %d.", MAX_WORKERS);
+                    print_error(get_print_buffer());
+                    cleanup(TRUE);
+                }
+                sworker_count = (int) jobs;
+                current_argument += 2;
+                continue;
+            }
+            else
+            {
+                print_error("Missing argument to `-j'.");
+                cleanup(TRUE);
+            }
+        }
+
+        if (current_argument > 1)
+        {
+            /* we have an unknown option */
+            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "Invalid predicate `%s'.",
+                    argv[current_argument]);
+            print_error(get_print_buffer());
+            cleanup(TRUE);
+        }
+        ++current_argument;
+    }
+    if ((sprogram.clause_count > 1)
+            && (sprogram.clauses[sprogram.clause_count - 1].start == sprogram.length))
+    {
+        print_error("Missing expression after `-o'.");
+        cleanup(TRUE);
+    }
+    merge_name_clauses();
+    optimize_program();
+    if (sprogram.has_prune && (GROUP_BY_NONE != sgroup_by))
+    {
+        print_error("`-prune' cannot be combined with `--group-by'.");
+        cleanup(TRUE);
+    }
+    if (sprogram.has_action && (GROUP_BY_NONE != sgroup_by))
+    {
+        /* the groups are all that is printed, the actions would be dropped without a word */
+        print_error("`-print', `-ls', `-exec', `-execdir' and `-quit' cannot be combined with "
+                "`--group-by'.");
+        cleanup(TRUE);
+    }
+    if ((0 != slimit) && (GROUP_BY_NONE != sgroup_by))
+    {
+        /* the table is summed up as a whole, there is no traversal to stop early */
+        print_error("`-limit' cannot be combined with `--group-by'.");
+        cleanup(TRUE);
+    }
+    if (sstats)
+    {
+        if (0 != stats_init(&scurrent_context->stats, (size_t) sprogram.length))
+        {
+            print_error("malloc() failed: Out of memory.");
+            cleanup(TRUE);
+        }
+        sstats_start = stats_now();
+    }
+
+    if (NULL != sindex_file)
+    {
+        if (path_given || (NULL != sbuild_index) || (NULL != sserve_socket))
+        {
+            print_error("`--index' cannot be combined with a path, `--build-index' or `--serve'.");
+            cleanup(TRUE);
+        }
+        result = query_index(sindex_file);
+        if ((EXIT_SUCCESS != finish_exec(scurrent_context)) || (0 != exec_wait()))
+        {
+            result = EXIT_FAILURE;
+        }
+        if (sstats)
+        {
+            print_stats();
+        }
+        free_program();
+        idcache_free();
+        cleanup(FALSE);
+        return result;
+    }
+    if ((NULL != sbuild_index) + (NULL != sserve_socket) + (GROUP_BY_NONE != sgroup_by) > 1)
+    {
+        print_error("Only one of `--build-index', `--serve' and `--group-by' can be given.");
+        cleanup(TRUE);
+    }
+    srecord_tree = (NULL != sbuild_index) || (NULL != sserve_socket)
+            || (GROUP_BY_NONE != sgroup_by);
+    if ((NULL == sbuild_index) && (NULL == sserve_socket))
+    {
+        /* nothing below -maxdepth is examined, so it is not read either */
+        swalk_depth = smax_depth;
+    }
+    if (srecord_tree)
+    {
+        /* the records need all fields and the order of the sequential traversal */
+        sneed_stat = TRUE;
+        sstat_fields |= STAT_FIELDS_ALL;
+        sworker_count = 1;
+        index_writer_init(&sindex_writer, path_given ? INDEX_FLAG_PATH_GIVEN : 0);
+        if (NULL != sbuild_index)
+        {
+            load_old_index(path_given ? argv[1] : ".", sindex_writer.flags);
+        }
+    }
+
+    /* determine the directory for start */
+    get_path_buffer()[0] = '\0';
+    start_dir = (char*) malloc(get_max_path_length() * sizeof(char));
+    if (NULL == start_dir)
+    {
+        free(start_dir);
+        start_dir = NULL;
+        print_error("malloc() failed: Out of memory.");
+        cleanup(TRUE);
+    }
+
+    /* build complete path to file (DIR/FILE) */
+    snprintf(get_path_buffer(), get_max_path_length(), "%s", argv[1]);
+
+    parameter_directory_given = TRUE;
+    if (sstats && (path_given || srecord_tree))
+    {
+        /* the start path is stat'ed below, its entries by the traversal */
+        ++scurrent_context->stats.stat_calls;
+    }
+    /*get information about the file and catch errors*/
+    if (!path_given)
+    {
+        /* no search path defined - we set it to work directory and start */
+        parameter_directory_given = FALSE;
+        if (!srecord_tree)
+        {
+            /* with -maxdepth 0 there is nothing to examine, the start path is not */
+            result = (swalk_depth > 0) ? traverse(".") : EXIT_SUCCESS;
+        }
+        else if ((-1 != lstat(".", &stbuf)) && add_record(INDEX_NO_PARENT, ".", &stbuf, NULL))
+        {
+            result = traverse(".");
+        }
+    }
+    else if (-1 != lstat(get_path_buffer(), &stbuf))
+    {
+        /*search path defined */
+        FileEntry entry;
+
+        /* basename() may modify its argument, so it gets a copy */
+        snprintf(get_base_name_buffer(), get_max_path_length(), "%s", argv[1]);
+        entry.dir_path = NULL;
+        entry.name = basename(get_base_name_buffer());
+        entry.path = argv[1];
+        entry.dir_fd = -1;
+        scurrent_context->prune = FALSE;
+        if (srecord_tree)
+        {
+            if (!add_record(INDEX_NO_PARENT, argv[1], &stbuf, NULL))
+            {
+                stbuf.st_mode = 0;
+            }
+        }
+        else if (0 == smin_depth)
+        {
+            result = do_file(&entry, &stbuf);
+        }
+        if (S_ISDIR(stbuf.st_mode) && !scurrent_context->prune && (swalk_depth > 0)
+                && !atomic_load(&sstopped))
+        {
+            found_dir = get_path_buffer();
+            strcpy(start_dir, found_dir);
+            /* this condition should not happen, but its better to be safe */
+            if (NULL == found_dir)
+            {
+                /* use current directory */
+                parameter_directory_given = FALSE;
+                strcpy(start_dir, ".");
+            }
+            result = traverse(start_dir);
+        }
+    }
+
+    /* the workers started their last batches when they ran out of work */
+    if ((EXIT_SUCCESS != finish_exec(scurrent_context)) || (0 != exec_wait()))
+    {
+        result = EXIT_FAILURE;
+    }
+
+    if (srecord_tree && (GROUP_BY_NONE != sgroup_by))
+    {
+        if (0 != sindex_writer.count)
+        {
+            result = query_table(sindex_writer.records, sindex_writer.count, sindex_writer.names,
+                    sindex_writer.flags);
+        }
+        index_writer_free(&sindex_writer);
+    }
+    else if (srecord_tree)
+    {
+        const char* target = (NULL != sbuild_index) ? sbuild_index : sserve_socket;
+        int error = EXIT_SUCCESS;
+
+        if ((0 != sindex_writer.count) && (NULL != sbuild_index))
+        {
+            /* the new index is written through one more descriptor */
+            if (sstats)
+            {
+                stats_open_fds(1);
+            }
+            error = index_writer_save(&sindex_writer, sbuild_index);
+            if (sstats)
+            {
+                stats_open_fds(-1);
+            }
+        }
+        else if (0 != sindex_writer.count)
+        {
+            error = serve_run(&sindex_writer, sserve_socket);
+        }
+        if (0 != error)
+        {
+            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", target, strerror(error));
+            print_error(get_print_buffer());
+        }
+        if ((0 == sindex_writer.count) || (0 != error))
+        {
+            result = EXIT_FAILURE;
+        }
+        index_writer_free(&sindex_writer);
+        if (sold_index_ready)
+        {
+            index_close(&sold_index);
+            sold_index_ready = FALSE;
+        }
+    }
+
+    if (sstats)
+    {
+        print_stats();
+    }
+
+    /* cleanup */
+    free(start_dir);
+    start_dir = NULL;
+    free_program();
+    idcache_free();
+    cleanup(FALSE);
+
+    return result;
+}
+
+#if DEBUG_OUTPUT != 0
+/**
+ *
+ * \brief debug_output prints debug messages.
+ *
+ * Does not append \n to message output.
+ *
+ * \param message output on stdout.
+ * \return void
+ *
+ */
+void debug_print(const char* message)
+{
+    int written = 0;
+
+    written = printf("DGB: %s", message);
+    if (written < 0)
+    {
+        fprintf(stderr, "DBG: debug_print() failed.");
+    }
+
+}
+#endif /* DEBUG_OUTPUT != 0 */
+
+/**
+ *
+ * \brief Get maximum path length of this Linux file system.
+ *
+ * \return Maximum path length.
+ */
+inline static int get_max_path_length(void)
+{
+    return smax_path;
+}
+
+/**
+ *
+ * \brief Get program argument0 as string.
+ *
+ * \return Buffer for printing.
+ */
+inline static char* get_print_buffer(void)
+{
+    return scurrent_context->print_buffer;
+}
+
+/**
+ *
+ * \brief Get program argument0 as string.
+ *
+ * \return Program name including path.
+ */
+inline static const char* get_program_argument_0(void)
+{
+    return sprogram_arg0;
+}
+
+/**
+ *
+ * \brief Get buffer for retrieving the path/directory information.
+ *
+ * \return Buffer for path information.
+ */
+inline static char* get_path_buffer(void)
+{
+    return scurrent_context->path_buffer;
+}
+
+/**
+ *
+ * \brief Get buffer where to write the basename of a path.
+ *
+ * \return Buffer for path information.
+ */
+inline static char* get_base_name_buffer(void)
+{
+    return scurrent_context->basename_buffer;
+}
+
+/**
+ *
+ * \brief Get buffer for the output on stdout.
+ *
+ * \return Output buffer of the calling thread.
+ */
+inline static OutputBuffer* get_output_buffer(void)
+{
+    return &scurrent_context->output;
+}
+
+/**
+ *
+ * \brief Print the usage.
+ *
+ * \return void
+ */
+static void print_usage(void)
+{
+    int written = 0;
+
+    written = printf("Usage: %s <directory> <test-action> ...\n", get_program_argument_0());
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("Arguments: -user <username|userid>\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -nouser\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -type [bcdpfls]\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -name <glob-pattern>\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -name-from <file with one glob-pattern per line>\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -path <glob-pattern>\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -print\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -ls\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -exec <command> ;  -exec <command> {} +\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -execdir <command> ;  -execdir <command> {} +\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -quit\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -limit <number of files>\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -prune\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -maxdepth <levels>  -mindepth <levels>\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -o\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --stats (counters and phase times on stderr)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           -j <number of worker threads>\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --inode-order (stat in inode order, for rotational disks)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --io-uring (stat with io_uring, if available)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --prefetch <count> (lookups in flight, for slow file systems)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --build-index <file> (save the tree to an index, no output)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --serve <socket> (keep the tree current, for --index)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --index <file> (examine an index or --serve socket instead)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --group-by <user|group|type> (files and bytes of the matches)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+    written = printf("           --exec-jobs <count> (\"{} +\" commands running at once)\n");
+    if (written < 0)
+    {
+        print_error(strerror(errno));
+    }
+}
+
+/**
+ *
+ * \brief Iterates through directory and all directories below it.
+ *
+ * The traversal is iterative: the open directories are kept on an explicit stack and the path
+ * of the current directory in an arena, where the name of a subdirectory is appended when it
+ * is entered and cut off again when it is left. Stack and arena belong to the worker and are
+ * reused, so no memory is allocated per directory once they have grown.
+ *
+ * The entries of a directory are read in batches, which are stat'ed together (see
+ * stat_batch()) and then examined one by one in readdir order.
+ *
+ * Every directory is opened relative to its parent directory and its entries are examined
+ * relative to the directory itself, so the kernel never has to resolve the complete path.
+ * With -j the subdirectories are handed over to the worker pool instead of being entered;
+ * a worker opens its task by the complete path, so a subdirectory whose path is longer than
+ * the kernel resolves is entered here instead.
+ *
+ * A subdirectory is examined before it is opened: below -maxdepth or after -prune it is not
+ * entered, so nothing in it is read or stat'ed. Entries above -mindepth are not examined.
+ *
+ * \param parent_fd file descriptor of the parent directory or AT_FDCWD.
+ * \param dir_name directory where to iterate through, relative to parent_fd.
+ * \param dir_path complete path of the directory, used to build the paths of its entries.
+ * \param level depth of the directory below the start path.
+ *
+ * \return EXIT_SUCCESS on success  EXIT_FAILURE on error.
+ */
+static int do_dir(const int parent_fd, const char* dir_name, const char* dir_path,
+        const int level)
+{
+    WorkerContext* context = scurrent_context;
+    size_t depth = 0;
+    size_t path_length = strlen(dir_path);
+    int result = EXIT_SUCCESS;
+    uint64_t started = 0;
+
+    if (!reserve_walk(context, 1, path_length))
+    {
+        print_error("malloc() failed: Out of memory.");
+        return EXIT_FAILURE;
+    }
+    memcpy(context->path_arena, dir_path, path_length + 1);
+
+    /*open directory catch error*/
+    started = start_phase();
+    if (!open_frame(&context->frames[0], openat(parent_fd, dir_name, DIR_OPEN_FLAGS), path_length))
+    {
+        end_phase(&context->stats.syscall_ns, started);
+        return EXIT_SUCCESS;
+    }
+    end_phase(&context->stats.syscall_ns, started);
+    /* with --build-index and --serve the start directory is the first record */
+    context->frames[0].level = level;
+    context->frames[0].record = 0;
+    context->frames[0].old_record = INDEX_NO_RECORD;
+    context->frames[0].reuse = FALSE;
+    if (sold_index_ready)
+    {
+        StatType file_info;
+
+        if (sstats)
+        {
+            ++context->stats.stat_calls;
+        }
+        if (0 == fstat(context->frames[0].fd, &file_info))
+        {
+            match_old_dir(&context->frames[0], 0, &file_info);
+        }
+    }
+    depth = 1;
+
+    while (depth > 0)
+    {
+        WalkFrame* frame = &context->frames[depth - 1];
+        DirBatch* batch = &frame->batch;
+        BatchEntry* batch_entry = NULL;
+        FileEntry entry;
+        size_t name_length = 0;
+        uint32_t record = 0;
+
+        if (atomic_load_explicit(&sstopped, memory_order_relaxed))
+        {
+            /* -quit or -limit, the directories on the stack are closed below */
+            break;
+        }
+        if (batch->next == batch->count)
+        {
+            if (batch->end)
+            {
+                started = start_phase();
+                close_frame(frame);
+                end_phase(&context->stats.syscall_ns, started);
+
+                /* back to the parent directory */
+                --depth;
+                if (depth > 0)
+                {
+                    context->path_arena[context->frames[depth - 1].path_length] = '\0';
+                }
+                continue;
+            }
+
+            /* fetch the next files from directory, or from the previous index */
+            started = start_phase();
+            if (frame->reuse ? !reuse_batch(frame) : !read_batch(context, frame))
+            {
+                print_error("malloc() failed: Out of memory.");
+                result = EXIT_FAILURE;
+                break;
+            }
+            if (sstats && !frame->reuse)
+            {
+                context->stats.entries_read += batch->count;
+            }
+            stat_batch(context, frame);
+            prefetch_dirs(context, frame);
+            end_phase(&context->stats.syscall_ns, started);
+            continue;
+        }
+
+        batch_entry = &batch->entries[batch->next++];
+        entry.dir_path = context->path_arena;
+        entry.name = batch->names + batch_entry->name_offset;
+        entry.path = NULL;
+        entry.dir_fd = frame->fd;
+
+        if (0 != batch_entry->error)
+        {
+            /* fstatat() failed, check next file */
+            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", get_entry_path(&entry),
+                    strerror(batch_entry->error));
+            print_error(get_print_buffer());
+            continue;
+        }
+
+        context->prune = FALSE;
+        if (srecord_tree)
+        {
+            if (!add_record(frame->record, entry.name, &batch_entry->info, &record))
+            {
+                result = EXIT_FAILURE;
+                break;
+            }
+        }
+        else if (frame->level >= smin_depth - 1)
+        {
+            do_file(&entry, &batch_entry->info);
+        }
+        if (!S_ISDIR(batch_entry->info.st_mode) || context->prune
+                || (frame->level + 1 >= swalk_depth))
+        {
+            continue;
+        }
+
+#if DEBUG_OUTPUT
+        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "Move into directory %s.\n", entry.name);
+#endif /* DEBUG_OUTPUT */
+        debug_print(get_print_buffer());
+
+        name_length = strlen(entry.name);
+        path_length = frame->path_length + 1 + name_length;
+        /* a task is opened by its path, deeper directories stay with this worker */
+        if ((sworker_count > 1) && (path_length < (size_t) smax_path))
+        {
+            /* parallel traversal: the directory becomes a task which owns its path */
+            char* next_path = (char*) malloc(path_length + 1);
+
+            if (NULL != next_path)
+            {
+                memcpy(next_path, context->path_arena, frame->path_length);
+                next_path[frame->path_length] = '/';
+                memcpy(next_path + frame->path_length + 1, entry.name, name_length + 1);
+            }
+            if ((NULL == next_path) || !schedule_dir(next_path, frame->level + 1))
+            {
+                print_error("malloc() failed: Out of memory.");
+                free(next_path);
+                result = EXIT_FAILURE;
+                break;
+            }
+            continue;
+        }
+
+        if (!reserve_walk(context, depth + 1, path_length))
+        {
+            print_error("malloc() failed: Out of memory.");
+            result = EXIT_FAILURE;
+            break;
+        }
+        /* the stack may have moved, the names of the batch did not */
+        frame = &context->frames[depth - 1];
+
+        /* build complete path to directory (DIR/SUBDIR) in place */
+        context->path_arena[frame->path_length] = '/';
+        memcpy(context->path_arena + frame->path_length + 1, entry.name, name_length + 1);
+        started = start_phase();
+        if (open_frame(&context->frames[depth], open_dir(context, frame, batch_entry), path_length))
+        {
+            end_phase(&context->stats.syscall_ns, started);
+            context->frames[depth].level = frame->level + 1;
+            context->frames[depth].record = record;
+            context->frames[depth].old_record = INDEX_NO_RECORD;
+            context->frames[depth].reuse = FALSE;
+            if (sold_index_ready && (INDEX_NO_RECORD != frame->old_record))
+            {
+                match_old_dir(&context->frames[depth],
+                        index_find_child(&sold_index, frame->old_record, entry.name),
+                        &batch_entry->info);
+            }
+            ++depth;
+        }
+        else
+        {
+            end_phase(&context->stats.syscall_ns, started);
+            context->path_arena[frame->path_length] = '\0';
+        }
+    }
+
+    /* only left early on errors, -quit and -limit */
+    while (depth > 0)
+    {
+        --depth;
+        context->path_arena[context->frames[depth].path_length] = '\0';
+        close_frame(&context->frames[depth]);
+    }
+
+    return result;
+}
+
+/**
+ *
+ * \brief Sets up a directory for the iterative traversal.
+ *
+ * \param frame receives the open directory.
+ * \param dir_fd the directory opened with DIR_OPEN_FLAGS, -1 and errno if that failed.
+ * \param path_length length of the path of the directory, which is in the path arena.
+ *
+ * \return TRUE the directory is open, FALSE it could not be opened (the error is printed).
+ */
+static boolean open_frame(WalkFrame* frame, const int dir_fd, const size_t path_length)
+{
+    frame->handle = NULL;
+    frame->path_length = path_length;
+    frame->batch.count = 0;
+    frame->batch.next = 0;
+    frame->batch.open_next = 0;
+    frame->batch.opened_ahead = 0;
+    frame->batch.end = FALSE;
+    frame->fd = dir_fd;
+#if !HAVE_GETDENTS64
+    if (-1 != frame->fd)
+    {
+        frame->handle = fdopendir(frame->fd);
+        if (NULL == frame->handle)
+        {
+            int saved_errno = errno;
+
+            close(frame->fd);
+            frame->fd = -1;
+            errno = saved_errno;
+        }
+    }
+#endif /* !HAVE_GETDENTS64 */
+    if (-1 == frame->fd)
+    {
+        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", scurrent_context->path_arena,
+                strerror(errno));
+        print_error(get_print_buffer());
+        return FALSE;
+    }
+
+    if (sstats)
+    {
+        ++scurrent_context->stats.dirs_opened;
+        stats_open_fds(1);
+    }
+    if (sinode_order)
+    {
+        /* let the kernel read ahead the directory blocks, the result is only a hint */
+        (void) posix_fadvise(frame->fd, 0, 0, POSIX_FADV_WILLNEED);
+    }
+
+    return TRUE;
+}
+
+/**
+ *
+ * \brief Closes a directory of the iterative traversal.
+ *
+ * \param frame the open directory, its path has to be in the path arena.
+ *
+ * \return void
+ */
+static void close_frame(WalkFrame* frame)
+{
+    DirBatch* batch = &frame->batch;
+    size_t i = 0;
+
+    /* directories opened ahead but not entered, only when the traversal was left early */
+    for (i = batch->next; i < batch->open_next; ++i)
+    {
+        BatchEntry* batch_entry = &batch->entries[i];
+
+        if ((0 == batch_entry->error) && S_ISDIR(batch_entry->info.st_mode))
+        {
+            prefetch_wait(&batch_entry->lookup);
+            if (-1 != batch_entry->lookup.fd)
+            {
+                close(batch_entry->lookup.fd);
+            }
+            --scurrent_context->opened_ahead;
+            if (sstats)
+            {
+                stats_open_fds(-1);
+            }
+        }
+    }
+    batch->open_next = 0;
+    batch->opened_ahead = 0;
+    if (sstats)
+    {
+        stats_open_fds(-1);
+    }
+
+#if HAVE_GETDENTS64
+    if (close(frame->fd) < 0)
+    {
+        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s':close() failed: %s.",
+                scurrent_context->path_arena, strerror(errno));
+        print_error(get_print_buffer());
+    }
+#else /* HAVE_GETDENTS64 */
+    if (closedir(frame->handle) < 0)
+    {
+        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s':closedir() failed: %s.",
+                scurrent_context->path_arena, strerror(errno));
+        print_error(get_print_buffer());
+    }
+#endif /* HAVE_GETDENTS64 */
+    frame->handle = NULL;
+    frame->fd = -1;
+}
+
+/**
+ *
+ * \brief Opens a subdirectory of a batch, or takes it from the prefetch helpers.
+ *
+ * \param context the worker.
+ * \param frame the directory of the batch.
+ * \param batch_entry the subdirectory.
+ *
+ * \return file descriptor of the subdirectory, -1 and errno on error.
+ */
+static int open_dir(WorkerContext* context, WalkFrame* frame, BatchEntry* batch_entry)
+{
+    DirBatch* batch = &frame->batch;
+    int fd = -1;
+    int error = 0;
+
+    if ((size_t) (batch_entry - batch->entries) >= batch->open_next)
+    {
+        return openat(frame->fd, batch->names + batch_entry->name_offset, DIR_OPEN_FLAGS);
+    }
+
+    prefetch_wait(&batch_entry->lookup);
+    fd = batch_entry->lookup.fd;
+    error = batch_entry->lookup.error;
+    --batch->opened_ahead;
+    --context->opened_ahead;
+    if (sstats)
+    {
+        /* counted again by open_frame() */
+        stats_open_fds(-1);
+    }
+
+    /* keep the window full while the subdirectory is traversed */
+    prefetch_dirs(context, frame);
+
+    errno = error;
+    return fd;
+}
+
+/**
+ *
+ * \brief Lets the prefetch helpers open the next subdirectories of a batch ahead.
+ *
+ * Up to --prefetch directories per batch are opened ahead, so the openat() of a slow file
+ * system overlaps with the traversal of the previous subdirectories. Only for the sequential
+ * traversal, with -j the subdirectories become tasks. Not below -maxdepth, and not with -prune,
+ * which is only known once the directory has been examined.
+ *
+ * \param context the worker.
+ * \param frame the directory of the batch, its entries are stat'ed.
+ *
+ * \return void
+ */
+static void prefetch_dirs(WorkerContext* context, WalkFrame* frame)
+{
+    DirBatch* batch = &frame->batch;
+
+    if ((0 == sprefetch) || (sworker_count > 1) || sprogram.has_prune
+            || (frame->level + 1 >= swalk_depth))
+    {
+        return;
+    }
+    if (batch->open_next < batch->next)
+    {
+        batch->open_next = batch->next;
+    }
+
+    while ((batch->open_next < batch->count) && (batch->opened_ahead < (size_t) sprefetch)
+            && (context->opened_ahead < PREFETCH_MAX_DIRS))
+    {
+        BatchEntry* batch_entry = &batch->entries[batch->open_next++];
+
+        if ((0 != batch_entry->error) || !S_ISDIR(batch_entry->info.st_mode))
+        {
+            continue;
+        }
+        batch_entry->lookup.kind = PREFETCH_OPEN;
+        batch_entry->lookup.dir_fd = frame->fd;
+        batch_entry->lookup.name = batch->names + batch_entry->name_offset;
+        batch_entry->lookup.flags = DIR_OPEN_FLAGS;
+        prefetch_submit(&batch_entry->lookup);
+        ++batch->opened_ahead;
+        ++context->opened_ahead;
+        if (sstats)
+        {
+            stats_open_fds(1);
+        }
+    }
+}
+
+#if HAVE_GETDENTS64
+/**
+ *
+ * \brief Reads the next batch of entries of a directory.
+ *
+ * One getdents64 call fills the buffer of the worker with as many records as fit, the records
+ * are walked in place and all of them go into the batch. Huge directories take few system
+ * calls this way, readdir() would read them in 32 KiB steps.
+ *
+ * \param context the worker.
+ * \param frame the open directory, its path has to be in the path arena.
+ *
+ * \return TRUE on success (also at the end of the directory), FALSE out of memory.
+ */
+static boolean read_batch(WorkerContext* context, WalkFrame* frame)
+{
+    DirBatch* batch = &frame->batch;
+    long length = 0;
+    long offset = 0;
+
+    batch->count = 0;
+    batch->next = 0;
+    batch->names_length = 0;
+    batch->open_next = 0;
+
+    if (NULL == context->dirent_buffer)
+    {
+        context->dirent_buffer = (char*) malloc(DIRENT_BUFFER_SIZE);
+        if (NULL == context->dirent_buffer)
+        {
+            return FALSE;
+        }
+    }
+
+    length = syscall(SYS_getdents64, frame->fd, context->dirent_buffer, DIRENT_BUFFER_SIZE);
+    if (length <= 0)
+    {
+        if (length < 0)
+        {
+            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': getdents64() failed: %s.",
+                    context->path_arena, strerror(errno));
+            print_error(get_print_buffer());
+        }
+        batch->end = TRUE;
+        return TRUE;
+    }
+
+    for (offset = 0; offset < length;)
+    {
+        const LinuxDirent64* record = (const LinuxDirent64*) (context->dirent_buffer + offset);
+
+        offset += record->d_reclen;
+        if ((strcmp(record->d_name, ".") == 0) || (strcmp(record->d_name, "..") == 0))
+        {
+            /* '.' and '..' are not interesting */
+            continue;
+        }
+        if (!add_to_batch(batch, (ino_t) record->d_ino, record->d_type, record->d_name))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+#else /* HAVE_GETDENTS64 */
+/**
+ *
+ * \brief Reads the next batch of entries of a directory.
+ *
+ * \param context the worker.
+ * \param frame the open directory, its path has to be in the path arena.
+ *
+ * \return TRUE on success (also at the end of the directory), FALSE out of memory.
+ */
+static boolean read_batch(WorkerContext* context, WalkFrame* frame)
+{
+    DirBatch* batch = &frame->batch;
+    struct dirent* dirp = NULL;
+    unsigned char type = DT_UNKNOWN;
+
+    batch->count = 0;
+    batch->next = 0;
+    batch->names_length = 0;
+    batch->open_next = 0;
+
+    while (batch->count < DIR_BATCH_ENTRIES)
+    {
+        errno = 0;
+        dirp = readdir(frame->handle);
+        if (NULL == dirp)
+        {
+            if (0 != errno)
+            {
+                snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': readdir() failed: %s.",
+                        context->path_arena, strerror(errno));
+                print_error(get_print_buffer());
+            }
+            batch->end = TRUE;
+            break;
+        }
+
+        if ((strcmp(dirp->d_name, ".") == 0) || (strcmp(dirp->d_name, "..") == 0))
+        {
+            /* '.' and '..' are not interesting */
+            continue;
+        }
+#ifdef _DIRENT_HAVE_D_TYPE
+        type = dirp->d_type;
+#endif /* _DIRENT_HAVE_D_TYPE */
+        if (!add_to_batch(batch, dirp->d_ino, type, dirp->d_name))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+#endif /* HAVE_GETDENTS64 */
+
+/**
+ *
+ * \brief Appends a directory entry to a batch.
+ *
+ * \param batch the batch, grown if needed.
+ * \param ino inode number of the entry.
+ * \param type file type of the entry (d_type), DT_UNKNOWN if not known.
+ * \param name name of the entry.
+ *
+ * \return TRUE on success, FALSE out of memory.
+ */
+static boolean add_to_batch(DirBatch* batch, const ino_t ino, const unsigned char type,
+        const char* name)
+{
+    const size_t name_size = strlen(name) + 1;
+    BatchEntry* batch_entry = NULL;
+
+    if (batch->count == batch->capacity)
+    {
+        const size_t capacity = (0 == batch->capacity) ? DIR_BATCH_INITIAL_ENTRIES
+                : 2 * batch->capacity;
+        BatchEntry* entries = (BatchEntry*) realloc(batch->entries, capacity * sizeof(BatchEntry));
+
+        if (NULL == entries)
+        {
+            return FALSE;
+        }
+        batch->entries = entries;
+        batch->capacity = capacity;
+    }
+    if (batch->names_length + name_size > batch->names_capacity)
+    {
+        size_t capacity = (0 == batch->names_capacity) ? (size_t) smax_path
+                : batch->names_capacity;
+        char* names = NULL;
+
+        while (batch->names_length + name_size > capacity)
+        {
+            capacity *= 2;
+        }
+        names = (char*) realloc(batch->names, capacity);
+        if (NULL == names)
+        {
+            return FALSE;
+        }
+        batch->names = names;
+        batch->names_capacity = capacity;
+    }
+
+    batch_entry = &batch->entries[batch->count++];
+    batch_entry->ino = ino;
+    batch_entry->name_offset = batch->names_length;
+    batch_entry->type = type;
+    memcpy(batch->names + batch->names_length, name, name_size);
+    batch->names_length += name_size;
+
+    return TRUE;
+}
+
+/**
+ *
+ * \brief Fills the batch with the entries a directory had in the previous index.
+ *
+ * Used for directories which did not change since then (see match_old_dir()), their entries
+ * are still the same and need not be read. They are stat'ed as usual, the files may have
+ * changed all the same.
+ *
+ * \param frame the directory, its old_record is set.
+ *
+ * \return TRUE on success, FALSE out of memory.
+ */
+static boolean reuse_batch(WalkFrame* frame)
+{
+    DirBatch* batch = &frame->batch;
+    uint32_t child = sold_index.first_child[frame->old_record];
+
+    batch->count = 0;
+    batch->next = 0;
+    batch->names_length = 0;
+    batch->open_next = 0;
+    batch->end = TRUE;
+
+    for (; INDEX_NO_RECORD != child; child = sold_index.next_sibling[child])
+    {
+        const IndexRecord* record = &sold_index.records[child];
+
+        if (!add_to_batch(batch, (ino_t) record->ino, (unsigned char) IFTODT(record->mode),
+                index_record_name(&sold_index, record)))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ *
+ * \brief Looks up a directory in the previous index and decides whether it can be reused.
+ *
+ * \param frame the open directory.
+ * \param old_record record of the directory in the previous index, INDEX_NO_RECORD if none.
+ * \param file_info current file information of the directory.
+ *
+ * \return void
+ */
+static void match_old_dir(WalkFrame* frame, const uint32_t old_record, const StatType* file_info)
+{
+    frame->old_record = old_record;
+    frame->reuse = (INDEX_NO_RECORD != old_record)
+            && index_dir_unchanged(&sold_index.records[old_record], file_info);
+}
+
+/**
+ *
+ * \brief Gets the file information of all entries of a batch.
+ *
+ * When the predicates only look at the file type, d_type is sufficient and nothing is stat'ed.
+ * With --inode-order the entries are stat'ed sorted by inode number: on rotational disks the
+ * inode table is then read in one sweep instead of seeking back and forth in readdir order.
+ * With --io-uring they are handed to the kernel all at once (see stat_batch_ring()), with
+ * --prefetch to the helper threads.
+ *
+ * \param context the worker.
+ * \param frame the directory of the batch.
+ *
+ * \return void
+ */
+static void stat_batch(WorkerContext* context, WalkFrame* frame)
+{
+    DirBatch* batch = &frame->batch;
+    const boolean collect = sinode_order || suse_uring || (sprefetch > 0);
+    size_t pending = 0;
+    size_t i = 0;
+
+    if (collect && (batch->count > context->stat_order_capacity))
+    {
+        /* without it the entries are stat'ed one by one in readdir order */
+        free(context->stat_order);
+        context->stat_order = (StatOrder*) malloc(batch->capacity * sizeof(StatOrder));
+        context->stat_order_capacity = (NULL == context->stat_order) ? 0 : batch->capacity;
+    }
+
+    for (i = 0; i < batch->count; ++i)
+    {
+        BatchEntry* batch_entry = &batch->entries[i];
+
+        batch_entry->error = 0;
+#ifdef _DIRENT_HAVE_D_TYPE
+        if ((!sneed_stat) && (DT_UNKNOWN != batch_entry->type))
+        {
+            /* the predicates only look at the file type, readdir() already told us */
+            batch_entry->info.st_mode = DTTOIF(batch_entry->type);
+            continue;
+        }
+#endif /* _DIRENT_HAVE_D_TYPE */
+        if (sstats)
+        {
+            ++context->stats.stat_calls;
+        }
+
+        if (collect && (NULL != context->stat_order))
+        {
+            context->stat_order[pending].ino = batch_entry->ino;
+            context->stat_order[pending].index = i;
+            ++pending;
+        }
+        else
+        {
+            stat_entry(frame, batch_entry);
+        }
+    }
+
+    if (sinode_order && (pending > 1))
+    {
+        qsort(context->stat_order, pending, sizeof(StatOrder), compare_inodes);
+    }
+    if (suse_uring && (pending > 0) && stat_batch_ring(context, frame, pending))
+    {
+        return;
+    }
+    if (sprefetch > 0)
+    {
+        stat_batch_prefetch(context, frame, pending);
+        return;
+    }
+    for (i = 0; i < pending; ++i)
+    {
+        stat_entry(frame, &batch->entries[context->stat_order[i].index]);
+    }
+}
+
+/**
+ *
+ * \brief Gets the file information of the collected entries of a batch with io_uring.
+ *
+ * One IORING_OP_STATX per entry is queued, the kernel works on all of them at once instead of
+ * blocking the thread once per entry. The statx mask asks for the fields the predicates need
+ * only. Entries the ring could not complete are stat'ed synchronously.
+ *
+ * \param context the worker, its stat_order holds the entries.
+ * \param frame the directory of the batch.
+ * \param pending number of entries in stat_order.
+ *
+ * \return TRUE the entries are stat'ed, FALSE io_uring is not available and nothing was done.
+ */
+static boolean stat_batch_ring(WorkerContext* context, WalkFrame* frame, const size_t pending)
+{
+    DirBatch* batch = &frame->batch;
+    size_t i = 0;
+
+    if (context->ring_failed)
+    {
+        return FALSE;
+    }
+    if (!context->ring_ready)
+    {
+        if (0 != stat_ring_init(&context->ring, STAT_RING_ENTRIES))
+        {
+            /* old kernel or io_uring disabled, stay synchronous */
+            context->ring_failed = TRUE;
+            return FALSE;
+        }
+        context->ring_ready = TRUE;
+        if (sstats)
+        {
+            stats_open_fds(1);
+        }
+    }
+    if (pending > context->stat_request_capacity)
+    {
+        StatRequest* requests = (StatRequest*) realloc(context->stat_requests,
+                batch->capacity * sizeof(StatRequest));
+
+        if (NULL == requests)
+        {
+            return FALSE;
+        }
+        context->stat_requests = requests;
+        context->stat_request_capacity = batch->capacity;
+    }
+
+    for (i = 0; i < pending; ++i)
+    {
+        BatchEntry* batch_entry = &batch->entries[context->stat_order[i].index];
+
+        context->stat_requests[i].name = batch->names + batch_entry->name_offset;
+        context->stat_requests[i].info = &batch_entry->info;
+    }
+
+    if (0 != stat_ring_run(&context->ring, frame->fd, context->stat_requests, pending,
+            sstat_fields))
+    {
+        /* the ring broke, the rest goes the synchronous way from now on */
+        context->ring_failed = TRUE;
+    }
+
+    for (i = 0; i < pending; ++i)
+    {
+        BatchEntry* batch_entry = &batch->entries[context->stat_order[i].index];
+
+        if (EINPROGRESS == context->stat_requests[i].error)
+        {
+            stat_entry(frame, batch_entry);
+        }
+        else
+        {
+            batch_entry->error = context->stat_requests[i].error;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ *
+ * \brief Gets the file information of the collected entries of a batch with the helpers.
+ *
+ * All entries are queued at once, --prefetch of them are looked up concurrently. The batch is
+ * examined after all of them are finished, so the order of the output does not change.
+ *
+ * \param context the worker, its stat_order holds the entries.
+ * \param frame the directory of the batch.
+ * \param pending number of entries in stat_order.
+ *
+ * \return void
+ */
+static void stat_batch_prefetch(WorkerContext* context, WalkFrame* frame, const size_t pending)
+{
+    DirBatch* batch = &frame->batch;
+    size_t i = 0;
+
+    for (i = 0; i < pending; ++i)
+    {
+        BatchEntry* batch_entry = &batch->entries[context->stat_order[i].index];
+
+        batch_entry->lookup.kind = PREFETCH_STAT;
+        batch_entry->lookup.dir_fd = frame->fd;
+        batch_entry->lookup.name = batch->names + batch_entry->name_offset;
+        batch_entry->lookup.info = &batch_entry->info;
+        prefetch_submit(&batch_entry->lookup);
+    }
+    for (i = 0; i < pending; ++i)
+    {
+        BatchEntry* batch_entry = &batch->entries[context->stat_order[i].index];
+
+        prefetch_wait(&batch_entry->lookup);
+        batch_entry->error = batch_entry->lookup.error;
+    }
+}
+
+/**
+ *
+ * \brief Gets the file information of an entry of a batch.
+ *
+ * \param frame the directory of the entry.
+ * \param batch_entry the entry, receives info or error.
+ *
+ * \return void
+ */
+static void stat_entry(const WalkFrame* frame, BatchEntry* batch_entry)
+{
+    if (-1 == fstatat(frame->fd, frame->batch.names + batch_entry->name_offset,
+            &batch_entry->info, AT_SYMLINK_NOFOLLOW))
+    {
+        batch_entry->error = errno;
+    }
+}
+
+/**
+ *
+ * \brief Compares two entries by inode number, for qsort().
+ *
+ * \param left first StatOrder.
+ * \param right second StatOrder.
+ *
+ * \return negative, 0 or positive like strcmp().
+ */
+static int compare_inodes(const void* left, const void* right)
+{
+    const ino_t left_ino = ((const StatOrder*) left)->ino;
+    const ino_t right_ino = ((const StatOrder*) right)->ino;
+
+    return (left_ino > right_ino) - (left_ino < right_ino);
+}
+
+/**
+ *
+ * \brief Makes sure the traversal stack and the path arena of a worker are big enough.
+ *
+ * Both only grow, so a worker stops allocating once it has seen its deepest directory. The
+ * path buffer grows along, so that get_entry_path() can append any name to the path.
+ *
+ * \param context the worker.
+ * \param depth number of frames needed.
+ * \param path_length length of the longest path needed, without terminating '\0'.
+ *
+ * \return TRUE on success, FALSE out of memory.
+ */
+static boolean reserve_walk(WorkerContext* context, const size_t depth, const size_t path_length)
+{
+    if (depth > context->frame_capacity)
+    {
+        size_t capacity = (0 == context->frame_capacity) ? WALK_INITIAL_DEPTH
+                : context->frame_capacity;
+        WalkFrame* frames = NULL;
+
+        while (capacity < depth)
+        {
+            capacity *= 2;
+        }
+        frames = (WalkFrame*) realloc(context->frames, capacity * sizeof(WalkFrame));
+        if (NULL == frames)
+        {
+            return FALSE;
+        }
+        /* the batches of new frames start empty */
+        memset(frames + context->frame_capacity, 0,
+                (capacity - context->frame_capacity) * sizeof(WalkFrame));
+        context->frames = frames;
+        context->frame_capacity = capacity;
+    }
+
+    if (path_length >= context->arena_capacity)
+    {
+        size_t capacity = (0 == context->arena_capacity) ? (size_t) smax_path
+                : context->arena_capacity;
+        char* arena = NULL;
+
+        while (capacity <= path_length)
+        {
+            capacity *= 2;
+        }
+        arena = (char*) realloc(context->path_arena, capacity);
+        if (NULL == arena)
+        {
+            return FALSE;
+        }
+        context->path_arena = arena;
+        context->arena_capacity = capacity;
+    }
+
+    /* the path of an entry is the path of its directory, '/', the name and '\0' */
+    if (path_length + NAME_MAX + 2 > context->path_buffer_capacity)
+    {
+        size_t capacity = (0 == context->path_buffer_capacity) ? NAME_MAX
+                : context->path_buffer_capacity;
+        char* buffer = NULL;
+
+        while (capacity < path_length + NAME_MAX + 2)
+        {
+            capacity *= 2;
+        }
+        buffer = (char*) realloc(context->path_buffer, capacity);
+        if (NULL == buffer)
+        {
+            return FALSE;
+        }
+        context->path_buffer = buffer;
+        context->path_buffer_capacity = capacity;
+    }
+
+    return TRUE;
+}
+
+/**
+ *
+ * \brief Get the complete path of a directory entry, it is built on first use.
+ *
+ * \param entry directory entry.
+ *
+ * The path may be longer than the maximum path length, reserve_walk() made room for it.
+ *
+ * \return Path of the entry (DIR/FILE), valid until the next entry is examined.
+ */
+static const char* get_entry_path(FileEntry* entry)
+{
+    if (NULL == entry->path)
+    {
+        snprintf(get_path_buffer(), scurrent_context->path_buffer_capacity, "%s/%s",
+                entry->dir_path, entry->name);
+        entry->path = get_path_buffer();
+    }
+    return entry->path;
+}
+
+/**
+ *
+ * \brief Adds the record of a file to the tree being recorded (--build-index, --serve).
+ *
+ * \param parent record of the parent directory, INDEX_NO_PARENT for the start path.
+ * \param name name of the file, the path as given for the start path.
+ * \param file_info file information.
+ * \param record receives the index of the new record, may be NULL.
+ *
+ * \return TRUE on success, FALSE if the record could not be added (the error is printed).
+ */
+static boolean add_record(const uint32_t parent, const char* name, const StatType* file_info,
+        uint32_t* record)
+{
+    uint32_t added = 0;
+    int error = index_writer_add(&sindex_writer, parent, name, file_info, &added);
+
+    if (0 != error)
+    {
+        print_error(strerror(error));
+        return FALSE;
+    }
+    if (NULL != record)
+    {
+        *record = added;
+    }
+    return TRUE;
+}
+
+/**
+ *
+ * \brief Loads the previous version of the --build-index file for an incremental rebuild.
+ *
+ * It is only used if it was built from the same start path. Without a usable previous index
+ * every directory is read.
+ *
+ * \param start_path start path of the traversal.
+ * \param flags INDEX_FLAG_... of the traversal.
+ *
+ * \return void
+ */
+static void load_old_index(const char* start_path, const uint32_t flags)
+{
+    int error = 0;
+
+    /* index_open() holds the file only until it is mapped */
+    if (sstats)
+    {
+        stats_open_fds(1);
+    }
+    error = index_open(&sold_index, sbuild_index);
+    if (sstats)
+    {
+        stats_open_fds(-1);
+    }
+    if (0 != error)
+    {
+        return;
+    }
+    if ((flags != sold_index.header->flags)
+            || (0 != strcmp(start_path, index_record_name(&sold_index, sold_index.records)))
+            || (0 != index_load_tree(&sold_index)))
+    {
+        index_close(&sold_index);
+        return;
+    }
+    sold_index_ready = TRUE;
+}
+
+/**
+ *
+ * \brief Examines the records of an index instead of the file system (--index).
+ *
+ * The records are in the order of the traversal which built the index, so the path of the
+ * parent of a record is always a prefix of the path arena: it is cut back to the parent and
+ * the name is appended, like the traversal does. The output is the same as the traversal
+ * would have printed at the time the index was built.
+ *
+ * \param file_name the index file, or the socket of a --serve server.
+ *
+ * \return EXIT_SUCCESS on success  EXIT_FAILURE on error.
+ */
+static int query_index(const char* file_name)
+{
+    WorkerContext* context = scurrent_context;
+    IndexFile index;
+    size_t* path_lengths = NULL;
+    int* levels = NULL;
+    size_t i = 0;
+    StatType socket_info;
+    int error = 0;
+
+    if ((0 == stat(file_name, &socket_info)) && S_ISSOCK(socket_info.st_mode))
+    {
+        /* a --serve server hands out the index of its current tree */
+        int fd = -1;
+
+        error = serve_fetch(file_name, &fd);
+        if (0 == error)
+        {
+            if (sstats)
+            {
+                stats_open_fds(1);
+            }
+            error = index_open_fd(&index, fd);
+            close(fd);
+            if (sstats)
+            {
+                stats_open_fds(-1);
+            }
+        }
+    }
+    else
+    {
+        /* index_open() holds the file only until it is mapped */
+        if (sstats)
+        {
+            stats_open_fds(1);
+        }
+        error = index_open(&index, file_name);
+        if (sstats)
+        {
+            stats_open_fds(-1);
+        }
+    }
+    if (0 != error)
+    {
+        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", file_name,
+                (EINVAL == error) ? "Not a myfind index" : strerror(error));
+        print_error(get_print_buffer());
+        return EXIT_FAILURE;
+    }
+    if (GROUP_BY_NONE != sgroup_by)
+    {
+        int result = query_table(index.records, index.count, index.names, index.header->flags);
+
+        index_close(&index);
+        return result;
+    }
+
+    /* path length and depth of every record, the parent's are needed for its entries; the
+     * depth is -1 if the entries are skipped (-maxdepth, -prune) */
+    path_lengths = (size_t*) malloc(index.count * sizeof(size_t));
+    levels = (int*) malloc(index.count * sizeof(int));
+    if ((NULL == path_lengths) || (NULL == levels))
+    {
+        print_error("malloc() failed: Out of memory.");
+        free(path_lengths);
+        free(levels);
+        index_close(&index);
+        return EXIT_FAILURE;
+    }
+    sprogram.initial_match = (0 != (index.header->flags & INDEX_FLAG_PATH_GIVEN));
+
+    for (i = 0; (i < index.count) && !atomic_load(&sstopped); ++i)
+    {
+        const IndexRecord* record = &index.records[i];
+        const char* name = index_record_name(&index, record);
+        size_t name_length = strlen(name);
+        size_t dir_length = (0 == i) ? 0 : path_lengths[record->parent];
+        StatType file_info;
+        FileEntry entry;
+
+        if ((0 != i) && ((levels[record->parent] < 0) || (levels[record->parent] >= smax_depth)))
+        {
+            /* the parent directory was not descended into */
+            levels[i] = -1;
+            continue;
+        }
+        if (!reserve_walk(context, 1, dir_length + 1 + name_length))
+        {
+            print_error("malloc() failed: Out of memory.");
+            free(path_lengths);
+            free(levels);
+            index_close(&index);
+            return EXIT_FAILURE;
+        }
+        index_record_stat(record, &file_info);
+        levels[i] = (0 == i) ? 0 : levels[record->parent] + 1;
+        context->prune = FALSE;
+
+        if (0 == i)
+        {
+            /* the start path, only examined if it was given on the command line */
+            memcpy(context->path_arena, name, name_length + 1);
+            path_lengths[0] = name_length;
+            if (sprogram.initial_match && (0 == smin_depth))
+            {
+                snprintf(get_base_name_buffer(), get_max_path_length(), "%s", name);
+                entry.dir_path = NULL;
+                entry.name = basename(get_base_name_buffer());
+                entry.path = name;
+                entry.dir_fd = -1;
+                do_file(&entry, &file_info);
+            }
+        }
+        else
+        {
+            context->path_arena[dir_length] = '\0';
+            entry.dir_path = context->path_arena;
+            entry.name = name;
+            entry.path = NULL;
+            entry.dir_fd = -1;
+            if (levels[i] >= smin_depth)
+            {
+                do_file(&entry, &file_info);
+            }
+
+            context->path_arena[dir_length] = '/';
+            memcpy(context->path_arena + dir_length + 1, name, name_length + 1);
+            path_lengths[i] = dir_length + 1 + name_length;
+        }
+        if (context->prune)
+        {
+            levels[i] = -1;
+        }
+    }
+
+    free(path_lengths);
+    free(levels);
+    index_close(&index);
+    return EXIT_SUCCESS;
+}
+
+/**
+ *
+ * \brief Sums up the matches per value of the --group-by field instead of printing them.
+ *
+ * The records are split into columns (see table.h). Every clause narrows down a bitmap of all
+ * rows filter by filter, in the order optimize_program() chose: -type and -user scan the mode
+ * and uid columns, the other filters only look at the rows still selected. A row matches if
+ * one of the clauses selects it and its depth is within -mindepth and -maxdepth; main() does
+ * not accept actions together with --group-by.
+ *
+ * \param records the files, in the order of the traversal.
+ * \param count number of records, at least 1.
+ * \param names names of the records.
+ * \param flags INDEX_FLAG_... of the traversal.
+ *
+ * \return EXIT_SUCCESS on success  EXIT_FAILURE on error.
+ */
+static int query_table(const IndexRecord* records, const size_t count, const char* names,
+        const uint32_t flags)
+{
+    FileTable table;
+    TableGroup* groups = NULL;
+    uint64_t* selected = NULL;
+    uint64_t* clause_rows = NULL;
+    size_t group_count = 0;
+    size_t first = 0;
+    size_t i = 0;
+    int clause = 0;
+    int error = table_load(&table, records, count, names);
+
+    if (0 != error)
+    {
+        print_error("malloc() failed: Out of memory.");
+        return EXIT_FAILURE;
+    }
+    selected = (uint64_t*) calloc(table.words + 1, sizeof(uint64_t));
+    clause_rows = (uint64_t*) malloc((table.words + 1) * sizeof(uint64_t));
+    if ((NULL == selected) || (NULL == clause_rows))
+    {
+        print_error("malloc() failed: Out of memory.");
+        free(selected);
+        free(clause_rows);
+        table_free(&table);
+        return EXIT_FAILURE;
+    }
+
+    /* the start path is only examined if it was given on the command line */
+    sprogram.initial_match = (0 != (flags & INDEX_FLAG_PATH_GIVEN));
+    first = sprogram.initial_match ? 0 : 1;
+    for (clause = 0; clause < sprogram.clause_count; ++clause)
+    {
+        if (!select_clause(&table, &sprogram.clauses[clause], first, clause_rows))
+        {
+            error = ENOMEM;
+            break;
+        }
+        for (i = 0; i < table.words; ++i)
+        {
+            selected[i] |= clause_rows[i];
+        }
+    }
+    if ((0 == error) && ((smin_depth > 0) || (smax_depth < INT_MAX)))
+    {
+        error = select_depth(&table, selected);
+    }
+
+    if (0 == error)
+    {
+        switch (sgroup_by)
+        {
+        case GROUP_BY_USER:
+            error = table_group_by(&table, table.uid, UINT32_MAX, selected, &groups,
+                    &group_count);
+            break;
+        case GROUP_BY_GROUP:
+            error = table_group_by(&table, table.gid, UINT32_MAX, selected, &groups,
+                    &group_count);
+            break;
+        default:
+            error = table_group_by(&table, table.mode, S_IFMT, selected, &groups, &group_count);
+            break;
+        }
+    }
+    if (0 == error)
+    {
+        print_groups(groups, group_count);
+    }
+    else
+    {
+        print_error("malloc() failed: Out of memory.");
+    }
+
+    free(groups);
+    free(selected);
+    free(clause_rows);
+    table_free(&table);
+    return (0 == error) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ *
+ * \brief Selects the rows of a table one clause of the program is true for.
+ *
+ * Like do_clause(), without -o the clause is the complete program and a clause without
+ * filters is true for every file.
+ *
+ * \param table the table.
+ * \param clause the clause.
+ * \param first first row which is examined, 1 to skip the start path.
+ * \param bitmap receives the selected rows.
+ *
+ * \return TRUE on success, FALSE out of memory.
+ */
+static boolean select_clause(const FileTable* table, const Clause* clause, const size_t first,
+        uint64_t* bitmap)
+{
+    const Instruction* instruction = sprogram.code + clause->start;
+    const Instruction* const end = sprogram.code + clause->end;
+    char* path = NULL;
+    size_t path_capacity = 0;
+    boolean result = TRUE;
+
+    table_select_from(table, first, bitmap);
+    if (clause->has_filter && !sprogram.initial_match)
+    {
+        /* the filters can not match */
+        memset(bitmap, 0, table->words * sizeof(uint64_t));
+        return TRUE;
+    }
+
+    for (; (instruction < end) && result; ++instruction)
+    {
+        size_t word = 0;
+
+        if (OP_TYPE == instruction->op)
+        {
+            table_filter_equal(table->mode, table->count, S_IFMT,
+                    get_type_mode(instruction->arg.type), bitmap);
+            continue;
+        }
+        if (OP_USER == instruction->op)
+        {
+            table_filter_equal(table->uid, table->count, UINT32_MAX,
+                    (uint32_t) instruction->arg.uid, bitmap);
+            continue;
+        }
+        if ((OP_LS == instruction->op) || (OP_PRINT == instruction->op)
+                || (OP_EXEC == instruction->op) || (OP_PRUNE == instruction->op)
+                || (OP_QUIT == instruction->op))
+        {
+            continue;
+        }
+
+        /* the other filters row by row, on the rows still selected only */
+        for (word = 0; (word < table->words) && result; ++word)
+        {
+            uint64_t bits = bitmap[word];
+
+            while ((0 != bits) && result)
+            {
+                const size_t bit = (size_t) __builtin_ctzll(bits);
+                const size_t row = word * TABLE_WORD_BITS + bit;
+                const char* name = table_name(table, row);
+                boolean matched = FALSE;
+
+                bits &= bits - 1;
+                if (0 == row)
+                {
+                    /* the start path as given, the filters see its base name */
+                    snprintf(get_base_name_buffer(), get_max_path_length(), "%s", name);
+                    name = basename(get_base_name_buffer());
+                }
+                switch (instruction->op)
+                {
+                case OP_NOUSER:
+                    matched = (NULL == idcache_user_name(table->uid[row]));
+                    break;
+                case OP_NAME:
+                    matched = filter_name(name, instruction->arg.pattern);
+                    break;
+                case OP_NAME_SET:
+                    matched = filter_name_set(name, instruction->arg.pattern_set);
+                    break;
+                case OP_PATH:
+                    result = (0 == table_path(table, row, &path, &path_capacity));
+                    matched = result && filter_path(path, instruction->arg.pattern);
+                    break;
+                default:
+                    matched = TRUE;
+                    break;
+                }
+                if (!matched)
+                {
+                    bitmap[word] &= ~(UINT64_C(1) << bit);
+                }
+            }
+        }
+    }
+
+    free(path);
+    return result;
+}
+
+/**
+ *
+ * \brief Keeps the selected rows between -mindepth and -maxdepth.
+ *
+ * \param table the table.
+ * \param bitmap the selection, rows outside are cleared.
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+static int select_depth(const FileTable* table, uint64_t* bitmap)
+{
+    int* levels = (int*) malloc((table->count + 1) * sizeof(int));
+    size_t row = 0;
+
+    if (NULL == levels)
+    {
+        return ENOMEM;
+    }
+    for (row = 0; row < table->count; ++row)
+    {
+        /* the parent of a row comes before it */
+        levels[row] = (0 == row) ? 0 : levels[table->parent[row]] + 1;
+        if ((levels[row] < smin_depth) || (levels[row] > smax_depth))
+        {
+            bitmap[row / TABLE_WORD_BITS] &= ~(UINT64_C(1) << (row % TABLE_WORD_BITS));
+        }
+    }
+
+    free(levels);
+    return 0;
+}
+
+/**
+ *
+ * \brief Prints the groups of --group-by: files, bytes and the value of the field.
+ *
+ * \param groups the groups, in the order to be printed.
+ * \param count number of groups.
+ *
+ * \return void
+ */
+static void print_groups(const TableGroup* groups, const size_t count)
+{
+    char key_buffer[MAX_GROUP_KEY];
+    size_t i = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        const char* key = NULL;
+        size_t key_length = 0;
+        char* dest = NULL;
+        int error = 0;
+
+        if (GROUP_BY_TYPE == sgroup_by)
+        {
+            StatType file_info;
+
+            file_info.st_mode = (mode_t) groups[i].key;
+            key_buffer[0] = get_file_type(&file_info);
+            key_buffer[1] = '\0';
+            key = key_buffer;
+        }
+        else
+        {
+            key = (GROUP_BY_USER == sgroup_by) ? idcache_user_name((uid_t) groups[i].key)
+                    : idcache_group_name((gid_t) groups[i].key);
+            if (NULL == key)
+            {
+                /* no name, like -ls the number is printed */
+                snprintf(key_buffer, sizeof(key_buffer), "%u", (unsigned int) groups[i].key);
+                key = key_buffer;
+            }
+        }
+        key_length = strlen(key);
+
+        dest = output_claim(get_output_buffer(), GROUP_LINE_WIDTH + key_length + 1);
+        if (NULL == dest)
+        {
+            print_error("malloc() failed: Out of memory.");
+            return;
+        }
+        dest = format_unsigned(dest, (unsigned long) groups[i].files, GROUP_FILES_WIDTH);
+        *dest++ = ' ';
+        dest = format_unsigned(dest, (unsigned long) groups[i].bytes, GROUP_BYTES_WIDTH);
+        *dest++ = ' ';
+        memcpy(dest, key, key_length);
+        dest += key_length;
+        *dest++ = '\n';
+
+        error = output_commit(get_output_buffer(), dest);
+        if (0 != error)
+        {
+            print_error(strerror(error));
+        }
+    }
+}
+
+/**
+ *
+ * \brief Prints the --stats report on stderr.
+ *
+ * The counters of the workers have been added to those of the main thread. The times of the
+ * phases are summed over the workers, so with -j they can exceed the wall time; the match time
+ * is without the output time.
+ *
+ * \return void
+ */
+static void print_stats(void)
+{
+    const StatsCounters* stats = &smain_context.stats;
+    const uint64_t wall_ns = stats_now() - sstats_start;
+    unsigned long user_lookups = 0;
+    unsigned long group_lookups = 0;
+    char text[MAX_STATS_INSTRUCTION];
+    int written = 0;
+    int clause = 0;
+    int i = 0;
+
+    /* what was printed so far comes before the report */
+    written = output_flush(get_output_buffer());
+    if (0 != written)
+    {
+        print_error(strerror(written));
+    }
+    idcache_lookups(&user_lookups, &group_lookups);
+
+    written = fprintf(stderr, "%-*s%*lu\n%-*s%*lu\n%-*s%*lu\n%-*s%*lu\n%-*s%*lu\n%-*s%*ld\n",
+            STATS_LABEL_WIDTH, "directories opened", STATS_VALUE_WIDTH, stats->dirs_opened,
+            STATS_LABEL_WIDTH, "entries read", STATS_VALUE_WIDTH, stats->entries_read,
+            STATS_LABEL_WIDTH, "lstat calls", STATS_VALUE_WIDTH, stats->stat_calls,
+            STATS_LABEL_WIDTH, "getpwuid lookups", STATS_VALUE_WIDTH, user_lookups,
+            STATS_LABEL_WIDTH, "getgrgid lookups", STATS_VALUE_WIDTH, group_lookups,
+            STATS_LABEL_WIDTH, "peak open fds", STATS_VALUE_WIDTH, stats_peak_fds());
+    if (written >= 0)
+    {
+        written = fprintf(stderr, "%-*s%*.3f ms\n%-*s%*.3f ms\n%-*s%*.3f ms\n%-*s%*.3f ms\n",
+                STATS_LABEL_WIDTH, "wall time", STATS_VALUE_WIDTH, wall_ns / NS_PER_MS,
+                STATS_LABEL_WIDTH, "syscall time", STATS_VALUE_WIDTH,
+                stats->syscall_ns / NS_PER_MS,
+                STATS_LABEL_WIDTH, "match time", STATS_VALUE_WIDTH,
+                (stats->match_ns - stats->output_ns) / NS_PER_MS,
+                STATS_LABEL_WIDTH, "output time", STATS_VALUE_WIDTH,
+                stats->output_ns / NS_PER_MS);
+    }
+    if ((written >= 0) && (sprogram.clause_count > 0) && (0 != sprogram.length))
+    {
+        written = fprintf(stderr, "%-*s%*s%*s\n", STATS_LABEL_WIDTH, "predicate",
+                STATS_VALUE_WIDTH, "evaluated", STATS_VALUE_WIDTH, "true");
+    }
+
+    /* in the order they are evaluated, the instructions dropped by merge_name_clauses() not */
+    for (clause = 0; (clause < sprogram.clause_count) && (written >= 0); ++clause)
+    {
+        for (i = sprogram.clauses[clause].start; (i < sprogram.clauses[clause].end)
+                && (written >= 0); ++i)
+        {
+            const unsigned long evaluations = stats->evaluations[i];
+
+            format_instruction(&sprogram.code[i], text, sizeof(text));
+            written = fprintf(stderr, "%-*s%*lu%*lu%7.1f%%\n", STATS_LABEL_WIDTH, text,
+                    STATS_VALUE_WIDTH, evaluations, STATS_VALUE_WIDTH, stats->passes[i],
+                    (0 == evaluations) ? 0.0 : 100.0 * stats->passes[i] / evaluations);
+        }
+    }
+    if (written < 0)
+    {
+        /* sorry we can not print to error stream */
+        cleanup(TRUE);
+    }
+}
+
+/**
+ *
+ * \brief Renders an instruction like it was given on the command line, for --stats.
+ *
+ * \param instruction the instruction.
+ * \param buffer receives the text, cut off if too long.
+ * \param size size of buffer.
+ *
+ * \return void
+ */
+static void format_instruction(const Instruction* instruction, char* buffer, const size_t size)
+{
+    switch (instruction->op)
+    {
+    case OP_TYPE:
+        snprintf(buffer, size, "%s %c", PARAM_STR_TYPE, instruction->arg.type);
+        break;
+    case OP_USER:
+        snprintf(buffer, size, "%s %lu", PARAM_STR_USER, (unsigned long) instruction->arg.uid);
+        break;
+    case OP_NOUSER:
+        snprintf(buffer, size, "%s", PARAM_STR_NOUSER);
+        break;
+    case OP_NAME:
+        snprintf(buffer, size, "%s %s", PARAM_STR_NAME, instruction->arg.pattern->source);
+        break;
+    case OP_NAME_SET:
+        snprintf(buffer, size, "%s (%lu patterns)", PARAM_STR_NAME,
+                (unsigned long) instruction->arg.pattern_set->count);
+        break;
+    case OP_PATH:
+        snprintf(buffer, size, "%s %s", PARAM_STR_PATH, instruction->arg.pattern->source);
+        break;
+    case OP_LS:
+        snprintf(buffer, size, "%s", PARAM_STR_LS);
+        break;
+    case OP_PRINT:
+        snprintf(buffer, size, "%s", PARAM_STR_PRINT);
+        break;
+    case OP_EXEC:
+        snprintf(buffer, size, "%s %s",
+                sprogram.execs[instruction->arg.exec].in_dir ? PARAM_STR_EXECDIR : PARAM_STR_EXEC,
+                sprogram.execs[instruction->arg.exec].args[0]);
+        break;
+    case OP_PRUNE:
+        snprintf(buffer, size, "%s", PARAM_STR_PRUNE);
+        break;
+    case OP_QUIT:
+        snprintf(buffer, size, "%s", PARAM_STR_QUIT);
+        break;
+    }
+}
+
+/**
+ *
+ * \brief Starts timing a phase for --stats.
+ *
+ * \return the current time, 0 without --stats.
+ */
+static uint64_t start_phase(void)
+{
+    return sstats ? stats_now() : 0;
+}
+
+/**
+ *
+ * \brief Adds the time since start_phase() to a phase for --stats.
+ *
+ * \param phase the counter of the phase.
+ * \param started result of start_phase().
+ *
+ * \return void
+ */
+static void end_phase(uint64_t* phase, const uint64_t started)
+{
+    if (sstats)
+    {
+        *phase += stats_now() - started;
+    }
+}
+
+/**
+ *
+ * \brief Traverses the directory tree below start_dir.
+ *
+ * Recurses on the calling thread, or hands the tree over to the worker pool when -j was given.
+ *
+ * \param start_dir directory where to start.
+ *
+ * \return EXIT_SUCCESS on success  EXIT_FAILURE on error.
+ */
+static int traverse(const char* start_dir)
+{
+    int result = EXIT_SUCCESS;
+    int error = 0;
+
+    if (sprefetch > 0)
+    {
+        error = prefetch_start(sprefetch);
+        if (0 != error)
+        {
+            /* traverse without the helpers */
+            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "pthread_create() failed: %s.",
+                    strerror(error));
+            print_error(get_print_buffer());
+            sprefetch = 0;
+        }
+    }
+
+    if (sworker_count > 1)
+    {
+        result = run_workers(start_dir);
+    }
+    else
+    {
+        result = do_dir(AT_FDCWD, start_dir, start_dir, 0);
+    }
+
+    if (sprefetch > 0)
+    {
+        prefetch_stop();
+    }
+    return result;
+}
+
+/**
+ *
+ * \brief Traverses the directory tree with a pool of work-stealing workers.
+ *
+ * Every directory is a task. Each worker processes the tasks of its own deque and steals
+ * from the other workers when it runs dry. The traversal is finished when no task is pending.
+ * The output order of the files is not deterministic.
+ *
+ * \param start_dir directory where to start.
+ *
+ * \return EXIT_SUCCESS on success  EXIT_FAILURE on error.
+ */
+static int run_workers(const char* start_dir)
+{
+    int i = 0;
+    int started = 0;
+    int error = 0;
+    char* root_path = NULL;
+    DirTask task;
+
+    sworkers = (WorkerContext*) calloc(sworker_count, sizeof(WorkerContext));
+    if (NULL == sworkers)
+    {
+        print_error("malloc() failed: Out of memory.");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < sworker_count; ++i)
+    {
+        pthread_mutex_init(&sworkers[i].deque.lock, NULL);
+    }
+    for (i = 0; i < sworker_count; ++i)
+    {
+        sworkers[i].deque.tasks = (DirTask*) malloc(DEQUE_INITIAL_CAPACITY * sizeof(DirTask));
+        sworkers[i].deque.capacity = DEQUE_INITIAL_CAPACITY;
+        if ((NULL == sworkers[i].deque.tasks) || (EXIT_SUCCESS != init_context(&sworkers[i], i)))
+        {
+            print_error("malloc() failed: Out of memory.");
+            atomic_store(&sworker_result, EXIT_FAILURE);
+            break;
+        }
+    }
+
+    root_path = (char*) malloc(get_max_path_length() * sizeof(char));
+    if ((EXIT_SUCCESS == atomic_load(&sworker_result)) && (NULL != root_path))
+    {
+        strcpy(root_path, start_dir);
+        /* the root task is queued on worker 0 before any thread is started */
+        if (schedule_dir(root_path, 0))
+        {
+            root_path = NULL;
+        }
+    }
+    if (NULL != root_path)
+    {
+        free(root_path);
+        print_error("malloc() failed: Out of memory.");
+        atomic_store(&sworker_result, EXIT_FAILURE);
+    }
+
+    if (EXIT_SUCCESS == atomic_load(&sworker_result))
+    {
+        /* what the main thread printed comes first */
+        error = output_flush(get_output_buffer());
+        if (0 != error)
+        {
+            print_error(strerror(error));
+        }
+        for (started = 0; started < sworker_count; ++started)
+        {
+            error = pthread_create(&sworkers[started].thread, NULL, worker_main,
+                    &sworkers[started]);
+            if (0 != error)
+            {
+                snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "pthread_create() failed: %s.",
+                        strerror(error));
+                print_error(get_print_buffer());
+                break;
+            }
+        }
+        if (0 == started)
+        {
+            /* no thread at all, the main thread does the job on its own */
+            worker_main(&sworkers[0]);
+            scurrent_context = &smain_context;
+        }
+        for (i = 0; i < started; ++i)
+        {
+            pthread_join(sworkers[i].thread, NULL);
+        }
+    }
+
+    for (i = 0; i < sworker_count; ++i)
+    {
+        while (deque_pop(&sworkers[i].deque, &task))
+        {
+            free(task.path);
+        }
+        free(sworkers[i].deque.tasks);
+        pthread_mutex_destroy(&sworkers[i].deque.lock);
+        if (sstats)
+        {
+            stats_merge(&smain_context.stats, &sworkers[i].stats);
+        }
+        free_context(&sworkers[i]);
+    }
+    free(sworkers);
+    sworkers = NULL;
+
+    return atomic_load(&sworker_result);
+}
+
+/**
+ *
+ * \brief Thread function of a worker: processes directory tasks until the traversal is done.
+ *
+ * \param arg the WorkerContext of this worker.
+ *
+ * \return NULL
+ */
+static void* worker_main(void* arg)
+{
+    WorkerContext* context = (WorkerContext*) arg;
+    DirTask task;
+
+    scurrent_context = context;
+    while (next_task(context, &task))
+    {
+        if (EXIT_FAILURE == do_dir(AT_FDCWD, task.path, task.path, task.level))
+        {
+            atomic_store(&sworker_result, EXIT_FAILURE);
+        }
+        free(task.path);
+
+        if (1 == atomic_fetch_sub(&stasks_pending, 1))
+        {
+            /* that was the last task, wake up the idle workers to let them terminate */
+            pthread_mutex_lock(&sidle_lock);
+            pthread_cond_broadcast(&swork_available);
+            pthread_mutex_unlock(&sidle_lock);
+        }
+    }
+    if (EXIT_SUCCESS != finish_exec(context))
+    {
+        atomic_store(&sworker_result, EXIT_FAILURE);
+    }
+
+    return NULL;
+}
+
+/**
+ *
+ * \brief Queues a directory for traversal on the deque of the calling worker.
+ *
+ * \param dir_name directory to be traversed, ownership is passed to the task on success.
+ * \param level depth of the directory below the start path.
+ *
+ * \return TRUE the task is queued, FALSE out of memory.
+ */
+static boolean schedule_dir(char* dir_name, const int level)
+{
+    WorkerContext* target = scurrent_context;
+    DirTask task;
+
+    if (&smain_context == target)
+    {
+        /* the main thread seeds the pool */
+        target = &sworkers[0];
+    }
+
+    task.path = dir_name;
+    task.level = level;
+    atomic_fetch_add(&stasks_pending, 1);
+    atomic_fetch_add(&stasks_queued, 1);
+    if (!deque_push(&target->deque, &task))
+    {
+        atomic_fetch_sub(&stasks_queued, 1);
+        atomic_fetch_sub(&stasks_pending, 1);
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&sidle_lock);
+    if (sidle_workers > 0)
+    {
+        pthread_cond_signal(&swork_available);
+    }
+    pthread_mutex_unlock(&sidle_lock);
+
+    return TRUE;
+}
+
+/**
+ *
+ * \brief Fetches the next task for a worker, stealing from the others if necessary.
+ *
+ * Blocks while other workers are still busy but nothing can be stolen.
+ * Once the traversal has been stopped no task is handed out anymore.
+ *
+ * \param context of the calling worker.
+ * \param task receives the task.
+ *
+ * \return TRUE a task was fetched, FALSE the traversal is finished.
+ */
+static boolean next_task(WorkerContext* context, DirTask* task)
+{
+    int i = 0;
+
+    for (;;)
+    {
+        if (atomic_load(&sstopped))
+        {
+            /* -quit or -limit, run_workers() drops the tasks left */
+            return FALSE;
+        }
+        if (deque_pop(&context->deque, task))
+        {
+            return TRUE;
+        }
+        for (i = 1; i < sworker_count; ++i)
+        {
+            if (deque_steal(&sworkers[(context->id + i) % sworker_count].deque, task))
+            {
+                return TRUE;
+            }
+        }
+
+        pthread_mutex_lock(&sidle_lock);
+        if ((0 == atomic_load(&stasks_pending)) || atomic_load(&sstopped))
+        {
+            pthread_mutex_unlock(&sidle_lock);
+            return FALSE;
+        }
+        if (0 == atomic_load(&stasks_queued))
+        {
+            ++sidle_workers;
+            pthread_cond_wait(&swork_available, &sidle_lock);
+            --sidle_workers;
+        }
+        pthread_mutex_unlock(&sidle_lock);
+    }
+}
+
+/**
+ *
+ * \brief Pushes a task at the bottom of a deque, the deque grows if necessary.
+ *
+ * \param deque to push to.
+ * \param task to be copied into the deque.
+ *
+ * \return TRUE task pushed, FALSE out of memory.
+ */
+static boolean deque_push(TaskDeque* deque, const DirTask* task)
+{
+    boolean result = TRUE;
+    size_t i = 0;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity)
+    {
+        DirTask* tasks = (DirTask*) malloc(2 * deque->capacity * sizeof(DirTask));
+        if (NULL == tasks)
+        {
+            result = FALSE;
+        }
+        else
+        {
+            /* unwrap the ring while copying */
+            for (i = 0; i < deque->count; ++i)
+            {
+                tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+            }
+            free(deque->tasks);
+            deque->tasks = tasks;
+            deque->capacity *= 2;
+            deque->head = 0;
+        }
+    }
+    if (result)
+    {
+        deque->tasks[(deque->head + deque->count) % deque->capacity] = *task;
+        ++deque->count;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return result;
+}
+
+/**
+ *
+ * \brief Pops the newest task from the bottom of a deque (owner side).
+ *
+ * \param deque to pop from.
+ * \param task receives the task.
+ *
+ * \return TRUE task popped, FALSE deque is empty.
+ */
+static boolean deque_pop(TaskDeque* deque, DirTask* task)
+{
+    boolean result = FALSE;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0)
+    {
+        --deque->count;
+        *task = deque->tasks[(deque->head + deque->count) % deque->capacity];
+        result = TRUE;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    if (result)
+    {
+        atomic_fetch_sub(&stasks_queued, 1);
+    }
+    return result;
+}
+
+/**
+ *
+ * \brief Steals the oldest task from the top of a deque (thief side).
+ *
+ * \param deque to steal from.
+ * \param task receives the task.
+ *
+ * \return TRUE task stolen, FALSE deque is empty.
+ */
+static boolean deque_steal(TaskDeque* deque, DirTask* task)
+{
+    boolean result = FALSE;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0)
+    {
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        --deque->count;
+        result = TRUE;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    if (result)
+    {
+        atomic_fetch_sub(&stasks_queued, 1);
+    }
+    return result;
+}
+
+/**
+ *
+ * \brief Appends an instruction to the compiled program.
+ *
+ * \param op operation code.
+ * \param text operand as given on the command line, NULL for operations without one.
+ *
+ * \return the new instruction, to let the caller fill in operands it decoded itself.
+ */
+static Instruction* emit_instruction(const Opcode op, const char* text)
+{
+    Instruction* instruction = &sprogram.code[sprogram.length];
+    Clause* clause = &sprogram.clauses[sprogram.clause_count - 1];
+
+    instruction->op = op;
+    instruction->after_filter = clause->has_filter;
+    switch (op)
+    {
+    case OP_TYPE:
+        instruction->arg.type = *text;
+        break;
+    case OP_NAME:
+        instruction->arg.pattern = compile_pattern(text, 0);
+        break;
+    case OP_PATH:
+        instruction->arg.pattern = compile_pattern(text, FNM_PATHNAME);
+        break;
+    default:
+        break;
+    }
+    if (OP_PRUNE == op)
+    {
+        /* neither a filter nor an action which suppresses the default -print */
+        sprogram.has_prune = TRUE;
+    }
+    else if ((OP_LS != op) && (OP_PRINT != op) && (OP_EXEC != op) && (OP_QUIT != op))
+    {
+        clause->has_filter = TRUE;
+    }
+    else
+    {
+        clause->has_action = TRUE;
+        clause->has_output = clause->has_output || ((OP_EXEC != op) && (OP_QUIT != op));
+        sprogram.has_action = TRUE;
+    }
+    ++sprogram.length;
+    clause->end = sprogram.length;
+
+    return instruction;
+}
+
+/**
+ *
+ * \brief Compiles the glob pattern of -name/-path into the program.
+ *
+ * \param source the pattern as given on the command line.
+ * \param flags fnmatch() flags the pattern is matched with.
+ *
+ * \return the compiled pattern, owned by the program.
+ */
+static const Pattern* compile_pattern(const char* source, const int flags)
+{
+    Pattern* pattern = &sprogram.patterns[sprogram.pattern_count];
+
+    if (0 != pattern_compile(pattern, source, flags))
+    {
+        print_error("malloc() failed: Out of memory.");
+        cleanup(TRUE);
+    }
+    ++sprogram.pattern_count;
+
+    return pattern;
+}
+
+/**
+ *
+ * \brief Adds an empty set of -name patterns to the program.
+ *
+ * \return the new set, owned by the program.
+ */
+static PatternSet* new_pattern_set(void)
+{
+    PatternSet* set = &sprogram.pattern_sets[sprogram.pattern_set_count++];
+
+    pattern_set_init(set, 0);
+    return set;
+}
+
+/**
+ *
+ * \brief Reads the patterns of -name-from and compiles them.
+ *
+ * The file has one glob pattern per line, empty lines are ignored.
+ *
+ * \param file_name name of the file, "-" for standard input.
+ * \param set receives the patterns.
+ *
+ * \return void
+ */
+static void read_name_patterns(const char* file_name, PatternSet* set)
+{
+    FILE* file = stdin;
+    char* line = NULL;
+    size_t line_size = 0;
+    ssize_t length = 0;
+    int result = 0;
+
+    if (0 != strcmp("-", file_name))
+    {
+        file = fopen(file_name, "r");
+        if (NULL == file)
+        {
+            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", file_name, strerror(errno));
+            print_error(get_print_buffer());
+            cleanup(TRUE);
+        }
+        /* counted even without --stats, which may come later on the command line */
+        stats_open_fds(1);
+    }
+
+    errno = 0;
+    while ((0 == result) && ((length = getline(&line, &line_size, file)) >= 0))
+    {
+        if ((length > 0) && ('\n' == line[length - 1]))
+        {
+            line[--length] = '\0';
+        }
+        if (length > 0)
+        {
+            result = pattern_set_add(set, line);
+        }
+    }
+    if ((0 == result) && ferror(file))
+    {
+        result = (0 != errno) ? errno : EIO;
+    }
+    free(line);
+    if (stdin != file)
+    {
+        fclose(file);
+        stats_open_fds(-1);
+    }
+
+    if (0 == result)
+    {
+        result = pattern_set_compile(set);
+    }
+    if (0 != result)
+    {
+        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", file_name, strerror(result));
+        print_error(get_print_buffer());
+        cleanup(TRUE);
+    }
+}
+
+/**
+ *
+ * \brief Starts a new clause of the program, at the beginning and after every -o.
+ *
+ * \return void
+ */
+static void start_clause(void)
+{
+    Clause* clause = &sprogram.clauses[sprogram.clause_count++];
+
+    clause->start = sprogram.length;
+    clause->end = sprogram.length;
+    clause->has_filter = FALSE;
+    clause->has_action = FALSE;
+    clause->has_output = FALSE;
+}
+
+/**
+ *
+ * \brief Joins clauses which consist of a single -name into one set of patterns.
+ *
+ * "-name '*.o' -o -name '*.a' -o ..." becomes one OP_NAME_SET, so every base name is matched
+ * once against a combined matcher instead of once per pattern. The clauses have no actions, so
+ * it does not matter which of them matched.
+ *
+ * \return void
+ */
+static void merge_name_clauses(void)
+{
+    int from = 0;
+    int to = 0;
+    int i = 0;
+    size_t j = 0;
+    int result = 0;
+
+    while (from < sprogram.clause_count)
+    {
+        int last = from;
+
+        while ((last + 1 < sprogram.clause_count) && is_name_clause(&sprogram.clauses[last])
+                && is_name_clause(&sprogram.clauses[last + 1]))
+        {
+            ++last;
+        }
+
+        if (last > from)
+        {
+            PatternSet* set = new_pattern_set();
+
+            for (i = from; (0 == result) && (i <= last); ++i)
+            {
+                const Instruction* instruction = &sprogram.code[sprogram.clauses[i].start];
+
+                if (OP_NAME == instruction->op)
+                {
+                    result = pattern_set_add(set, instruction->arg.pattern->source);
+                }
+                for (j = 0; (OP_NAME_SET == instruction->op) && (0 == result)
+                        && (j < instruction->arg.pattern_set->count); ++j)
+                {
+                    result = pattern_set_add(set, instruction->arg.pattern_set->sources[j]);
+                }
+            }
+            if ((0 != result) || (0 != pattern_set_compile(set)))
+            {
+                print_error("malloc() failed: Out of memory.");
+                cleanup(TRUE);
+            }
+
+            sprogram.code[sprogram.clauses[from].start].op = OP_NAME_SET;
+            sprogram.code[sprogram.clauses[from].start].arg.pattern_set = set;
+        }
 
+        /* the instructions of the dropped clauses are left unused */
+        sprogram.clauses[to++] = sprogram.clauses[from];
+        from = last + 1;
+    }
+    sprogram.clause_count = to;
 }
-#endif /* DEBUG_OUTPUT != 0 */
 
 /**
  *
- * \brief Get maximum path length of this Linux file system.
+ * \brief Checks whether a clause consists of a single -name or -name-from.
  *
- * \return Maximum path length.
+ * \param clause to be checked.
+ *
+ * \return TRUE if the clause can be merged by merge_name_clauses().
  */
-inline static int get_max_path_length(void)
+static boolean is_name_clause(const Clause* clause)
 {
-    return smax_path;
+    const Opcode op = sprogram.code[clause->start].op;
+
+    return (1 == (clause->end - clause->start)) && ((OP_NAME == op) || (OP_NAME_SET == op));
 }
 
 /**
  *
- * \brief Get program argument0 as string.
+ * \brief Optimizes the compiled program.
  *
- * \return Buffer for printing.
+ * The filters between two actions are and-ed, so their order does not matter for the result.
+ * Each such run of filters is sorted (stable) by the estimated cost of the filter, to let the
+ * short-circuit evaluation in do_clause() skip the expensive ones as often as possible. Runs
+ * never cross the border of a clause.
+ *
+ * \return void
  */
-inline static char* get_print_buffer(void)
+static void optimize_program(void)
 {
-    return sprint_buffer;
+    int clause = 0;
+    int run_start = 0;
+    int i = 0;
+    int j = 0;
+
+    for (clause = 0; clause < sprogram.clause_count; ++clause)
+    {
+        const int start = sprogram.clauses[clause].start;
+        const int end = sprogram.clauses[clause].end;
+        boolean ls_follows = FALSE;
+
+        for (run_start = start; run_start < end;)
+        {
+            int run_end = run_start;
+
+            while ((run_end < end) && (get_filter_cost(sprogram.code[run_end].op) > 0))
+            {
+                ++run_end;
+            }
+
+            /* insertion sort, runs are short */
+            for (i = run_start + 1; i < run_end; ++i)
+            {
+                Instruction moving = sprogram.code[i];
+
+                for (j = i; (j > run_start)
+                        && (get_filter_cost(sprogram.code[j - 1].op) > get_filter_cost(moving.op));
+                        --j)
+                {
+                    sprogram.code[j] = sprogram.code[j - 1];
+                }
+                sprogram.code[j] = moving;
+            }
+            run_start = run_end + 1;
+        }
+
+        for (i = end - 1; i >= start; --i)
+        {
+            ls_follows = ls_follows || (OP_LS == sprogram.code[i].op);
+            sprogram.code[i].ls_follows = ls_follows;
+        }
+    }
 }
 
 /**
  *
- * \brief Get program argument0 as string.
+ * \brief Frees the compiled program.
  *
- * \return Program name including path.
+ * \return void
  */
-inline static const char* get_program_argument_0(void)
+static void free_program(void)
 {
-    return sprogram_arg0;
+    int i = 0;
+
+    for (i = 0; i < sprogram.pattern_count; ++i)
+    {
+        pattern_free(&sprogram.patterns[i]);
+    }
+    free(sprogram.patterns);
+    sprogram.patterns = NULL;
+    sprogram.pattern_count = 0;
+    for (i = 0; i < sprogram.pattern_set_count; ++i)
+    {
+        pattern_set_free(&sprogram.pattern_sets[i]);
+    }
+    free(sprogram.pattern_sets);
+    sprogram.pattern_sets = NULL;
+    sprogram.pattern_set_count = 0;
+    free(sprogram.execs);
+    sprogram.execs = NULL;
+    sprogram.exec_count = 0;
+    free(sprogram.clauses);
+    sprogram.clauses = NULL;
+    sprogram.clause_count = 0;
+    free(sprogram.code);
+    sprogram.code = NULL;
+    sprogram.length = 0;
 }
 
 /**
  *
- * \brief Get buffer for retrieving the path/directory information.
+ * \brief Estimated cost of evaluating a filter.
  *
- * \return Buffer for path information.
+ * \param op operation code.
+ *
+ * \return cost, 0 for actions.
  */
-inline static char* get_path_buffer(void)
+static int get_filter_cost(const Opcode op)
 {
-    return spath_buffer;
+    switch (op)
+    {
+    case OP_TYPE:
+        /* compares the mode bits only */
+        return 1;
+    case OP_USER:
+        /* compares the user id only */
+        return 1;
+    case OP_NAME:
+        /* compiled pattern on the base name */
+        return 2;
+    case OP_NAME_SET:
+        /* combined patterns on the base name, one pass */
+        return 2;
+    case OP_PATH:
+        /* has to build the complete path first */
+        return 3;
+    case OP_NOUSER:
+        /* queries the user data base */
+        return 4;
+    default:
+        return 0;
+    }
 }
 
 /**
  *
- * \brief Get buffer where to write the basename of a path.
+ * \brief Handle the file.
  *
- * \return Buffer for path information.
+ * Interprets the program compiled by main() for the file. The clauses are or-ed, so once one
+ * of them is true none of the remaining ones is evaluated.
+ *
+ * \param entry is the directory entry which has to be checked against the find options.
+ * \param file_info file information of entry which has to be checked against the find options.
+ *
+ * \return int represents the exit status of do_file.
+ * \retval EXIT_SUCCESS successful exit status.
+ * \retval EXIT_FAILURE failing exit status.
  */
-inline static char* get_base_name_buffer(void)
+static int do_file(FileEntry* entry, StatType* file_info)
 {
-    return sbasename_buffer;
+    const Clause* clause = sprogram.clauses;
+    const Clause* const last = sprogram.clauses + sprogram.clause_count;
+    const uint64_t started = start_phase();
+
+    scurrent_context->counted = FALSE;
+    for (; clause < last; ++clause)
+    {
+        if (do_clause(clause, entry, file_info))
+        {
+            break;
+        }
+    }
+    end_phase(&scurrent_context->stats.match_ns, started);
+
+    return EXIT_SUCCESS;
 }
 
 /**
  *
- * \brief Print the usage.
+ * \brief Runs the command of -exec/-execdir for a file, or adds the file to its batch.
  *
- * \return void
+ * Every worker collects the files of a "{} +" command on its own, so the batches of -execdir
+ * mostly stay within one directory.
+ *
+ * \param exec index of the command in the program.
+ * \param entry the directory entry.
+ *
+ * \return TRUE the command exited with 0 or is a batch, FALSE it failed or could not be started.
  */
-static void print_usage(void)
+static boolean do_exec(const int exec, FileEntry* entry)
 {
-    int written = 0;
+    const ExecCommand* command = &sprogram.execs[exec];
+    WorkerContext* context = scurrent_context;
+    const char* path = command->in_dir ? entry->name : get_entry_path(entry);
+    const char* dir = NULL;
+    char* start_dir = NULL;
+    int status = 0;
+    int error = 0;
 
-    written = printf("Usage: %s <directory> <test-action> ...\n", get_program_argument_0());
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-    written = printf("Arguments: -user <username|userid>\n");
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-    written = printf("           -nouser\n");
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-    written = printf("           -type [bcdpfls]\n");
-    if (written < 0)
+    if (command->in_dir && (NULL == entry->dir_path))
     {
-        print_error(strerror(errno));
+        /* the start path runs in the directory containing it */
+        start_dir = strdup(entry->path);
+        error = (NULL == start_dir) ? ENOMEM : 0;
+        dir = (NULL == start_dir) ? NULL : dirname(start_dir);
     }
-    written = printf("           -name <glob-pattern>\n");
-    if (written < 0)
+    else if (command->in_dir)
     {
-        print_error(strerror(errno));
+        dir = entry->dir_path;
     }
-    written = printf("           -path <glob-pattern>\n");
-    if (written < 0)
+
+    if ((0 == error) && !command->batch)
     {
-        print_error(strerror(errno));
+        /* what was printed so far comes before the output of the command */
+        error = output_flush(&context->output);
+        if (0 == error)
+        {
+            error = exec_run(command, dir, entry->dir_fd, path, &status);
+        }
     }
-    written = printf("           -print\n");
-    if (written < 0)
+    else if (0 == error)
     {
-        print_error(strerror(errno));
+        if (NULL == context->exec_batches)
+        {
+            context->exec_batches = (ExecBatch*) calloc(sprogram.exec_count, sizeof(ExecBatch));
+            error = (NULL == context->exec_batches) ? ENOMEM : 0;
+            context->exec_batch_count = (0 == error) ? sprogram.exec_count : 0;
+        }
+        if ((0 == error)
+                && !exec_batch_fits(command, &context->exec_batches[exec], dir, path))
+        {
+            error = output_flush(&context->output);
+            if (0 == error)
+            {
+                error = exec_batch_run(command, &context->exec_batches[exec]);
+            }
+        }
+        if (0 == error)
+        {
+            error = exec_batch_add(&context->exec_batches[exec], dir, entry->dir_fd, path);
+        }
     }
-    written = printf("           -ls\n");
-    if (written < 0)
+    free(start_dir);
+
+    if (0 != error)
     {
-        print_error(strerror(errno));
+        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", command->args[0],
+                strerror(error));
+        print_error(get_print_buffer());
+        return FALSE;
     }
+    return command->batch || (0 == status);
 }
 
 /**
  *
- * \brief Iterates through directory.
+ * \brief Starts the batches of "{} +" commands a worker has collected so far.
  *
- * \param dir_name directory where to iterate through.
- * \param params is the program argument vector.
+ * \param context the worker.
  *
- * \return void
+ * \return EXIT_SUCCESS on success  EXIT_FAILURE if a command could not be started.
  */
-static int do_dir(const char* dir_name, const char* const* params)
+static int finish_exec(WorkerContext* context)
 {
-    DIR* dirhandle = NULL;
-    struct dirent* dirp = NULL;
+    int result = EXIT_SUCCESS;
+    int error = 0;
+    int i = 0;
 
-    /*open directory catch error*/
-    dirhandle = opendir(dir_name);
-    if (NULL == dirhandle)
+    if (NULL == context->exec_batches)
     {
-        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", dir_name, strerror(errno));
-        print_error(get_print_buffer());
         return EXIT_SUCCESS;
     }
-
-    errno = 0;
-    while ((dirp = readdir(dirhandle)))
+    error = output_flush(&context->output);
+    if (0 != error)
     {
-        /* fetch each file from directory, until pointer is NULL */
-        StatType file_info;
-
-        if ((strcmp(dirp->d_name, ".") == 0) || (strcmp(dirp->d_name, "..") == 0))
-        {
-            /* '.' and '..' are not interesting */
-            continue;
-        }
-
-        /* build complete path to file (DIR/FILE) */
-        snprintf(get_path_buffer(), get_max_path_length(), "%s/%s", dir_name, dirp->d_name);
-        /* get information about the file and catch errors */
-        if (-1 == lstat(get_path_buffer(), &file_info))
+        print_error(strerror(error));
+    }
+    for (i = 0; i < sprogram.exec_count; ++i)
+    {
+        error = exec_batch_run(&sprogram.execs[i], &context->exec_batches[i]);
+        if (0 != error)
         {
-            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", get_path_buffer(),
-                    strerror(errno));
+            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': %s", sprogram.execs[i].args[0],
+                    strerror(error));
             print_error(get_print_buffer());
-            /* check next file */
-            continue;
+            result = EXIT_FAILURE;
         }
+    }
 
-        if (S_ISDIR(file_info.st_mode))
-        {
-            char* next_path = NULL;
-            do_file(get_path_buffer(), &file_info, params);
+    return result;
+}
 
-#if DEBUG_OUTPUT
-            snprintf(get_print_buffer(), MAX_PRINT_BUFFER,
-                    "Move into directory %s.\n", dirp->d_name);
-#endif /* DEBUG_OUTPUT */
-            debug_print(get_print_buffer());
-            /* recursion for each directory in current directory */
-            next_path = (char*) malloc(get_max_path_length() * sizeof(char));
-            if (NULL == next_path)
-            {
-                print_error("malloc() failed: Out of memory.");
-                if (closedir(dirhandle) < 0)
-                {
-                    snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': closedir() failed: %s.",
-                            dir_name, strerror(errno));
-                    print_error(get_print_buffer());
-                }
-                return EXIT_FAILURE;
-            }
-            strcpy(next_path, get_path_buffer());
-            if (EXIT_FAILURE == do_dir(next_path, params))
-            {
-                if (closedir(dirhandle) < 0)
-                {
-                    snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': closedir() failed: %s.",
-                            dir_name, strerror(errno));
-                    print_error(get_print_buffer());
-                }
-                free(next_path);
-                return EXIT_FAILURE;
-            }
-            free(next_path);
-        }
-        else
-        {
-            do_file(get_path_buffer(), &file_info, params);
-        }
-        errno = 0; /* reset errno for next call to readdir() */
-    }
-    if (0 != errno)
+/**
+ *
+ * \brief Counts the file being examined against -limit before an action is carried out for it.
+ *
+ * A file counts once, however many actions it reaches. The counter is shared by the workers,
+ * so no more than -limit files are acted upon with -j either.
+ *
+ * \return TRUE the action may be carried out, FALSE the limit was reached by other files.
+ */
+static boolean count_match(void)
+{
+    long count = 0;
+
+    if ((0 == slimit) || scurrent_context->counted)
     {
-        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s': readdir() failed: %s.", dir_name,
-                strerror(errno));
-        print_error(get_print_buffer());
+        return TRUE;
     }
-
-    if (closedir(dirhandle) < 0)
+    count = atomic_fetch_add(&smatches, 1) + 1;
+    if (count >= slimit)
     {
-        snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s':closedir() failed: %s.", dir_name,
-                strerror(errno));
-        print_error(get_print_buffer());
+        stop_traversal();
     }
+    scurrent_context->counted = (count <= slimit);
 
-    return EXIT_SUCCESS;
-
+    return scurrent_context->counted;
 }
 
 /**
  *
- * \brief Handle the file.
+ * \brief Stops the traversal (-quit, -limit).
  *
- * \param file_name is the filename which has to be checked against the find options.
- * \param file_info file information of file_name which has to be checked against the find options.
- * \param params is the program argument vector.
+ * The workers leave their directories at the next entry, the queued tasks are dropped and the
+ * idle workers are woken up to terminate.
  *
- * \return int represents the exit status of do_file.
- * \retval EXIT_SUCCESS successful exit status.
- * \retval EXIT_FAILURE failing exit status.
+ * \return void
  */
-static int do_file(const char* file_name, StatType* file_info, const char* const* params)
+static void stop_traversal(void)
 {
+    atomic_store(&sstopped, TRUE);
+    pthread_mutex_lock(&sidle_lock);
+    pthread_cond_broadcast(&swork_available);
+    pthread_mutex_unlock(&sidle_lock);
+}
 
-    int i = 1;
-    boolean printed_print = FALSE; /* flag for: already printed */
-    boolean printed_ls = FALSE; /* flag for: already printed in ls mode*/
+/**
+ *
+ * \brief Handle the file for one clause of the program.
+ *
+ * The filters are and-ed, so once one of them failed none of the remaining ones is evaluated.
+ * Without -o the clause is the complete program.
+ *
+ * \param clause the clause to be evaluated.
+ * \param entry is the directory entry which has to be checked against the find options.
+ * \param file_info file information of entry which has to be checked against the find options.
+ *
+ * \return boolean value of the clause.
+ * \retval TRUE all filters matched or the clause has no filter, the remaining clauses are skipped.
+ * \retval FALSE a filter did not match.
+ */
+static boolean do_clause(const Clause* clause, FileEntry* entry, StatType* file_info)
+{
+    const Instruction* instruction = sprogram.code + clause->start;
+    const Instruction* const end = sprogram.code + clause->end;
+    boolean printed = FALSE; /* flag for: already printed by -print or -ls */
     boolean to_print_ls = FALSE; /* flag for: must be printed in ls mode*/
-    boolean matched = FALSE; /* flag for: line meets filter criteria */
-    boolean filter = FALSE; /* flag for: result of filter */
-    boolean filtered = FALSE; /* flag for: at least one filter has been applied */
-    boolean path_given = FALSE; /* flag for: first commandline parameter is a file/dir */
-    char test_char = '\0';
-
-    /*check if first command line parameter is an option or a file/dir*/
-    test_char = *params[1];
-    path_given = ('-' == test_char) ? FALSE : TRUE;
-    matched = path_given;
-
-    /* loop all command line parameters */
-    while (NULL != params[i])
-    {
-        /* could be later optimzed by remembering for each params[i] element, if it
-         * is matched for the i-th parameter, store for each filter in an bool filter_array[argc]
-         * if strcmp matched for the filter e.g for type cmp_filter_type[arg]
-         */
-        /* apply filters */
-        if (strcmp(params[i], PARAM_STR_TYPE) == 0)
-        {
-            filter = filter_type(i, params, file_info);
-            matched = matched && filter;
-            filtered = TRUE;
-            ++i;
-            continue;
-        }
-
-        if (strcmp(params[i], PARAM_STR_USER) == 0)
-        {
-            filter = filter_user(i, params, file_info);
-            matched = matched && filter;
-            filtered = TRUE;
-            ++i;
-            continue;
-        }
-
-        if (strcmp(params[i], PARAM_STR_NOUSER) == 0)
-        {
-            filter = filter_nouser(file_info);
-            matched = matched && filter;
-            filtered = TRUE;
-            ++i;
-            continue;
-        }
+    boolean matched = sprogram.initial_match; /* flag for: line meets filter criteria */
+    StatsCounters* stats = &scurrent_context->stats;
+    uint64_t started = 0;
 
-        if (strcmp(params[i], PARAM_STR_NAME) == 0)
-        {
-            filter = filter_name(file_name, i, params);
-            matched = matched && filter;
-            filtered = TRUE;
-            ++i;
-            continue;
-        }
+    if (!matched)
+    {
+        /* the filters can not match anymore, only a deferred -ls is left */
+        to_print_ls = (clause->end > clause->start) && instruction->ls_follows;
+        instruction = end;
+    }
 
-        if (strcmp(params[i], PARAM_STR_PATH) == 0)
+    for (; instruction < end; ++instruction)
+    {
+        switch (instruction->op)
         {
-            filter = filter_path(file_name, i, params);
-            matched = matched && filter;
-            filtered = TRUE;
-            ++i;
-            continue;
-        }
+        /* apply filters */
+        case OP_TYPE:
+            matched = filter_type(instruction->arg.type, file_info);
+            break;
+        case OP_USER:
+            matched = filter_user(instruction->arg.uid, file_info);
+            break;
+        case OP_NOUSER:
+            matched = filter_nouser(file_info);
+            break;
+        case OP_NAME:
+            matched = filter_name(entry->name, instruction->arg.pattern);
+            break;
+        case OP_NAME_SET:
+            matched = filter_name_set(entry->name, instruction->arg.pattern_set);
+            break;
+        case OP_PATH:
+            matched = filter_path(get_entry_path(entry), instruction->arg.pattern);
+            break;
 
         /* apply actions */
-        if (strcmp(params[i], PARAM_STR_LS) == 0)
-        {
-            if (filtered && matched)
+        case OP_LS:
+            if (instruction->after_filter && matched)
             {
-                print_detail_ls(file_name, file_info);
-                printed_ls = TRUE;
+                if (count_match())
+                {
+                    started = start_phase();
+                    print_detail_ls(get_entry_path(entry), file_info);
+                    end_phase(&stats->output_ns, started);
+                }
+                printed = TRUE;
             }
             else
             {
                 /* special case -ls defined before filter parameters */
                 to_print_ls = TRUE;
             }
-        }
-        if (strcmp(params[i], PARAM_STR_PRINT) == 0)
-        {
-            if (filtered && matched)
+            break;
+        case OP_PRINT:
+            if (instruction->after_filter && matched)
             {
-                print_detail_print(file_name);
-                printed_print = TRUE;
+                if (count_match())
+                {
+                    started = start_phase();
+                    print_detail_print(get_entry_path(entry));
+                    end_phase(&stats->output_ns, started);
+                }
+                printed = TRUE;
             }
+            break;
+        case OP_EXEC:
+            /* runs right away, wherever it stands */
+            started = start_phase();
+            matched = count_match() && do_exec(instruction->arg.exec, entry);
+            end_phase(&stats->output_ns, started);
+            break;
+        case OP_PRUNE:
+            /* the walker checks the flag before it opens the directory */
+            scurrent_context->prune = TRUE;
+            break;
+        case OP_QUIT:
+            stop_traversal();
+            break;
+        }
+        if (sstats)
+        {
+            ++stats->evaluations[instruction - sprogram.code];
+            stats->passes[instruction - sprogram.code] += matched;
         }
 
-        ++i;
+        if (OP_QUIT == instruction->op)
+        {
+            /* nothing after -quit is evaluated */
+            break;
+        }
+
+        if (!matched)
+        {
+            /* short-circuit: every action left behaves as if it came before the filters */
+            to_print_ls = to_print_ls || instruction->ls_follows;
+            break;
+        }
     }
 
     /* special cases */
-    /* no -print action or no filter parameter on command line */
-    if ((matched && !printed_print && !printed_ls) || (!filtered))
+    /* no -print action or no filter parameter in the clause; with -o a clause without action
+     * only prints if the whole program has none, -exec alone does not print */
+    if (((matched && !printed) || (!clause->has_filter))
+            && (clause->has_output || !sprogram.has_action) && count_match())
     {
+        started = start_phase();
         if (to_print_ls)
         {
-            print_detail_ls(file_name, file_info);
+            print_detail_ls(get_entry_path(entry), file_info);
         }
         else
         {
-            print_detail_print(file_name);
+            print_detail_print(get_entry_path(entry));
         }
+        end_phase(&stats->output_ns, started);
     }
 
-    return EXIT_SUCCESS;
+    return matched || !clause->has_filter;
 }
 
 /**
@@ -735,11 +4548,12 @@ static int do_file(const char* file_name, StatType* file_info, const char* const
 int init(const char** program_args)
 {
     sprogram_arg0 = program_args[0];
+    scurrent_context = &smain_context;
 
-    if (NULL == sprint_buffer)
+    if (NULL == smain_context.print_buffer)
     {
-        sprint_buffer = (char*) malloc(MAX_PRINT_BUFFER * sizeof(char));
-        if (NULL == sprint_buffer)
+        smain_context.print_buffer = (char*) malloc(MAX_PRINT_BUFFER * sizeof(char));
+        if (NULL == smain_context.print_buffer)
         {
             fprintf(stderr, "%s: %s\n", sprogram_arg0, "Out of memory.\n");
             return ENOMEM;
@@ -757,19 +4571,65 @@ int init(const char** program_args)
         return ENODATA;
     }
 
-    if (NULL == spath_buffer)
+    return init_context(&smain_context, 0);
+
+}
+
+/**
+ * \brief Allocates the buffers of a worker context.
+ *
+ * Buffers which are already allocated are kept.
+ *
+ * \param context to be initialized.
+ * \param id index of the worker.
+ *
+ * \return EXIT_SUCCESS the context is ready for use.
+ * \retval ENOMEM posix error out of memory.
+ */
+static int init_context(WorkerContext* context, const int id)
+{
+    context->id = id;
+
+    if (NULL == context->print_buffer)
+    {
+        context->print_buffer = (char*) malloc(MAX_PRINT_BUFFER * sizeof(char));
+        if (NULL == context->print_buffer)
+        {
+            print_error("malloc() failed: Out of memory.");
+            return ENOMEM;
+        }
+    }
+    if (NULL == context->path_buffer)
+    {
+        context->path_buffer = (char*) malloc(smax_path * sizeof(char));
+        if (NULL == context->path_buffer)
+        {
+            print_error("malloc() failed: Out of memory.");
+            return ENOMEM;
+        }
+        context->path_buffer_capacity = (size_t) smax_path;
+    }
+    if (NULL == context->basename_buffer)
+    {
+        context->basename_buffer = (char*) malloc(smax_path * sizeof(char));
+        if (NULL == context->basename_buffer)
+        {
+            print_error("malloc() failed: Out of memory.");
+            return ENOMEM;
+        }
+    }
+    if (NULL == context->output.data)
     {
-        spath_buffer = (char*) malloc(smax_path * sizeof(char));
-        if (NULL == spath_buffer)
+        if (0 != output_init(&context->output, STDOUT_FILENO, OUTPUT_BUFFER_SIZE))
         {
             print_error("malloc() failed: Out of memory.");
             return ENOMEM;
         }
     }
-    if (NULL == sbasename_buffer)
+    if (sstats && (NULL == context->stats.evaluations))
     {
-        sbasename_buffer = (char*) malloc(smax_path * sizeof(char));
-        if (NULL == sbasename_buffer)
+        /* the main thread gets its counters once the program is compiled */
+        if (0 != stats_init(&context->stats, (size_t) sprogram.length))
         {
             print_error("malloc() failed: Out of memory.");
             return ENOMEM;
@@ -777,26 +4637,101 @@ int init(const char** program_args)
     }
 
     return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Frees the buffers of a worker context, pending output is written.
+ *
+ * \param context to be freed.
+ *
+ * \return void
+ */
+static void free_context(WorkerContext* context)
+{
+    int error = 0;
+    size_t i = 0;
+
+    error = output_flush(&context->output);
+    output_free(&context->output);
+    if (0 != error)
+    {
+        print_error(strerror(error));
+    }
+
+    free(context->path_buffer);
+    context->path_buffer = NULL;
+    context->path_buffer_capacity = 0;
+
+    free(context->basename_buffer);
+    context->basename_buffer = NULL;
+
+    for (i = 0; i < context->frame_capacity; ++i)
+    {
+        free(context->frames[i].batch.entries);
+        free(context->frames[i].batch.names);
+    }
+    free(context->frames);
+    context->frames = NULL;
+    context->frame_capacity = 0;
+
+    free(context->stat_order);
+    context->stat_order = NULL;
+    context->stat_order_capacity = 0;
+
+    free(context->stat_requests);
+    context->stat_requests = NULL;
+    context->stat_request_capacity = 0;
+
+    stats_free(&context->stats);
 
+    if (context->ring_ready)
+    {
+        stat_ring_free(&context->ring);
+        context->ring_ready = FALSE;
+        if (sstats)
+        {
+            stats_open_fds(-1);
+        }
+    }
+    context->ring_failed = FALSE;
+
+    free(context->dirent_buffer);
+    context->dirent_buffer = NULL;
+
+    if (NULL != context->exec_batches)
+    {
+        for (i = 0; i < (size_t) context->exec_batch_count; ++i)
+        {
+            exec_batch_free(&context->exec_batches[i]);
+        }
+        free(context->exec_batches);
+        context->exec_batches = NULL;
+        context->exec_batch_count = 0;
+    }
+
+    free(context->path_arena);
+    context->path_arena = NULL;
+    context->arena_capacity = 0;
+
+    free(context->print_buffer);
+    context->print_buffer = NULL;
 }
 
 /**
  * \brief Cleanup the program.
  *
+ * Frees the buffers of the calling thread, the other workers keep theirs until exit.
+ *
  * \param exit_program when set to TRUE exit program immediately with EXIT_FAILURE.
  *
  * \return void
  */
 void cleanup(boolean exit_program)
 {
-    free(spath_buffer);
-    spath_buffer = NULL;
-
-    free(sbasename_buffer);
-    sbasename_buffer = NULL;
-
-    free(sprint_buffer);
-    sprint_buffer = NULL;
+    if (NULL != scurrent_context)
+    {
+        free_context(scurrent_context);
+    }
 
     fflush(stderr);
     fflush(stdout);
@@ -831,53 +4766,39 @@ void print_error(const char* message)
 }
 
 /**
- *\brief Determines if the given user exists.
+ *\brief Resolves the argument of -user to a user id.
+ *
+ * The argument is looked up as user name first. If there is no such user,
+ * a numeric argument is taken as user id (which does not need to exist).
  *
- * Check if the given user exist as an user on the system.
+ *\param user user name or user id given as argument to -user.
+ *\param uid receives the user id.
  *
- *\param user_name to be queried.
- *\param search_for_uid search for uid if user not found.
- *\
- *\return FALSE user does not exist, TRUE user exists.
+ *\return FALSE user does not exist, TRUE user id resolved.
  */
-static boolean user_exist(const char* user_name, const boolean search_for_uid)
+static boolean resolve_user(const char* user, uid_t* uid)
 {
     struct passwd* pwd = NULL;
     char* end_userid = NULL;
-    uid_t uid = 0;
-
-    pwd = getpwnam(user_name);
+    unsigned int search_uid = 0;
 
+    pwd = getpwnam(user);
     if (NULL != pwd)
     {
         /* the user exist */
+        *uid = pwd->pw_uid;
         return TRUE;
     }
-    else if (FALSE == search_for_uid)
-    {
-        return FALSE;
-    }
 
     /* is it a user id instead of a user name? */
-    errno = 0;
-    uid = (uid_t) strtol(user_name, &end_userid, USERID_BASE);
-    if (errno)
-    {
-        return FALSE;
-    }
-    if (0 == uid)
-    {
-        return FALSE;
-    }
-
-    pwd = getpwuid(uid);
-    if (NULL == pwd)
+    search_uid = strtol(user, &end_userid, USERID_BASE);
+    if ('\0' != *end_userid)
     {
         return FALSE;
     }
 
+    *uid = (uid_t) search_uid;
     return TRUE;
-
 }
 
 /**
@@ -889,10 +4810,7 @@ static boolean user_exist(const char* user_name, const boolean search_for_uid)
  */
 static boolean has_no_user(StatType* file_info)
 {
-    struct passwd* pwd = NULL;
-
-    pwd = getpwuid(file_info->st_uid);
-    return (pwd == NULL);
+    return (NULL == idcache_user_name(file_info->st_uid));
 }
 
 /**
@@ -939,31 +4857,67 @@ static char get_file_type(const StatType* file_info)
 
 }
 
+/**
+ * \brief File type bits of st_mode for a -type character.
+ *
+ * \param type file type character, one of PARAM_STR_TYPE_VALS.
+ *
+ * \return S_IF... of the type.
+ */
+static mode_t get_type_mode(const char type)
+{
+    switch (type)
+    {
+    case 'b':
+        return S_IFBLK;
+    case 'c':
+        return S_IFCHR;
+    case 'd':
+        return S_IFDIR;
+    case 'p':
+        return S_IFIFO;
+    case 'l':
+        return S_IFLNK;
+    case 's':
+        return S_IFSOCK;
+    default:
+        return S_IFREG;
+    }
+}
+
 /**
  * \brief Filters the directory entry due to -name  parameter.
  *
- * Applies -name filter (if defined) to path_to_examine.
+ * Applies -name filter (if defined) to name_to_examine.
  *
- * \param path_to_examine directory entry to investigate for name.
- * \param current_param currently processed parameter index.
- * \param params Program parameter arguments given by user.
+ * \param name_to_examine base name of the directory entry to investigate.
+ * \param pattern compiled glob pattern given as argument to -name.
  *
  * \return boolean result indicating filter has matched.
  * \retval TRUE name filter matched or not given.
  * \retval FALSE no match found.
  */
-static boolean filter_name(const char* path_to_examine, const int current_param,
-        const char* const* params)
+static boolean filter_name(const char* name_to_examine, const Pattern* pattern)
 {
-    char* buffer = NULL;
-
-    /*  We match the actual file path against the pattern
+    /*  We match the base name of the file against the pattern
      *  delivered as argument to -name
      */
-    buffer = strcpy(get_base_name_buffer(), path_to_examine);
-    buffer = basename(buffer);
-    /* Do we have a pattern match? */
-    return (0 == fnmatch(params[current_param + 1], buffer, 0));
+    return pattern_match(pattern, name_to_examine);
+}
+
+/**
+ * \brief Filters the directory entry due to -name-from parameter or -name joined by -o.
+ *
+ * \param name_to_examine base name of the directory entry to investigate.
+ * \param set compiled glob patterns.
+ *
+ * \return boolean result indicating filter has matched.
+ * \retval TRUE at least one of the patterns matched.
+ * \retval FALSE no match found.
+ */
+static boolean filter_name_set(const char* name_to_examine, const PatternSet* set)
+{
+    return pattern_set_match(set, name_to_examine);
 }
 
 /**
@@ -972,26 +4926,19 @@ static boolean filter_name(const char* path_to_examine, const int current_param,
  * Applies -name filter (if defined) to path_to_examine.
  *
  * \param path_to_examine directory entry to investigate for path.
- * \param current_param currently processed parameter index.
- * \param params Program parameter arguments given by user.
+ * \param pattern compiled glob pattern given as argument to -path.
  *
  * \return boolean result indicating filter has matched.
  * \retval TRUE name filter matched or not given.
  * \retval FALSE no match found.
  */
-static boolean filter_path(const char* path_to_examine, const int current_param,
-        const char* const* params)
+static boolean filter_path(const char* path_to_examine, const Pattern* pattern)
 {
-    char* buffer = NULL;
-
     /**
      *  We match the actual file path against the pattern
      *  delivered as argument to -path
      */
-    buffer = strcpy(get_base_name_buffer(), path_to_examine);
-
-    /* Do we have a pattern match? */
-    return (0 == fnmatch(params[current_param + 1], buffer, FNM_PATHNAME));
+    return pattern_match(pattern, path_to_examine);
 }
 
 /**
@@ -1016,55 +4963,16 @@ static boolean filter_nouser(StatType* file_info)
  *
  * Applies -user filter (if defined) to file_info.
  *
- * \param current_param currently processed parameter index.
- * \param params Program parameter arguments given by user.
+ * \param uid user id given as argument to -user, resolved by resolve_user().
  * \param file_info as read from operating system.
  *
  * \return boolean result indicating filter has matched.
  * \retval TRUE name filter matched or not given.
  * \retval FALSE no match found.
  */
-static boolean filter_user(const int current_param, const char* const* params, StatType* file_info)
+static boolean filter_user(const uid_t uid, StatType* file_info)
 {
-    unsigned int search_uid = 0;
-    char * end_ptr = NULL;
-    struct passwd* pwd = NULL;
-
-    search_uid = strtol(params[current_param + 1], &end_ptr, USERID_BASE);
-    if (('\0' != *end_ptr) || user_exist(params[current_param + 1], FALSE))
-    {
-        /*  string to int conversion failed --> we have a username */
-        /*  or special case --> username is pure numeric */
-        if (user_exist(params[current_param + 1], FALSE))
-        {
-            pwd = getpwuid(file_info->st_uid);
-            if (pwd != NULL)
-            {
-                if (strcmp(pwd->pw_name, params[current_param + 1]) == 0)
-                {
-                    /* parameter of -user is equal to
-                     * user name derived from UID */
-                    return TRUE;
-                }
-            }
-            return FALSE;
-        }
-        else
-        {
-            snprintf(get_print_buffer(), MAX_PRINT_BUFFER, "`%s' is not the name of a known user",
-                    params[current_param + 1]);
-            print_error(get_print_buffer());
-            cleanup(TRUE);
-            return FALSE;
-        }
-    }
-    else
-    {
-        /* successfull string to int conversion */
-        /* -> parameter of -user seems to be an UID */
-        return (search_uid == file_info->st_uid);
-    }
-    return TRUE;
+    return (uid == file_info->st_uid);
 }
 
 /**
@@ -1072,8 +4980,7 @@ static boolean filter_user(const int current_param, const char* const* params, S
  *
  * Applies -type filter (if defined) to file_info.
  *
- * \param current_param currently processed parameter index.
- * \param params Program parameter arguments given by user.
+ * \param type file type character given as argument to -type.
  * \param file_info as read from operating system.
  *
  * \return boolean result indicating filter has matched.
@@ -1081,244 +4988,166 @@ static boolean filter_user(const int current_param, const char* const* params, S
  * \retval FALSE no match found.
  */
 
-static boolean filter_type(const int current_param, const char* const* params, StatType* file_info)
+static boolean filter_type(const char type, StatType* file_info)
 {
-    const char* parameter1 = NULL;
-
-    parameter1 = params[current_param + 1];
     /* check if option argument describes the same file type as file to examine has */
-    return (*parameter1 == get_file_type(file_info));
+    return (type == get_file_type(file_info));
 }
 
 /**
- * \brief Print out last changed date of file on standard output.
+ * \brief Render last changed date of file.
  *
+ * The date is rendered like strftime() "%b %e %H:%M". Most files of a tree share a few
+ * minutes, so each worker remembers the rendered minutes and calls localtime_r() on a miss only.
+ *
+ * \param dest where to render.
  * \param file_info with the file attributes.
  *
- * \return void
+ * \return end of the rendered text.
  **/
-void print_file_change_time(const StatType* file_info)
+static char* print_file_change_time(char* dest, const StatType* file_info)
 {
-    char * buffer_char = NULL;
-    int i = 0;
-    int written = 0;
-    size_t written_time = 0;
-
-    /* Convert the time into the local time format it. */
-    written_time = strftime(get_print_buffer(), MAX_PRINT_BUFFER - 1, "%b %d %H:%M",
-            localtime(&file_info->st_mtime));
-    if (0 == written_time)
-    {
-        snprintf(get_print_buffer(), MAX_PRINT_BUFFER,
-                "strftime() failed: Could not print file changed time\n.");
-        print_error(get_print_buffer());
-        return;
-    }
+    const time_t mtime = file_info->st_mtime;
+    TimeCacheEntry* cached = NULL;
+    struct tm local_time;
+    char* text = NULL;
 
-    /* as strftime Format Parameter %e is not supported on Annubis
-     * we have to adjust the remove leading 0 in the day */
-    buffer_char = get_print_buffer();
-    for (i = 0; i < MAX_PRINT_BUFFER; i++)
+    cached = &scurrent_context->time_cache[((unsigned long) (mtime / 60)) & (TIME_CACHE_SLOTS - 1)];
+    if ((mtime < cached->start) || (mtime >= cached->end))
     {
-        if (' ' == buffer_char[i])
+        /* Convert the time into the local time and format it. */
+        if (NULL == localtime_r(&mtime, &local_time))
         {
-            if ('0' == buffer_char[i + 1])
-            {
-                buffer_char[i + 1] = ' ';
-            }
-            break;
+            print_error("localtime_r() failed: Could not print file changed time.");
+            return dest;
         }
-    }
 
-    written = fprintf(stdout, "%s", get_print_buffer());
-    if (written < 0)
-    {
-        print_error("fprintf() failed: Could not write time to stdout.\n");
+        text = cached->text;
+        memcpy(text, MONTH_NAMES[local_time.tm_mon], 3);
+        text[3] = ' ';
+        /* day of month with leading blank instead of 0 */
+        text[4] = (local_time.tm_mday < 10) ? ' ' : (char) ('0' + local_time.tm_mday / 10);
+        text[5] = (char) ('0' + local_time.tm_mday % 10);
+        text[6] = ' ';
+        text[7] = (char) ('0' + local_time.tm_hour / 10);
+        text[8] = (char) ('0' + local_time.tm_hour % 10);
+        text[9] = ':';
+        text[10] = (char) ('0' + local_time.tm_min / 10);
+        text[11] = (char) ('0' + local_time.tm_min % 10);
+
+        /* the text is valid for the whole local minute */
+        cached->start = mtime - local_time.tm_sec;
+        cached->end = cached->start + 60;
     }
 
+    memcpy(dest, cached->text, LS_TIME_LENGTH);
+    return dest + LS_TIME_LENGTH;
 }
 
 /**
- * \brief Print the file permissions on standard output.
+ * \brief Render the file permissions.
  *
+ * \param dest where to render.
  * \param file_info with all file attributes read out from operating system.
  *
- * \return void
+ * \return end of the rendered text.
  **/
-void print_file_permissions(const StatType* file_info)
+static char* print_file_permissions(char* dest, const StatType* file_info)
 {
-    /* Print file type */
-    int written = 0;
+    const mode_t mode = file_info->st_mode;
     char file_type_character = '\0';
 
+    /* Print file type */
     file_type_character = get_file_type(file_info);
     if (file_type_character == 'f')
     {
         file_type_character = '-';
     }
+    *dest++ = file_type_character;
 
-    written = fprintf(stdout, "%c", file_type_character);
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-
-    /* Print user permissions */
-    written = fprintf(stdout, "%c", (file_info->st_mode & S_IRUSR ? 'r' : '-'));
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-
-    written = fprintf(stdout, "%c", (file_info->st_mode & S_IWUSR ? 'w' : '-'));
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-
-    if (!(file_info->st_mode & S_ISUID))
-    {
-        /*no UID-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_IXUSR ? 'x' : '-'));
-    }
-    else if ((file_info->st_mode & S_ISUID) && (file_info->st_mode & S_IXUSR))
+    /* Print user permissions, UID-Bit shown in place of the execute bit */
+    *dest++ = (mode & S_IRUSR) ? 'r' : '-';
+    *dest++ = (mode & S_IWUSR) ? 'w' : '-';
+    if (!(mode & S_ISUID))
     {
-        /* UID-Bit && Execute-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_ISUID ? 's' : '-'));
+        *dest++ = (mode & S_IXUSR) ? 'x' : '-';
     }
     else
     {
-        /* UID-Bit && !Execute-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_ISUID ? 'S' : '-'));
-    }
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-
-    /* Print group permissions */
-    written = fprintf(stdout, "%c", (file_info->st_mode & S_IRGRP ? 'r' : '-'));
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-    written = fprintf(stdout, "%c", (file_info->st_mode & S_IWGRP ? 'w' : '-'));
-    if (written < 0)
-    {
-        print_error(strerror(errno));
+        *dest++ = (mode & S_IXUSR) ? 's' : 'S';
     }
 
-    if (!(file_info->st_mode & S_ISGID))
-    {
-        /* no GID-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_IXGRP ? 'x' : '-'));
-    }
-    else if ((file_info->st_mode & S_ISGID) && (file_info->st_mode & S_IXGRP))
+    /* Print group permissions, GID-Bit shown in place of the execute bit */
+    *dest++ = (mode & S_IRGRP) ? 'r' : '-';
+    *dest++ = (mode & S_IWGRP) ? 'w' : '-';
+    if (!(mode & S_ISGID))
     {
-        /* GID-Bit && Execute-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_ISGID ? 's' : '-'));
+        *dest++ = (mode & S_IXGRP) ? 'x' : '-';
     }
     else
     {
-        /* GID-Bit && !Execute-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_ISGID ? 'S' : '-'));
-    }
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-
-    /* Print other permissions */
-    written = fprintf(stdout, "%c", (file_info->st_mode & S_IROTH ? 'r' : '-'));
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
-    written = fprintf(stdout, "%c", (file_info->st_mode & S_IWOTH ? 'w' : '-'));
-    if (written < 0)
-    {
-        print_error(strerror(errno));
+        *dest++ = (mode & S_IXGRP) ? 's' : 'S';
     }
 
-    if (!(file_info->st_mode & S_ISVTX))
+    /* Print other permissions, Sticky-Bit shown in place of the execute bit */
+    *dest++ = (mode & S_IROTH) ? 'r' : '-';
+    *dest++ = (mode & S_IWOTH) ? 'w' : '-';
+    if (!(mode & S_ISVTX))
     {
-        /* Sticky-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_IXOTH ? 'x' : '-'));
-    }
-    else if ((file_info->st_mode & S_ISVTX) && (file_info->st_mode & S_IXOTH))
-    {
-        /* Sticky-Bit && Execute-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_ISVTX ? 't' : '-'));
+        *dest++ = (mode & S_IXOTH) ? 'x' : '-';
     }
     else
     {
-        /* Sticky-Bit && !Execute-Bit */
-        written = fprintf(stdout, "%c", (file_info->st_mode & S_ISVTX ? 'T' : '-'));
-    }
-    if (written < 0)
-    {
-        print_error(strerror(errno));
+        *dest++ = (mode & S_IXOTH) ? 't' : 'T';
     }
 
-    written = fprintf(stdout, "  ");
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
+    *dest++ = ' ';
+    *dest++ = ' ';
+
+    return dest;
 }
 
 /**
- * \brief Print user name and group name to standard out.
+ * \brief Render user name and group name.
  *
+ * \param dest where to render.
  * \param file_info with all file attributes read out from operating system.
+ * \param user_name name of the owner, NULL if unknown.
+ * \param group_name name of the group, NULL if unknown.
  *
- * \return void
+ * \return end of the rendered text.
  **/
-static void print_user_group(const StatType* file_info)
+static char* print_user_group(char* dest, const StatType* file_info, const char* user_name,
+        const char* group_name)
 {
-    struct passwd* password;
-    struct group* group_info;
-    int written = 0;
-
     /* Print user name */
-    password = getpwuid(file_info->st_uid);
-    if (NULL != password)
+    if (NULL != user_name)
     {
-        written = fprintf(stdout, "%5s", password->pw_name);
+        dest = format_string(dest, user_name, strlen(user_name), 5);
     }
     else
     {
-        written = fprintf(stdout, "%7d", file_info->st_uid);
-    }
-    if (written < 0)
-    {
-        print_error(strerror(errno));
+        dest = format_signed(dest, (int) file_info->st_uid, 7);
     }
 
     /* Print group name */
-    group_info = getgrgid(file_info->st_gid);
-    if (NULL != password)
-    {
-        written = fprintf(stdout, "%9s", group_info->gr_name);
-    }
-    else if (NULL != group_info)
+    if (NULL != group_name)
     {
-        written = fprintf(stdout, "%9s", group_info->gr_name);
+        dest = format_string(dest, group_name, strlen(group_name), 9);
     }
     else
     {
-        written = fprintf(stdout, "%9d", file_info->st_gid);
-    }
-    if (written < 0)
-    {
-        print_error(strerror(errno));
+        dest = format_signed(dest, (int) file_info->st_gid, 9);
     }
 
+    return dest;
 }
 
 /**
  * \brief Print the detailed info of matched file to standard out.
  *
+ * The whole line is rendered into the output buffer in one go.
+ *
  * \param file_path Fully qualified file name with path read out from operating system.
  * \param file_info with all file attributes read out from operating system.
  *
@@ -1326,18 +5155,32 @@ static void print_user_group(const StatType* file_info)
  **/
 static void print_detail_ls(const char* file_path, StatType* file_info)
 {
-    int written = 0;
-
-    combine_ls(file_info);
-    written = printf(" ");
-    if (written < 0)
+    const char* user_name = idcache_user_name(file_info->st_uid);
+    const char* group_name = idcache_group_name(file_info->st_gid);
+    size_t path_length = strlen(file_path);
+    size_t size = path_length + LS_LINE_RESERVE;
+    char* dest = NULL;
+    int error = 0;
+
+    size += (NULL != user_name) ? strlen(user_name) : 0;
+    size += (NULL != group_name) ? strlen(group_name) : 0;
+    dest = output_claim(get_output_buffer(), size);
+    if (NULL == dest)
     {
-        print_error(strerror(errno));
+        print_error("malloc() failed: Out of memory.");
+        return;
     }
-    written = printf("%s\n", file_path);
-    if (written < 0)
+
+    dest = combine_ls(dest, file_info, user_name, group_name);
+    *dest++ = ' ';
+    memcpy(dest, file_path, path_length);
+    dest += path_length;
+    *dest++ = '\n';
+
+    error = output_commit(get_output_buffer(), dest);
+    if (0 != error)
     {
-        print_error(strerror(errno));
+        print_error(strerror(error));
     }
 }
 
@@ -1350,33 +5193,45 @@ static void print_detail_ls(const char* file_path, StatType* file_info)
  **/
 static void print_detail_print(const char* file_path)
 {
-    int written = 0;
-    written = printf("%s\n", file_path);
-    if (written < 0)
+    size_t path_length = strlen(file_path);
+    char* dest = NULL;
+    int error = 0;
+
+    dest = output_claim(get_output_buffer(), path_length + 1);
+    if (NULL == dest)
     {
-        print_error(strerror(errno));
+        print_error("malloc() failed: Out of memory.");
+        return;
+    }
+
+    memcpy(dest, file_path, path_length);
+    dest += path_length;
+    *dest++ = '\n';
+
+    error = output_commit(get_output_buffer(), dest);
+    if (0 != error)
+    {
+        print_error(strerror(error));
     }
 }
 
 /**
- * \brief Print on standard out the -ls arguments: number of i-nodes,blocks, permissions,
+ * \brief Render the -ls arguments: number of i-nodes,blocks, permissions,
  number of links, owner, group, last modification time and directory name.
  symlinks.
  *
+ * \param dest where to render.
  * \param file_info with all file attributes read out from operating system.
+ * \param user_name name of the owner, NULL if unknown.
+ * \param group_name name of the group, NULL if unknown.
  *
- * \return void
+ * \return end of the rendered text.
  **/
-static void combine_ls(const StatType* file_info)
+static char* combine_ls(char* dest, const StatType* file_info, const char* user_name,
+        const char* group_name)
 {
-    int written = 0;
-
     /* Print i-node */
-    written = fprintf(stdout, "%6lu", (unsigned long) file_info->st_ino);
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
+    dest = format_unsigned(dest, (unsigned long) file_info->st_ino, 6);
 
     /* Print number of blocks */
     /* magic number divide by 2 depends on block size of file system.
@@ -1384,31 +5239,21 @@ static void combine_ls(const StatType* file_info)
      * The total number of physical blocks of size 512 bytes actually allocated on disk.
        see also http://stackoverflow.com/questions/1346807/how-does-stat-command-calculate-the-blocks-of-a-file
     */
-    written = fprintf(stdout, "%5lu ", (unsigned long) file_info->st_blocks / 2);
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
+    dest = format_unsigned(dest, (unsigned long) file_info->st_blocks / 2, 5);
+    *dest++ = ' ';
 
-    print_file_permissions(file_info);
+    dest = print_file_permissions(dest, file_info);
 
     /* Print number of hard links */
-    written = fprintf(stdout, "%2lu", (unsigned long) file_info->st_nlink);
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
+    dest = format_unsigned(dest, (unsigned long) file_info->st_nlink, 2);
 
-    print_user_group(file_info);
+    dest = print_user_group(dest, file_info, user_name, group_name);
 
     /* Print file size */
-    written = fprintf(stdout, "%13lu ", (unsigned long) file_info->st_size);
-    if (written < 0)
-    {
-        print_error(strerror(errno));
-    }
+    dest = format_unsigned(dest, (unsigned long) file_info->st_size, 13);
+    *dest++ = ' ';
 
-    print_file_change_time(file_info);
+    return print_file_change_time(dest, file_info);
 }
 
 /*
@@ -0,0 +1,231 @@
+/**
+ * @file output.c
+ * \brief Buffered output for myfind.
+ *
+ * Replaces stdio for the output of -print and -ls: no format parsing, no stream locking per
+ * call, and large write() calls.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "output.h"
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+/** Serializes the write() calls of all buffers, so records of different threads do not mix. */
+static pthread_mutex_t swrite_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void write_out(OutputBuffer* buffer);
+static int take_error(OutputBuffer* buffer);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+int output_init(OutputBuffer* buffer, const int fd, const size_t capacity)
+{
+    buffer->data = (char*) malloc(capacity);
+    if (NULL == buffer->data)
+    {
+        return ENOMEM;
+    }
+    buffer->length = 0;
+    buffer->capacity = capacity;
+    buffer->fd = fd;
+    buffer->line_mode = isatty(fd);
+    buffer->error = 0;
+
+    return 0;
+}
+
+void output_free(OutputBuffer* buffer)
+{
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+int output_flush(OutputBuffer* buffer)
+{
+    write_out(buffer);
+    return take_error(buffer);
+}
+
+char* output_claim(OutputBuffer* buffer, const size_t size)
+{
+    if ((buffer->capacity - buffer->length) < size)
+    {
+        write_out(buffer);
+        if (buffer->capacity < size)
+        {
+            char* data = (char*) realloc(buffer->data, size);
+
+            if (NULL == data)
+            {
+                return NULL;
+            }
+            buffer->data = data;
+            buffer->capacity = size;
+        }
+    }
+
+    return buffer->data + buffer->length;
+}
+
+int output_commit(OutputBuffer* buffer, const char* end)
+{
+    buffer->length = (size_t) (end - buffer->data);
+    if (buffer->line_mode)
+    {
+        write_out(buffer);
+    }
+
+    return take_error(buffer);
+}
+
+char* format_unsigned(char* dest, unsigned long value, const int width)
+{
+    char digits[OUTPUT_MAX_DIGITS];
+    int count = 0;
+    int padding = 0;
+
+    do
+    {
+        digits[count++] = (char) ('0' + (value % 10));
+        value /= 10;
+    } while (0 != value);
+
+    for (padding = width - count; padding > 0; --padding)
+    {
+        *dest++ = ' ';
+    }
+    while (count > 0)
+    {
+        *dest++ = digits[--count];
+    }
+
+    return dest;
+}
+
+char* format_signed(char* dest, const long value, const int width)
+{
+    char digits[OUTPUT_MAX_DIGITS];
+    unsigned long magnitude = (value < 0) ? (0UL - (unsigned long) value) : (unsigned long) value;
+    int count = 0;
+    int padding = 0;
+
+    do
+    {
+        digits[count++] = (char) ('0' + (magnitude % 10));
+        magnitude /= 10;
+    } while (0 != magnitude);
+    if (value < 0)
+    {
+        digits[count++] = '-';
+    }
+
+    for (padding = width - count; padding > 0; --padding)
+    {
+        *dest++ = ' ';
+    }
+    while (count > 0)
+    {
+        *dest++ = digits[--count];
+    }
+
+    return dest;
+}
+
+char* format_string(char* dest, const char* text, const size_t length, const int width)
+{
+    int padding = 0;
+
+    for (padding = width - (int) length; padding > 0; --padding)
+    {
+        *dest++ = ' ';
+    }
+    memcpy(dest, text, length);
+
+    return dest + length;
+}
+
+/**
+ *
+ * \brief Writes the buffered data, the first error is kept in the buffer.
+ *
+ * The data of one call is written without interruption by other threads.
+ *
+ * \param buffer to be written.
+ *
+ * \return void
+ */
+static void write_out(OutputBuffer* buffer)
+{
+    size_t written = 0;
+
+    if (0 == buffer->length)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&swrite_lock);
+    while (written < buffer->length)
+    {
+        ssize_t result = write(buffer->fd, buffer->data + written, buffer->length - written);
+
+        if (result < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            if (0 == buffer->error)
+            {
+                buffer->error = errno;
+            }
+            break;
+        }
+        written += (size_t) result;
+    }
+    pthread_mutex_unlock(&swrite_lock);
+
+    /* data which could not be written is dropped like stdio does */
+    buffer->length = 0;
+}
+
+/**
+ *
+ * \brief Fetches and resets the error kept in the buffer, so every error is reported once.
+ *
+ * \param buffer to be checked.
+ *
+ * \return errno value of the error, 0 if none.
+ */
+static int take_error(OutputBuffer* buffer)
+{
+    int error = buffer->error;
+
+    buffer->error = 0;
+    return error;
+}
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,159 @@
+/**
+ * @file output.h
+ * \brief Buffered output for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _OUTPUT_H_
+#define _OUTPUT_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stddef.h>
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Default size of an output buffer. */
+#define OUTPUT_BUFFER_SIZE (256 * 1024)
+
+/** Maximum number of characters format_unsigned()/format_signed() produce without padding. */
+#define OUTPUT_MAX_DIGITS 21
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * Output buffer of one thread.
+ *
+ * Records (lines) are rendered straight into the buffer and written with write() in large
+ * chunks. A record is never split as long as it fits into the buffer, so the buffers of
+ * several threads can share one file descriptor.
+ */
+typedef struct outputBufferStruct
+{
+    /** Buffered data. */
+    char* data;
+    /** Number of bytes buffered. */
+    size_t length;
+    /** Size of data. */
+    size_t capacity;
+    /** File descriptor to write to. */
+    int fd;
+    /** Flush after every record (the file descriptor is a terminal). */
+    int line_mode;
+    /** First write error (errno value) not reported yet, 0 if none. */
+    int error;
+} OutputBuffer;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Initializes an output buffer.
+ *
+ * \param buffer to be initialized.
+ * \param fd file descriptor to write to.
+ * \param capacity buffer size in bytes.
+ *
+ * \return 0 on success, ENOMEM if the buffer could not be allocated.
+ */
+extern int output_init(OutputBuffer* buffer, const int fd, const size_t capacity);
+
+/**
+ *
+ * \brief Frees an output buffer without flushing it.
+ *
+ * \param buffer to be freed.
+ *
+ * \return void
+ */
+extern void output_free(OutputBuffer* buffer);
+
+/**
+ *
+ * \brief Writes the buffered data.
+ *
+ * The data of one flush is written without interruption by other threads.
+ *
+ * \param buffer to be flushed.
+ *
+ * \return 0 on success, otherwise errno value of a failed write() which was not reported yet.
+ */
+extern int output_flush(OutputBuffer* buffer);
+
+/**
+ *
+ * \brief Claims space for rendering a record.
+ *
+ * Flushes the buffer first if less than size bytes are free, grows it if size exceeds its capacity.
+ * The record is rendered directly into the returned space and completed by output_commit().
+ *
+ * \param buffer to render into.
+ * \param size maximum size of the record.
+ *
+ * \return where to render the record, NULL if the buffer could not grow.
+ */
+extern char* output_claim(OutputBuffer* buffer, const size_t size);
+
+/**
+ *
+ * \brief Completes a record rendered into space claimed by output_claim().
+ *
+ * \param buffer rendered into.
+ * \param end points behind the last character of the record.
+ *
+ * \return 0 on success, otherwise errno value of a failed write() which was not reported yet.
+ */
+extern int output_commit(OutputBuffer* buffer, const char* end);
+
+/**
+ *
+ * \brief Renders an unsigned number right aligned (like printf("%*lu")).
+ *
+ * \param dest where to render.
+ * \param value to be rendered.
+ * \param width minimum field width, padded with blanks.
+ *
+ * \return end of the rendered text.
+ */
+extern char* format_unsigned(char* dest, unsigned long value, const int width);
+
+/**
+ *
+ * \brief Renders a signed number right aligned (like printf("%*ld")).
+ *
+ * \param dest where to render.
+ * \param value to be rendered.
+ * \param width minimum field width, padded with blanks.
+ *
+ * \return end of the rendered text.
+ */
+extern char* format_signed(char* dest, const long value, const int width);
+
+/**
+ *
+ * \brief Renders a string right aligned (like printf("%*s")).
+ *
+ * \param dest where to render.
+ * \param text to be rendered.
+ * \param length length of text.
+ * \param width minimum field width, padded with blanks.
+ *
+ * \return end of the rendered text.
+ */
+extern char* format_string(char* dest, const char* text, const size_t length, const int width);
+
+#endif /* _OUTPUT_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
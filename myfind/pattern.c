@@ -0,0 +1,1315 @@
+/**
+ * @file pattern.c
+ * \brief Compiled glob patterns for myfind.
+ *
+ * -name and -path patterns are compiled once instead of being interpreted by fnmatch() for
+ * every file. Patterns without wildcards and the common forms "*text", "text*" and "*text*"
+ * are matched with plain string functions, all others run as DFA over byte classes.
+ *
+ * A set of patterns (several -name joined by -o, -name-from) is compiled into one hash set of
+ * literals, one trie of suffixes and one automaton, so the cost per file does not grow with
+ * the number of patterns.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <fnmatch.h>
+#include "pattern.h"
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Largest automaton built, patterns needing more states are left to fnmatch(). */
+#define PATTERN_MAX_STATES 4096
+
+/** Slots of the hash table used to find known states, a power of two above twice the states. */
+#define PATTERN_STATE_SLOTS (4 * PATTERN_MAX_STATES)
+
+/** Number of 64 bit words of a set of bytes. */
+#define BYTESET_WORDS 4
+
+/** The pattern uses a construct the compiler does not handle. */
+#define PATTERN_UNSUPPORTED (-1)
+
+/** Initial number of patterns a set has room for. */
+#define PATTERN_SET_INITIAL_CAPACITY 16
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * Kinds of pattern items.
+ */
+typedef enum globItemKindEnum
+{
+    /** Matches one byte of its set. */
+    ITEM_CHAR,
+    /** Matches any number of bytes of its set. */
+    ITEM_STAR,
+    /** End of the pattern, reaching it means the pattern matched. */
+    ITEM_END
+} GlobItemKind;
+
+/**
+ * One item of a parsed pattern, the positions of the NFA are the items.
+ */
+typedef struct globItemStruct
+{
+    /** Kind of item. */
+    GlobItemKind kind;
+    /** Bytes matched by the item. */
+    uint64_t set[BYTESET_WORDS];
+} GlobItem;
+
+/**
+ * Deterministic automaton, a state is a set of NFA positions.
+ */
+struct dfaStruct
+{
+    /** Byte class of every byte, bytes of a class are matched by the same items. */
+    unsigned char classes[256];
+    /** Number of byte classes. */
+    size_t class_count;
+    /** Number of states. */
+    size_t state_count;
+    /** Next state per state and class, stored as index of its row; row 0 is the dead state. */
+    uint32_t* transitions;
+    /** Non zero for accepting states. */
+    unsigned char* accepting;
+    /** Row of the start state. */
+    uint32_t start;
+};
+
+/**
+ * Node of the trie of reversed suffixes.
+ */
+struct suffixNodeStruct
+{
+    /** First child, 0 if none (the root is never a child). */
+    uint32_t child;
+    /** Next node with the same parent, 0 if none. */
+    uint32_t sibling;
+    /** Byte leading from the parent to this node. */
+    unsigned char byte;
+    /** A suffix ends here. */
+    unsigned char terminal;
+};
+
+/**
+ * Working data of the subset construction.
+ */
+typedef struct dfaBuilderStruct
+{
+    /** Items of the pattern, ITEM_END terminated. */
+    const GlobItem* items;
+    /** Number of items. */
+    size_t count;
+    /** Number of 64 bit words of a set of positions. */
+    size_t words;
+    /** Position sets of all states, words per state. */
+    uint64_t* sets;
+    /** Number of states sets has room for. */
+    size_t capacity;
+    /** State number + 1 of the hash table slots, 0 for free slots. */
+    uint32_t* slots;
+    /** Automaton under construction. */
+    Dfa* dfa;
+} DfaBuilder;
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+static int parse_glob(const char* source, const int flags, GlobItem* items, size_t* count);
+static const unsigned char* parse_bracket(const unsigned char* bracket, const int flags,
+        uint64_t* set);
+static int add_char_class(const char* name, const size_t length, uint64_t* set);
+static int classify(Pattern* pattern, const GlobItem* items, const size_t count);
+static int get_single_byte(const uint64_t* set);
+static int dfa_build(Dfa** result, const GlobItem* items, const size_t count);
+static void init_classes(Dfa* dfa, const GlobItem* items, const size_t count,
+        unsigned char* representatives);
+static void close_positions(const DfaBuilder* builder, uint64_t* positions);
+static int intern_state(DfaBuilder* builder, const uint64_t* positions, uint32_t* state);
+static int dfa_match(const Dfa* dfa, const unsigned char* subject);
+static void dfa_free(Dfa* dfa);
+static uint64_t hash_string(const char* text);
+static void insert_literal(PatternSet* set, char* literal);
+static int insert_suffix(PatternSet* set, const char* text, const size_t length);
+static int match_suffix(const SuffixNode* nodes, const char* subject, size_t length);
+static int append_items(GlobItem** combined, size_t* combined_count, const GlobItem* items,
+        const size_t count);
+
+static inline int set_contains(const uint64_t* set, const unsigned int byte)
+{
+    return (int) ((set[byte >> 6] >> (byte & 63)) & 1);
+}
+
+static inline void set_insert(uint64_t* set, const unsigned int byte)
+{
+    set[byte >> 6] |= (uint64_t) 1 << (byte & 63);
+}
+
+static inline void set_remove(uint64_t* set, const unsigned int byte)
+{
+    set[byte >> 6] &= ~((uint64_t) 1 << (byte & 63));
+}
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+int pattern_compile(Pattern* pattern, const char* source, const int flags)
+{
+    GlobItem* items = NULL;
+    size_t count = 0;
+    int result = 0;
+
+    pattern->kind = PATTERN_FNMATCH;
+    pattern->source = source;
+    pattern->flags = flags;
+    pattern->text = NULL;
+    pattern->length = 0;
+    pattern->dfa = NULL;
+
+    /* in multibyte locales fnmatch() matches characters, not bytes */
+    if (MB_CUR_MAX > 1)
+    {
+        return 0;
+    }
+
+    /* every byte of the pattern yields at most one item, plus the end */
+    items = (GlobItem*) malloc((strlen(source) + 1) * sizeof(GlobItem));
+    if (NULL == items)
+    {
+        return ENOMEM;
+    }
+
+    if (0 == parse_glob(source, flags, items, &count))
+    {
+        result = classify(pattern, items, count);
+        if (PATTERN_UNSUPPORTED == result)
+        {
+            result = dfa_build(&pattern->dfa, items, count);
+            if (0 == result)
+            {
+                pattern->kind = PATTERN_DFA;
+            }
+        }
+    }
+    free(items);
+
+    /* patterns too big for the automaton are still matched, by fnmatch() */
+    return (ENOMEM == result) ? ENOMEM : 0;
+}
+
+int pattern_match(const Pattern* pattern, const char* subject)
+{
+    size_t length = 0;
+
+    switch (pattern->kind)
+    {
+    case PATTERN_LITERAL:
+        return (0 == strcmp(subject, pattern->text));
+    case PATTERN_ANY:
+        return 1;
+    case PATTERN_PREFIX:
+        return (0 == strncmp(subject, pattern->text, pattern->length));
+    case PATTERN_SUFFIX:
+        length = strlen(subject);
+        return (length >= pattern->length)
+                && (0 == memcmp(subject + length - pattern->length, pattern->text,
+                        pattern->length));
+    case PATTERN_INFIX:
+        return (NULL != strstr(subject, pattern->text));
+    case PATTERN_DFA:
+        return dfa_match(pattern->dfa, (const unsigned char*) subject);
+    default:
+        return (0 == fnmatch(pattern->source, subject, pattern->flags));
+    }
+}
+
+void pattern_free(Pattern* pattern)
+{
+    free(pattern->text);
+    pattern->text = NULL;
+    dfa_free(pattern->dfa);
+    pattern->dfa = NULL;
+}
+
+void pattern_set_init(PatternSet* set, const int flags)
+{
+    memset(set, 0, sizeof(PatternSet));
+    set->flags = flags;
+}
+
+int pattern_set_add(PatternSet* set, const char* source)
+{
+    char* copy = NULL;
+
+    if (set->count == set->capacity)
+    {
+        const size_t capacity =
+                (0 == set->capacity) ? PATTERN_SET_INITIAL_CAPACITY : 2 * set->capacity;
+        char** sources = (char**) realloc(set->sources, capacity * sizeof(char*));
+
+        if (NULL == sources)
+        {
+            return ENOMEM;
+        }
+        set->sources = sources;
+        set->capacity = capacity;
+    }
+
+    copy = strdup(source);
+    if (NULL == copy)
+    {
+        return ENOMEM;
+    }
+    set->sources[set->count++] = copy;
+
+    return 0;
+}
+
+int pattern_set_compile(PatternSet* set)
+{
+    GlobItem* items = NULL;
+    GlobItem* combined = NULL;
+    size_t combined_count = 0;
+    size_t* combined_sources = NULL;
+    size_t combined_sources_count = 0;
+    size_t count = 0;
+    size_t i = 0;
+    int result = ENOMEM;
+
+    set->literal_slots = 1;
+    while (set->literal_slots < 2 * set->count + 1)
+    {
+        set->literal_slots *= 2;
+    }
+    set->literals = (char**) calloc(set->literal_slots, sizeof(char*));
+    set->suffixes = (SuffixNode*) calloc(1, sizeof(SuffixNode));
+    set->others = (Pattern*) malloc((set->count + 1) * sizeof(Pattern));
+    combined_sources = (size_t*) malloc((set->count + 1) * sizeof(size_t));
+    if ((NULL == set->literals) || (NULL == set->suffixes) || (NULL == set->others)
+            || (NULL == combined_sources))
+    {
+        goto done;
+    }
+    set->suffix_count = 1;
+
+    for (i = 0; i < set->count; ++i)
+    {
+        const char* source = set->sources[i];
+        Pattern single;
+
+        free(items);
+        items = (GlobItem*) malloc((strlen(source) + 1) * sizeof(GlobItem));
+        if (NULL == items)
+        {
+            goto done;
+        }
+
+        if ((MB_CUR_MAX > 1) || (0 != parse_glob(source, set->flags, items, &count)))
+        {
+            /* left to fnmatch() */
+            result = pattern_compile(&set->others[set->other_count], source, set->flags);
+            if (0 != result)
+            {
+                goto done;
+            }
+            ++set->other_count;
+            continue;
+        }
+
+        single.flags = set->flags;
+        single.text = NULL;
+        result = classify(&single, items, count);
+        if (ENOMEM == result)
+        {
+            goto done;
+        }
+        if (0 == result)
+        {
+            switch (single.kind)
+            {
+            case PATTERN_LITERAL:
+                insert_literal(set, single.text);
+                continue;
+            case PATTERN_ANY:
+                set->match_all = 1;
+                free(single.text);
+                continue;
+            case PATTERN_SUFFIX:
+                result = insert_suffix(set, single.text, single.length);
+                free(single.text);
+                if (0 != result)
+                {
+                    goto done;
+                }
+                continue;
+            default:
+                free(single.text);
+                break;
+            }
+        }
+
+        /* everything else goes into the combined automaton */
+        result = append_items(&combined, &combined_count, items, count);
+        if (0 != result)
+        {
+            goto done;
+        }
+        combined_sources[combined_sources_count++] = i;
+    }
+
+    result = 0;
+    if (combined_count > 0)
+    {
+        result = dfa_build(&set->dfa, combined, combined_count);
+        if (PATTERN_UNSUPPORTED == result)
+        {
+            /* too many states for one automaton, match these patterns one by one */
+            for (i = 0; i < combined_sources_count; ++i)
+            {
+                result = pattern_compile(&set->others[set->other_count],
+                        set->sources[combined_sources[i]], set->flags);
+                if (0 != result)
+                {
+                    goto done;
+                }
+                ++set->other_count;
+            }
+        }
+    }
+
+done:
+    free(items);
+    free(combined);
+    free(combined_sources);
+    return result;
+}
+
+int pattern_set_match(const PatternSet* set, const char* subject)
+{
+    size_t length = 0;
+    size_t slot = 0;
+    size_t i = 0;
+
+    if (set->match_all)
+    {
+        return 1;
+    }
+
+    for (slot = hash_string(subject) & (set->literal_slots - 1); NULL != set->literals[slot];
+            slot = (slot + 1) & (set->literal_slots - 1))
+    {
+        if (0 == strcmp(set->literals[slot], subject))
+        {
+            return 1;
+        }
+    }
+
+    length = strlen(subject);
+    if (match_suffix(set->suffixes, subject, length))
+    {
+        return 1;
+    }
+
+    if ((NULL != set->dfa) && dfa_match(set->dfa, (const unsigned char*) subject))
+    {
+        return 1;
+    }
+
+    for (i = 0; i < set->other_count; ++i)
+    {
+        if (pattern_match(&set->others[i], subject))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void pattern_set_free(PatternSet* set)
+{
+    size_t i = 0;
+
+    for (i = 0; i < set->count; ++i)
+    {
+        free(set->sources[i]);
+    }
+    free(set->sources);
+    for (i = 0; (NULL != set->literals) && (i < set->literal_slots); ++i)
+    {
+        free(set->literals[i]);
+    }
+    free(set->literals);
+    free(set->suffixes);
+    dfa_free(set->dfa);
+    for (i = 0; i < set->other_count; ++i)
+    {
+        pattern_free(&set->others[i]);
+    }
+    free(set->others);
+    memset(set, 0, sizeof(PatternSet));
+}
+
+/**
+ *
+ * \brief Parses a glob pattern into items.
+ *
+ * Follows fnmatch() without FNM_NOESCAPE and FNM_PERIOD: a backslash quotes the next byte and
+ * with FNM_PATHNAME a '/' is only matched by a '/' in the pattern.
+ *
+ * \param source the glob pattern.
+ * \param flags fnmatch() flags.
+ * \param items receives the items, room for strlen(source) + 1 items.
+ * \param count receives the number of items including the ITEM_END.
+ *
+ * \return 0 on success, PATTERN_UNSUPPORTED if the pattern has to be left to fnmatch().
+ */
+static int parse_glob(const char* source, const int flags, GlobItem* items, size_t* count)
+{
+    const unsigned char* current = (const unsigned char*) source;
+    size_t n = 0;
+    unsigned int byte = 0;
+
+    while ('\0' != *current)
+    {
+        GlobItem* item = &items[n];
+
+        memset(item->set, 0, sizeof(item->set));
+        switch (*current)
+        {
+        case '*':
+            ++current;
+            if ((n > 0) && (ITEM_STAR == items[n - 1].kind))
+            {
+                /* "**" is the same as "*" */
+                continue;
+            }
+            item->kind = ITEM_STAR;
+            break;
+        case '?':
+            ++current;
+            item->kind = ITEM_CHAR;
+            break;
+        case '[':
+            current = parse_bracket(current, flags, item->set);
+            if (NULL == current)
+            {
+                return PATTERN_UNSUPPORTED;
+            }
+            item->kind = ITEM_CHAR;
+            ++n;
+            continue;
+        case '\\':
+            /* glibc never lets a '*' reach an escaped '/' of a path, keep its behaviour */
+            if (('\0' == current[1]) || (('/' == current[1]) && (0 != (flags & FNM_PATHNAME))))
+            {
+                return PATTERN_UNSUPPORTED;
+            }
+            ++current;
+            /* fall through */
+        default:
+            item->kind = ITEM_CHAR;
+            set_insert(item->set, *current);
+            ++current;
+            ++n;
+            continue;
+        }
+
+        /* '*' and '?' match any byte but the '/' of a path */
+        for (byte = 1; byte < 256; ++byte)
+        {
+            set_insert(item->set, byte);
+        }
+        if (0 != (flags & FNM_PATHNAME))
+        {
+            set_remove(item->set, '/');
+        }
+        ++n;
+    }
+
+    items[n].kind = ITEM_END;
+    memset(items[n].set, 0, sizeof(items[n].set));
+    *count = n + 1;
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Parses a bracket expression.
+ *
+ * \param bracket points to the '['.
+ * \param flags fnmatch() flags.
+ * \param set receives the bytes matched, must be empty.
+ *
+ * \return the byte after the closing ']', NULL if the expression has to be left to fnmatch().
+ */
+static const unsigned char* parse_bracket(const unsigned char* bracket, const int flags,
+        uint64_t* set)
+{
+    const unsigned char* current = bracket + 1;
+    int negate = 0;
+    int first = 1;
+    unsigned int low = 0;
+    unsigned int high = 0;
+    unsigned int byte = 0;
+
+    if (('!' == *current) || ('^' == *current))
+    {
+        negate = 1;
+        ++current;
+    }
+
+    for (;;)
+    {
+        if ('\0' == *current)
+        {
+            /* unterminated, fnmatch() takes the '[' literally */
+            return NULL;
+        }
+        if ((']' == *current) && !first)
+        {
+            ++current;
+            break;
+        }
+        first = 0;
+
+        if (('[' == *current) && (':' == current[1]))
+        {
+            const char* name = (const char*) current + 2;
+            const char* end = strstr(name, ":]");
+
+            if ((NULL == end) || (0 != add_char_class(name, (size_t) (end - name), set)))
+            {
+                return NULL;
+            }
+            current = (const unsigned char*) end + 2;
+            continue;
+        }
+        if (('[' == *current) && (('=' == current[1]) || ('.' == current[1])))
+        {
+            /* equivalence classes and collating symbols */
+            return NULL;
+        }
+
+        if ('\\' == *current)
+        {
+            ++current;
+            if ('\0' == *current)
+            {
+                return NULL;
+            }
+        }
+        low = *current++;
+        high = low;
+
+        if (('-' == current[0]) && (']' != current[1]) && ('\0' != current[1]))
+        {
+            ++current;
+            if ('[' == *current)
+            {
+                return NULL;
+            }
+            if ('\\' == *current)
+            {
+                ++current;
+                if ('\0' == *current)
+                {
+                    return NULL;
+                }
+            }
+            high = *current++;
+            if (low > high)
+            {
+                return NULL;
+            }
+        }
+
+        for (byte = low; byte <= high; ++byte)
+        {
+            set_insert(set, byte);
+        }
+    }
+
+    if (negate)
+    {
+        for (byte = 1; byte < 256; ++byte)
+        {
+            if (set_contains(set, byte))
+            {
+                set_remove(set, byte);
+            }
+            else
+            {
+                set_insert(set, byte);
+            }
+        }
+        set_remove(set, '\0');
+    }
+    if (0 != (flags & FNM_PATHNAME))
+    {
+        /* a bracket expression never matches the '/' of a path */
+        set_remove(set, '/');
+    }
+
+    return current;
+}
+
+/**
+ *
+ * \brief Adds the bytes of a character class like [:alpha:] to a set.
+ *
+ * \param name name of the class, not terminated.
+ * \param length length of name.
+ * \param set receives the bytes of the class.
+ *
+ * \return 0 on success, PATTERN_UNSUPPORTED for unknown classes.
+ */
+static int add_char_class(const char* name, const size_t length, uint64_t* set)
+{
+    static const char* const class_names[] =
+    { "alnum", "alpha", "blank", "cntrl", "digit", "graph", "lower", "print", "punct", "space",
+            "upper", "xdigit" };
+    int (* const class_tests[])(int) =
+    { isalnum, isalpha, isblank, iscntrl, isdigit, isgraph, islower, isprint, ispunct, isspace,
+            isupper, isxdigit };
+    size_t i = 0;
+    unsigned int byte = 0;
+
+    for (i = 0; i < sizeof(class_names) / sizeof(class_names[0]); ++i)
+    {
+        if ((strlen(class_names[i]) == length) && (0 == strncmp(class_names[i], name, length)))
+        {
+            for (byte = 1; byte < 256; ++byte)
+            {
+                if (class_tests[i]((int) byte))
+                {
+                    set_insert(set, byte);
+                }
+            }
+            return 0;
+        }
+    }
+
+    return PATTERN_UNSUPPORTED;
+}
+
+/**
+ *
+ * \brief Checks whether the pattern is one of the kinds matched without automaton.
+ *
+ * \param pattern receives kind and text.
+ * \param items of the pattern.
+ * \param count number of items.
+ *
+ * \return 0 if the pattern was classified, PATTERN_UNSUPPORTED if it needs the automaton,
+ *         ENOMEM if out of memory.
+ */
+static int classify(Pattern* pattern, const GlobItem* items, const size_t count)
+{
+    size_t stars = 0;
+    size_t i = 0;
+    size_t length = 0;
+    int leading_star = (ITEM_STAR == items[0].kind);
+    int trailing_star = (count > 1) && (ITEM_STAR == items[count - 2].kind);
+
+    for (i = 0; i + 1 < count; ++i)
+    {
+        if (ITEM_STAR == items[i].kind)
+        {
+            ++stars;
+        }
+        else if (get_single_byte(items[i].set) < 0)
+        {
+            return PATTERN_UNSUPPORTED;
+        }
+    }
+
+    if (stars > 0)
+    {
+        /* with FNM_PATHNAME the '*' must not match a '/', leave that to the automaton */
+        if ((0 != (pattern->flags & FNM_PATHNAME)) || (stars > 2)
+                || ((2 == stars) && !(leading_star && trailing_star))
+                || ((1 == stars) && !(leading_star || trailing_star)))
+        {
+            return PATTERN_UNSUPPORTED;
+        }
+    }
+
+    pattern->text = (char*) malloc(count);
+    if (NULL == pattern->text)
+    {
+        return ENOMEM;
+    }
+    for (i = 0; i + 1 < count; ++i)
+    {
+        if (ITEM_CHAR == items[i].kind)
+        {
+            pattern->text[length++] = (char) get_single_byte(items[i].set);
+        }
+    }
+    pattern->text[length] = '\0';
+    pattern->length = length;
+
+    if (0 == stars)
+    {
+        pattern->kind = PATTERN_LITERAL;
+    }
+    else if (0 == length)
+    {
+        pattern->kind = PATTERN_ANY;
+    }
+    else if (2 == stars)
+    {
+        pattern->kind = PATTERN_INFIX;
+    }
+    else
+    {
+        pattern->kind = leading_star ? PATTERN_SUFFIX : PATTERN_PREFIX;
+    }
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Returns the only byte of a set.
+ *
+ * \param set to be checked.
+ *
+ * \return the byte, -1 if the set does not consist of exactly one byte.
+ */
+static int get_single_byte(const uint64_t* set)
+{
+    int byte = -1;
+    size_t i = 0;
+
+    for (i = 0; i < BYTESET_WORDS; ++i)
+    {
+        if (0 != set[i])
+        {
+            if ((byte >= 0) || (0 != (set[i] & (set[i] - 1))))
+            {
+                return -1;
+            }
+            byte = (int) (i * 64) + __builtin_ctzll(set[i]);
+        }
+    }
+
+    return byte;
+}
+
+/**
+ *
+ * \brief Builds the automaton of a parsed pattern by subset construction.
+ *
+ * The items may hold several patterns, each terminated by its ITEM_END; the automaton then
+ * accepts if any of them matches.
+ *
+ * \param result receives the automaton.
+ * \param items of the patterns.
+ * \param count number of items.
+ *
+ * \return 0 on success, PATTERN_UNSUPPORTED if the automaton gets too big, ENOMEM.
+ */
+static int dfa_build(Dfa** result, const GlobItem* items, const size_t count)
+{
+    DfaBuilder builder;
+    Dfa* dfa = NULL;
+    unsigned char representatives[256];
+    uint64_t* positions = NULL;
+    uint32_t state = 0;
+    size_t current = 0;
+    size_t klass = 0;
+    size_t i = 0;
+    int status = ENOMEM;
+
+    memset(&builder, 0, sizeof(builder));
+    builder.items = items;
+    builder.count = count;
+    builder.words = (count + 63) / 64;
+
+    dfa = (Dfa*) calloc(1, sizeof(Dfa));
+    builder.slots = (uint32_t*) calloc(PATTERN_STATE_SLOTS, sizeof(uint32_t));
+    positions = (uint64_t*) malloc(builder.words * sizeof(uint64_t));
+    if ((NULL == dfa) || (NULL == builder.slots) || (NULL == positions))
+    {
+        goto done;
+    }
+    builder.dfa = dfa;
+    init_classes(dfa, items, count, representatives);
+
+    /* state 0 is the dead state, the empty set of positions */
+    memset(positions, 0, builder.words * sizeof(uint64_t));
+    status = intern_state(&builder, positions, &state);
+    if (0 != status)
+    {
+        goto done;
+    }
+
+    /* the start state has the first position of every pattern */
+    for (i = 0; i < count; ++i)
+    {
+        if ((0 == i) || (ITEM_END == items[i - 1].kind))
+        {
+            positions[i >> 6] |= (uint64_t) 1 << (i & 63);
+        }
+    }
+    close_positions(&builder, positions);
+    status = intern_state(&builder, positions, &state);
+    if (0 != status)
+    {
+        goto done;
+    }
+    dfa->start = state;
+
+    /* new states are appended, so this runs until no more states turn up */
+    for (current = 0; current < dfa->state_count; ++current)
+    {
+        for (klass = 0; klass < dfa->class_count; ++klass)
+        {
+            /* fetched again each time, intern_state() may move the sets */
+            const uint64_t* from = &builder.sets[current * builder.words];
+            const unsigned int byte = representatives[klass];
+
+            memset(positions, 0, builder.words * sizeof(uint64_t));
+            for (i = 0; i < builder.words; ++i)
+            {
+                uint64_t bits = from[i];
+
+                while (0 != bits)
+                {
+                    const size_t position = i * 64 + (size_t) __builtin_ctzll(bits);
+                    const GlobItem* item = &items[position];
+                    size_t next = position + 1;
+
+                    bits &= bits - 1;
+                    if ((ITEM_END == item->kind) || !set_contains(item->set, byte))
+                    {
+                        continue;
+                    }
+                    if (ITEM_STAR == item->kind)
+                    {
+                        next = position;
+                    }
+                    positions[next >> 6] |= (uint64_t) 1 << (next & 63);
+                }
+            }
+            close_positions(&builder, positions);
+
+            status = intern_state(&builder, positions, &state);
+            if (0 != status)
+            {
+                goto done;
+            }
+            dfa->transitions[current * dfa->class_count + klass] = state
+                    * (uint32_t) dfa->class_count;
+        }
+    }
+
+    dfa->start *= (uint32_t) dfa->class_count;
+    *result = dfa;
+    dfa = NULL;
+    status = 0;
+
+done:
+    dfa_free(dfa);
+    free(builder.sets);
+    free(builder.slots);
+    free(positions);
+    return status;
+}
+
+/**
+ *
+ * \brief Divides the bytes into classes of bytes no item tells apart.
+ *
+ * \param dfa receives classes and class_count.
+ * \param items of the patterns.
+ * \param count number of items.
+ * \param representatives receives one byte of each class.
+ *
+ * \return void
+ */
+static void init_classes(Dfa* dfa, const GlobItem* items, const size_t count,
+        unsigned char* representatives)
+{
+    int refined[2][256];
+    size_t i = 0;
+    unsigned int byte = 0;
+
+    memset(dfa->classes, 0, sizeof(dfa->classes));
+    for (i = 0; i < count; ++i)
+    {
+        int split = 0;
+
+        if (ITEM_END == items[i].kind)
+        {
+            continue;
+        }
+        /* split every class into the bytes in and the bytes not in the set of the item */
+        memset(refined, -1, sizeof(refined));
+        for (byte = 0; byte < 256; ++byte)
+        {
+            const int member = set_contains(items[i].set, byte);
+            const unsigned char klass = dfa->classes[byte];
+
+            if (refined[member][klass] < 0)
+            {
+                refined[member][klass] = split++;
+            }
+            dfa->classes[byte] = (unsigned char) refined[member][klass];
+        }
+    }
+
+    dfa->class_count = 0;
+    for (byte = 0; byte < 256; ++byte)
+    {
+        if (dfa->classes[byte] == dfa->class_count)
+        {
+            representatives[dfa->class_count++] = (unsigned char) byte;
+        }
+    }
+}
+
+/**
+ *
+ * \brief Adds the positions reachable without consuming a byte: a '*' may match nothing.
+ *
+ * \param builder working data.
+ * \param positions set of positions to be closed.
+ *
+ * \return void
+ */
+static void close_positions(const DfaBuilder* builder, uint64_t* positions)
+{
+    size_t i = 0;
+
+    /* an item is never the last one, the ITEM_END follows; chains of '*' are merged already */
+    for (i = 0; i + 1 < builder->count; ++i)
+    {
+        if ((ITEM_STAR == builder->items[i].kind) && (0 != ((positions[i >> 6] >> (i & 63)) & 1)))
+        {
+            positions[(i + 1) >> 6] |= (uint64_t) 1 << ((i + 1) & 63);
+        }
+    }
+}
+
+/**
+ *
+ * \brief Looks up the state of a set of positions, the state is added if it is new.
+ *
+ * \param builder working data.
+ * \param positions the set of positions.
+ * \param state receives the number of the state.
+ *
+ * \return 0 on success, PATTERN_UNSUPPORTED if there are too many states, ENOMEM.
+ */
+static int intern_state(DfaBuilder* builder, const uint64_t* positions, uint32_t* state)
+{
+    Dfa* dfa = builder->dfa;
+    const size_t set_size = builder->words * sizeof(uint64_t);
+    uint64_t hash = 14695981039346656037ULL;
+    size_t slot = 0;
+    size_t i = 0;
+    int accepting = 0;
+
+    for (i = 0; i < builder->words; ++i)
+    {
+        hash = (hash ^ positions[i]) * 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+
+    for (slot = hash & (PATTERN_STATE_SLOTS - 1); 0 != builder->slots[slot];
+            slot = (slot + 1) & (PATTERN_STATE_SLOTS - 1))
+    {
+        const uint32_t known = builder->slots[slot] - 1;
+
+        if (0 == memcmp(&builder->sets[known * builder->words], positions, set_size))
+        {
+            *state = known;
+            return 0;
+        }
+    }
+
+    if (dfa->state_count >= PATTERN_MAX_STATES)
+    {
+        return PATTERN_UNSUPPORTED;
+    }
+    if (dfa->state_count == builder->capacity)
+    {
+        const size_t capacity = (0 == builder->capacity) ? 16 : 2 * builder->capacity;
+        uint64_t* sets = (uint64_t*) realloc(builder->sets, capacity * set_size);
+        uint32_t* transitions = NULL;
+        unsigned char* accepting_states = NULL;
+
+        if (NULL == sets)
+        {
+            return ENOMEM;
+        }
+        builder->sets = sets;
+        transitions = (uint32_t*) realloc(dfa->transitions,
+                capacity * dfa->class_count * sizeof(uint32_t));
+        if (NULL == transitions)
+        {
+            return ENOMEM;
+        }
+        dfa->transitions = transitions;
+        accepting_states = (unsigned char*) realloc(dfa->accepting, capacity);
+        if (NULL == accepting_states)
+        {
+            return ENOMEM;
+        }
+        dfa->accepting = accepting_states;
+        builder->capacity = capacity;
+    }
+
+    memcpy(&builder->sets[dfa->state_count * builder->words], positions, set_size);
+    for (i = 0; i < builder->count; ++i)
+    {
+        if ((ITEM_END == builder->items[i].kind) && (0 != ((positions[i >> 6] >> (i & 63)) & 1)))
+        {
+            accepting = 1;
+            break;
+        }
+    }
+    dfa->accepting[dfa->state_count] = (unsigned char) accepting;
+    /* the dead state stays in itself */
+    memset(&dfa->transitions[dfa->state_count * dfa->class_count], 0,
+            dfa->class_count * sizeof(uint32_t));
+
+    *state = (uint32_t) dfa->state_count;
+    builder->slots[slot] = (uint32_t) ++dfa->state_count;
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Runs the automaton over a string.
+ *
+ * \param dfa the automaton.
+ * \param subject string to be matched.
+ *
+ * \return non zero if the automaton accepts the string.
+ */
+static int dfa_match(const Dfa* dfa, const unsigned char* subject)
+{
+    const uint32_t* transitions = dfa->transitions;
+    const unsigned char* classes = dfa->classes;
+    uint32_t row = dfa->start;
+
+    for (; '\0' != *subject; ++subject)
+    {
+        row = transitions[row + classes[*subject]];
+        if (0 == row)
+        {
+            /* no pattern can match any more */
+            return 0;
+        }
+    }
+
+    return dfa->accepting[row / dfa->class_count];
+}
+
+/**
+ *
+ * \brief Frees an automaton.
+ *
+ * \param dfa to be freed, may be NULL.
+ *
+ * \return void
+ */
+static void dfa_free(Dfa* dfa)
+{
+    if (NULL != dfa)
+    {
+        free(dfa->transitions);
+        free(dfa->accepting);
+        free(dfa);
+    }
+}
+
+/**
+ *
+ * \brief Hashes a string for the set of literals (FNV-1a).
+ *
+ * \param text to be hashed.
+ *
+ * \return the hash value.
+ */
+static uint64_t hash_string(const char* text)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (; '\0' != *text; ++text)
+    {
+        hash = (hash ^ (unsigned char) *text) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ *
+ * \brief Inserts a literal pattern into the hash set of a pattern set.
+ *
+ * \param set the pattern set, its hash set has room for all patterns.
+ * \param literal the text of the pattern, owned by the set from now on.
+ *
+ * \return void
+ */
+static void insert_literal(PatternSet* set, char* literal)
+{
+    size_t slot = 0;
+
+    for (slot = hash_string(literal) & (set->literal_slots - 1); NULL != set->literals[slot];
+            slot = (slot + 1) & (set->literal_slots - 1))
+    {
+        if (0 == strcmp(set->literals[slot], literal))
+        {
+            /* given twice */
+            free(literal);
+            return;
+        }
+    }
+    set->literals[slot] = literal;
+}
+
+/**
+ *
+ * \brief Inserts the text of a "*text" pattern into the trie of reversed suffixes.
+ *
+ * \param set the pattern set.
+ * \param text the text after the '*'.
+ * \param length length of text, at least 1.
+ *
+ * \return 0 on success, ENOMEM if out of memory.
+ */
+static int insert_suffix(PatternSet* set, const char* text, const size_t length)
+{
+    uint32_t node = 0;
+    size_t i = length;
+
+    while (i > 0)
+    {
+        const unsigned char byte = (unsigned char) text[--i];
+        uint32_t child = set->suffixes[node].child;
+
+        while ((0 != child) && (set->suffixes[child].byte != byte))
+        {
+            child = set->suffixes[child].sibling;
+        }
+        if (0 == child)
+        {
+            SuffixNode* nodes = (SuffixNode*) realloc(set->suffixes,
+                    (set->suffix_count + 1) * sizeof(SuffixNode));
+
+            if (NULL == nodes)
+            {
+                return ENOMEM;
+            }
+            set->suffixes = nodes;
+            child = (uint32_t) set->suffix_count++;
+            nodes[child].child = 0;
+            nodes[child].sibling = nodes[node].child;
+            nodes[child].byte = byte;
+            nodes[child].terminal = 0;
+            nodes[node].child = child;
+        }
+        node = child;
+    }
+    set->suffixes[node].terminal = 1;
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Walks a string backwards through the trie of reversed suffixes.
+ *
+ * \param nodes the trie.
+ * \param subject string to be matched.
+ * \param length length of subject.
+ *
+ * \return non zero if the string ends with one of the suffixes.
+ */
+static int match_suffix(const SuffixNode* nodes, const char* subject, size_t length)
+{
+    uint32_t node = 0;
+
+    while (length > 0)
+    {
+        const unsigned char byte = (unsigned char) subject[--length];
+        uint32_t child = nodes[node].child;
+
+        while ((0 != child) && (nodes[child].byte != byte))
+        {
+            child = nodes[child].sibling;
+        }
+        if (0 == child)
+        {
+            return 0;
+        }
+        if (nodes[child].terminal)
+        {
+            return 1;
+        }
+        node = child;
+    }
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Appends the items of a pattern to the items of the combined automaton.
+ *
+ * \param combined items of the combined automaton, reallocated.
+ * \param combined_count number of items in combined.
+ * \param items of the pattern, ITEM_END terminated.
+ * \param count number of items.
+ *
+ * \return 0 on success, ENOMEM if out of memory.
+ */
+static int append_items(GlobItem** combined, size_t* combined_count, const GlobItem* items,
+        const size_t count)
+{
+    GlobItem* grown = (GlobItem*) realloc(*combined, (*combined_count + count) * sizeof(GlobItem));
+
+    if (NULL == grown)
+    {
+        return ENOMEM;
+    }
+    memcpy(grown + *combined_count, items, count * sizeof(GlobItem));
+    *combined = grown;
+    *combined_count += count;
+
+    return 0;
+}
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,197 @@
+/**
+ * @file pattern.h
+ * \brief Compiled glob patterns for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _PATTERN_H_
+#define _PATTERN_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stddef.h>
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * How a compiled pattern is matched.
+ */
+typedef enum patternKindEnum
+{
+    /** No wildcards, compared with memcmp(). */
+    PATTERN_LITERAL,
+    /** "*", matches everything. */
+    PATTERN_ANY,
+    /** "text*", compared with memcmp() at the start. */
+    PATTERN_PREFIX,
+    /** "*text", compared with memcmp() at the end. */
+    PATTERN_SUFFIX,
+    /** "*text*", searched with memmem(). */
+    PATTERN_INFIX,
+    /** Any other pattern the compiler understands, run as DFA. */
+    PATTERN_DFA,
+    /** Constructs the compiler does not handle (collating symbols, ...), left to fnmatch(). */
+    PATTERN_FNMATCH
+} PatternKind;
+
+/** Deterministic automaton, see pattern.c. */
+typedef struct dfaStruct Dfa;
+
+/**
+ * A glob pattern compiled for fast matching, same semantics as fnmatch().
+ */
+typedef struct patternStruct
+{
+    /** How the pattern is matched. */
+    PatternKind kind;
+    /** The pattern as given by the user. */
+    const char* source;
+    /** fnmatch() flags, 0 or FNM_PATHNAME. */
+    int flags;
+    /** Text without wildcards of the memcmp()/memmem() kinds. */
+    char* text;
+    /** Length of text. */
+    size_t length;
+    /** Automaton of PATTERN_DFA. */
+    Dfa* dfa;
+} Pattern;
+
+/** Node of the reversed suffix trie, see pattern.c. */
+typedef struct suffixNodeStruct SuffixNode;
+
+/**
+ * Any number of glob patterns compiled into one matcher, it matches if one of them matches.
+ *
+ * Each subject is looked up once in a hash set of the literal patterns, walked backwards once
+ * through a trie of the "*text" patterns and run once through a single automaton of all other
+ * patterns, no matter how many patterns there are.
+ */
+typedef struct patternSetStruct
+{
+    /** fnmatch() flags of all patterns. */
+    int flags;
+    /** The patterns, copied by pattern_set_add(). */
+    char** sources;
+    /** Number of patterns. */
+    size_t count;
+    /** Size of sources. */
+    size_t capacity;
+    /** One of the patterns is "*". */
+    int match_all;
+    /** Hash set of the literal patterns, NULL for free slots. */
+    char** literals;
+    /** Number of slots of literals, a power of two. */
+    size_t literal_slots;
+    /** Trie of the reversed texts of the "*text" patterns, node 0 is the root. */
+    SuffixNode* suffixes;
+    /** Number of trie nodes. */
+    size_t suffix_count;
+    /** Automaton of all other patterns, NULL if there are none. */
+    Dfa* dfa;
+    /** Patterns matched one by one (fnmatch() or automaton too big). */
+    Pattern* others;
+    /** Number of patterns in others. */
+    size_t other_count;
+} PatternSet;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Compiles a glob pattern.
+ *
+ * \param pattern receives the compiled pattern.
+ * \param source the glob pattern, must stay valid as long as the compiled pattern is used.
+ * \param flags fnmatch() flags, 0 (-name) or FNM_PATHNAME (-path).
+ *
+ * \return 0 on success, ENOMEM if out of memory.
+ */
+extern int pattern_compile(Pattern* pattern, const char* source, const int flags);
+
+/**
+ *
+ * \brief Matches a string against a compiled pattern.
+ *
+ * \param pattern compiled by pattern_compile().
+ * \param subject string to be matched.
+ *
+ * \return non zero if the pattern matches, like fnmatch() returning 0.
+ */
+extern int pattern_match(const Pattern* pattern, const char* subject);
+
+/**
+ *
+ * \brief Frees a compiled pattern.
+ *
+ * \param pattern to be freed.
+ *
+ * \return void
+ */
+extern void pattern_free(Pattern* pattern);
+
+/**
+ *
+ * \brief Initializes an empty set of patterns.
+ *
+ * \param set to be initialized.
+ * \param flags fnmatch() flags of all patterns, 0 or FNM_PATHNAME.
+ *
+ * \return void
+ */
+extern void pattern_set_init(PatternSet* set, const int flags);
+
+/**
+ *
+ * \brief Adds a pattern to a set, pattern_set_compile() has to be called afterwards.
+ *
+ * \param set the set of patterns.
+ * \param source the glob pattern, it is copied.
+ *
+ * \return 0 on success, ENOMEM if out of memory.
+ */
+extern int pattern_set_add(PatternSet* set, const char* source);
+
+/**
+ *
+ * \brief Compiles all patterns added to a set into the combined matcher.
+ *
+ * \param set the set of patterns.
+ *
+ * \return 0 on success, ENOMEM if out of memory.
+ */
+extern int pattern_set_compile(PatternSet* set);
+
+/**
+ *
+ * \brief Matches a string against a compiled set of patterns.
+ *
+ * \param set compiled by pattern_set_compile().
+ * \param subject string to be matched.
+ *
+ * \return non zero if at least one pattern of the set matches.
+ */
+extern int pattern_set_match(const PatternSet* set, const char* subject);
+
+/**
+ *
+ * \brief Frees a set of patterns.
+ *
+ * \param set to be freed.
+ *
+ * \return void
+ */
+extern void pattern_set_free(PatternSet* set);
+
+#endif /* _PATTERN_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
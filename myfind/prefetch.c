@@ -0,0 +1,208 @@
+/**
+ * @file prefetch.c
+ * \brief Metadata prefetch for myfind.
+ *
+ * A pool of helper threads carries out fstatat() and openat() of directory entries ahead of
+ * the traversal. On file systems where every lookup waits for a server (FUSE, NFS) the
+ * lookups of a directory then overlap instead of being paid one after the other. The callers
+ * still consume the results in their own order.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "prefetch.h"
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+/** Protects the queue and the done flags of the requests. */
+static pthread_mutex_t slock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Signaled when a request is queued or the helpers have to stop. */
+static pthread_cond_t squeued = PTHREAD_COND_INITIALIZER;
+
+/** Signaled when a request is finished. */
+static pthread_cond_t sfinished = PTHREAD_COND_INITIALIZER;
+
+/** Oldest queued request. */
+static PrefetchRequest* shead = NULL;
+
+/** Newest queued request. */
+static PrefetchRequest* stail = NULL;
+
+/** The helpers have to stop. */
+static int sstopping = 0;
+
+/** Helper threads. */
+static pthread_t* shelpers = NULL;
+
+/** Number of running helper threads. */
+static int shelper_count = 0;
+
+static void* helper_main(void* arg);
+static void run_request(PrefetchRequest* request);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+int prefetch_start(const int threads)
+{
+    int error = 0;
+
+    shelpers = (pthread_t*) malloc(threads * sizeof(pthread_t));
+    if (NULL == shelpers)
+    {
+        return ENOMEM;
+    }
+    sstopping = 0;
+    for (shelper_count = 0; shelper_count < threads; ++shelper_count)
+    {
+        error = pthread_create(&shelpers[shelper_count], NULL, helper_main, NULL);
+        if (0 != error)
+        {
+            prefetch_stop();
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+void prefetch_submit(PrefetchRequest* request)
+{
+    request->next = NULL;
+    request->done = 0;
+
+    pthread_mutex_lock(&slock);
+    if (NULL == stail)
+    {
+        shead = request;
+    }
+    else
+    {
+        stail->next = request;
+    }
+    stail = request;
+    pthread_cond_signal(&squeued);
+    pthread_mutex_unlock(&slock);
+}
+
+void prefetch_wait(PrefetchRequest* request)
+{
+    pthread_mutex_lock(&slock);
+    while (!request->done)
+    {
+        pthread_cond_wait(&sfinished, &slock);
+    }
+    pthread_mutex_unlock(&slock);
+}
+
+void prefetch_stop(void)
+{
+    int i = 0;
+
+    pthread_mutex_lock(&slock);
+    sstopping = 1;
+    pthread_cond_broadcast(&squeued);
+    pthread_mutex_unlock(&slock);
+
+    for (i = 0; i < shelper_count; ++i)
+    {
+        pthread_join(shelpers[i], NULL);
+    }
+    free(shelpers);
+    shelpers = NULL;
+    shelper_count = 0;
+}
+
+/**
+ *
+ * \brief Main function of a helper: carries out queued requests until it has to stop.
+ *
+ * \param arg unused.
+ *
+ * \return NULL
+ */
+static void* helper_main(void* arg)
+{
+    (void) arg;
+
+    pthread_mutex_lock(&slock);
+    for (;;)
+    {
+        PrefetchRequest* request = shead;
+
+        if (NULL == request)
+        {
+            if (sstopping)
+            {
+                break;
+            }
+            pthread_cond_wait(&squeued, &slock);
+            continue;
+        }
+        shead = request->next;
+        if (NULL == shead)
+        {
+            stail = NULL;
+        }
+        pthread_mutex_unlock(&slock);
+
+        /* the lookup is the slow part, it runs without the lock */
+        run_request(request);
+
+        pthread_mutex_lock(&slock);
+        request->done = 1;
+        pthread_cond_broadcast(&sfinished);
+    }
+    pthread_mutex_unlock(&slock);
+
+    return NULL;
+}
+
+/**
+ *
+ * \brief Carries out a lookup.
+ *
+ * \param request the lookup, receives the result.
+ *
+ * \return void
+ */
+static void run_request(PrefetchRequest* request)
+{
+    request->error = 0;
+    if (PREFETCH_STAT == request->kind)
+    {
+        if (fstatat(request->dir_fd, request->name, request->info, AT_SYMLINK_NOFOLLOW) < 0)
+        {
+            request->error = errno;
+        }
+    }
+    else
+    {
+        request->fd = openat(request->dir_fd, request->name, request->flags);
+        if (-1 == request->fd)
+        {
+            request->error = errno;
+        }
+    }
+}
+
+/*
+ * =================================================================== eof ==
+ */
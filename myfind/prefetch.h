@@ -0,0 +1,105 @@
+/**
+ * @file prefetch.h
+ * \brief Metadata prefetch for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _PREFETCH_H_
+#define _PREFETCH_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * Kinds of lookups the helpers carry out.
+ */
+typedef enum prefetchKindEnum
+{
+    /** fstatat() of the entry, without following symbolic links. */
+    PREFETCH_STAT,
+    /** openat() of the entry as a directory. */
+    PREFETCH_OPEN
+} PrefetchKind;
+
+/**
+ * A lookup of a directory entry, owned by the caller until prefetch_wait() returned.
+ */
+typedef struct prefetchRequestStruct
+{
+    /** Next request in the queue of the helpers. */
+    struct prefetchRequestStruct* next;
+    /** What to do. */
+    PrefetchKind kind;
+    /** File descriptor of the directory of the entry. */
+    int dir_fd;
+    /** Name of the entry relative to dir_fd. */
+    const char* name;
+    /** PREFETCH_STAT: receives the file information. */
+    struct stat* info;
+    /** PREFETCH_OPEN: flags of openat(). */
+    int flags;
+    /** PREFETCH_OPEN: receives the file descriptor, -1 on error. */
+    int fd;
+    /** 0 on success, else errno of the lookup. */
+    int error;
+    /** The lookup is finished. */
+    int done;
+} PrefetchRequest;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Starts the helper threads, each of them has one lookup in flight.
+ *
+ * \param threads number of helpers, the window of concurrent lookups.
+ *
+ * \return 0 on success, else errno of pthread_create(); the helpers must then not be used.
+ */
+extern int prefetch_start(const int threads);
+
+/**
+ *
+ * \brief Queues a lookup, the helpers carry the lookups out in the order they were queued.
+ *
+ * \param request the lookup, must stay valid until prefetch_wait() returned.
+ *
+ * \return void
+ */
+extern void prefetch_submit(PrefetchRequest* request);
+
+/**
+ *
+ * \brief Waits until a lookup is finished.
+ *
+ * \param request queued by prefetch_submit().
+ *
+ * \return void
+ */
+extern void prefetch_wait(PrefetchRequest* request);
+
+/**
+ *
+ * \brief Stops the helper threads, all lookups must be finished.
+ *
+ * \return void
+ */
+extern void prefetch_stop(void);
+
+#endif /* _PREFETCH_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
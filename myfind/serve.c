@@ -0,0 +1,1265 @@
+/**
+ * @file serve.c
+ * \brief Live index server for myfind.
+ *
+ * --serve keeps the tree of the initial traversal in memory and current with inotify: every
+ * directory is watched, an event re-stats the entry it names and a new directory is read and
+ * watched. A client connecting to the Unix domain socket receives a sealed memfd holding an
+ * index of the tree in the format of fsindex.c, which it examines like an index file. The
+ * server thus needs no knowledge of the expressions, and the index is only written again
+ * after the tree changed.
+ *
+ * When the event queue overflows, every directory is read again.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "serve.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#endif /* __linux__ */
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING)
+/** inotify and sealed memfds are available. */
+#define HAVE_SERVE 1
+#else
+#define HAVE_SERVE 0
+#endif
+
+/** No such node. */
+#define NO_NODE INDEX_NO_RECORD
+
+/** Size of the buffer for inotify events. */
+#define EVENT_BUFFER_SIZE (64 * 1024)
+
+/** Number of hash buckets of a new tree, must be a power of two. */
+#define INITIAL_BUCKETS 1024
+
+/** Initial size of the buffers of the tree. */
+#define INITIAL_CAPACITY 1024
+
+#if HAVE_SERVE
+
+/** Events of a watched directory. */
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_MODIFY \
+        | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW \
+        | IN_EXCL_UNLINK)
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * A file of the tree.
+ */
+typedef struct serveNodeStruct
+{
+    /** Stat fields and parent (record.parent), name_offset is not used. */
+    IndexRecord record;
+    /** Name within the parent, the start path for the root; NULL if the node is free. */
+    char* name;
+    /** First entry of a directory. */
+    uint32_t first_child;
+    /** Last entry of a directory, new entries are appended. */
+    uint32_t last_child;
+    /** Next entry of the same directory, the next free node for free nodes. */
+    uint32_t next_sibling;
+    /** Previous entry of the same directory. */
+    uint32_t prev_sibling;
+    /** Next node in the same hash bucket. */
+    uint32_t hash_next;
+    /** Generation of the last reading of the parent which found the node. */
+    uint32_t seen;
+    /** inotify watch descriptor of a directory, -1 if not watched. */
+    int wd;
+} ServeNode;
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+/** Nodes of the tree, the root is node 0. */
+static ServeNode* snodes = NULL;
+
+/** Number of nodes in use or free. */
+static size_t snode_count = 0;
+
+/** Number of nodes there is room for. */
+static size_t snode_capacity = 0;
+
+/** Number of nodes in use. */
+static size_t slive_count = 0;
+
+/** First free node. */
+static uint32_t sfree_node = NO_NODE;
+
+/** Hash buckets over parent and name. */
+static uint32_t* sbuckets = NULL;
+
+/** Number of buckets - 1, the number of buckets is a power of two. */
+static size_t sbucket_mask = 0;
+
+/** Node of every watch descriptor. */
+static uint32_t* swatches = NULL;
+
+/** Number of watch descriptors swatches has room for. */
+static size_t swatch_capacity = 0;
+
+/** Directories to be read. */
+static uint32_t* sworklist = NULL;
+
+/** Number of directories in sworklist. */
+static size_t swork_count = 0;
+
+/** Number of directories sworklist has room for. */
+static size_t swork_capacity = 0;
+
+/** Path of a node, see build_path(). */
+static char* spath = NULL;
+
+/** Size of spath. */
+static size_t spath_capacity = 0;
+
+/** Counter for the seen generations. */
+static uint32_t sgeneration = 0;
+
+/** inotify instance. */
+static int sinotify = -1;
+
+/** The tree changed since the last snapshot. */
+static int sdirty = 1;
+
+/** memfd with the last snapshot, -1 if none. */
+static int ssnapshot = -1;
+
+/** INDEX_FLAG_... of the snapshots. */
+static uint32_t sflags = 0;
+
+/** Set by the signal handler, the server stops. */
+static volatile sig_atomic_t sstop = 0;
+
+static int load_tree(const IndexWriter* initial);
+static void free_tree(void);
+static uint32_t new_node(const uint32_t parent, const char* name, const IndexRecord* record);
+static void remove_node(const uint32_t node);
+static void free_node(const uint32_t node);
+static uint32_t find_child(const uint32_t parent, const char* name);
+static int grow_buckets(void);
+static size_t hash_child(const uint32_t parent, const char* name);
+static const char* build_path(const uint32_t node, const char* name);
+static void watch_dir(const uint32_t node);
+static void push_work(const uint32_t node);
+static void process_work(void);
+static void sync_dir(const uint32_t node);
+static void refresh_entry(const uint32_t dir, const char* name);
+static void restat_node(const uint32_t node, const struct stat* info);
+static void read_events(void);
+static int make_snapshot(void);
+static void answer_client(const int listen_fd);
+static int open_socket(const char* socket_path);
+static void on_signal(int signal_number);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+int serve_run(const IndexWriter* initial, const char* socket_path)
+{
+    struct sigaction action;
+    struct pollfd fds[2];
+    int listen_fd = -1;
+    int error = 0;
+
+    sinotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (-1 == sinotify)
+    {
+        return errno;
+    }
+    error = load_tree(initial);
+    if (0 == error)
+    {
+        listen_fd = open_socket(socket_path);
+        if (listen_fd < 0)
+        {
+            error = -listen_fd;
+        }
+    }
+    if (0 != error)
+    {
+        free_tree();
+        return error;
+    }
+
+    /* no SA_RESTART: the signal has to interrupt poll() */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    fds[0].fd = sinotify;
+    fds[0].events = POLLIN;
+    fds[1].fd = listen_fd;
+    fds[1].events = POLLIN;
+    while (!sstop)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            continue;
+        }
+        if (0 != (fds[0].revents & POLLIN))
+        {
+            read_events();
+        }
+        if (0 != (fds[1].revents & POLLIN))
+        {
+            answer_client(listen_fd);
+        }
+    }
+
+    close(listen_fd);
+    unlink(socket_path);
+    free_tree();
+    return 0;
+}
+
+int serve_fetch(const char* socket_path, int* fd)
+{
+    struct sockaddr_un address;
+    union
+    {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr message;
+    struct cmsghdr* header = NULL;
+    struct iovec vector;
+    char byte = 0;
+    int error = 0;
+    int sock = -1;
+
+    *fd = -1;
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        return ENAMETOOLONG;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (-1 == sock)
+    {
+        return errno;
+    }
+    if (connect(sock, (struct sockaddr*) &address, sizeof(address)) < 0)
+    {
+        error = errno;
+        close(sock);
+        return error;
+    }
+
+    memset(&message, 0, sizeof(message));
+    memset(&control, 0, sizeof(control));
+    vector.iov_base = &byte;
+    vector.iov_len = 1;
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    while ((recvmsg(sock, &message, MSG_CMSG_CLOEXEC) < 0) && (EINTR == errno))
+    {
+        /* interrupted, wait again */
+    }
+    close(sock);
+
+    header = CMSG_FIRSTHDR(&message);
+    if ((NULL == header) || (SOL_SOCKET != header->cmsg_level)
+            || (SCM_RIGHTS != header->cmsg_type))
+    {
+        /* the server failed to write the snapshot */
+        return EPROTO;
+    }
+    memcpy(fd, CMSG_DATA(header), sizeof(int));
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Sets up the tree from the records of the initial traversal and watches it.
+ *
+ * Directories which changed between the traversal and their watch are read again.
+ *
+ * \param initial the records, the root first and every parent before its entries.
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+static int load_tree(const IndexWriter* initial)
+{
+    size_t i = 0;
+
+    sflags = initial->flags;
+    sbucket_mask = INITIAL_BUCKETS - 1;
+    sbuckets = (uint32_t*) malloc(INITIAL_BUCKETS * sizeof(uint32_t));
+    if (NULL == sbuckets)
+    {
+        return ENOMEM;
+    }
+    memset(sbuckets, 0xff, INITIAL_BUCKETS * sizeof(uint32_t));
+
+    for (i = 0; i < initial->count; ++i)
+    {
+        const IndexRecord* record = &initial->records[i];
+
+        /* the nodes are numbered like the records */
+        if (NO_NODE == new_node(record->parent, initial->names + record->name_offset, record))
+        {
+            return ENOMEM;
+        }
+    }
+
+    for (i = 0; i < snode_count; ++i)
+    {
+        struct stat info;
+
+        if (!S_ISDIR(snodes[i].record.mode))
+        {
+            continue;
+        }
+        watch_dir((uint32_t) i);
+        if ((lstat(build_path((uint32_t) i, NULL), &info) < 0)
+                || !index_dir_unchanged(&snodes[i].record, &info))
+        {
+            push_work((uint32_t) i);
+        }
+    }
+    process_work();
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Frees the tree, the watches and the snapshot.
+ *
+ * \return void
+ */
+static void free_tree(void)
+{
+    size_t i = 0;
+
+    for (i = 0; i < snode_count; ++i)
+    {
+        free(snodes[i].name);
+    }
+    free(snodes);
+    free(sbuckets);
+    free(swatches);
+    free(sworklist);
+    free(spath);
+    snodes = NULL;
+    sbuckets = NULL;
+    swatches = NULL;
+    sworklist = NULL;
+    spath = NULL;
+    snode_count = 0;
+    snode_capacity = 0;
+    slive_count = 0;
+    sfree_node = NO_NODE;
+    swatch_capacity = 0;
+    swork_count = 0;
+    swork_capacity = 0;
+    spath_capacity = 0;
+
+    if (-1 != ssnapshot)
+    {
+        close(ssnapshot);
+        ssnapshot = -1;
+    }
+    if (-1 != sinotify)
+    {
+        close(sinotify);
+        sinotify = -1;
+    }
+}
+
+/**
+ *
+ * \brief Adds a node as last entry of its directory.
+ *
+ * \param parent the directory, NO_NODE for the root.
+ * \param name name of the node.
+ * \param record stat fields of the node.
+ *
+ * \return the new node, NO_NODE out of memory.
+ */
+static uint32_t new_node(const uint32_t parent, const char* name, const IndexRecord* record)
+{
+    uint32_t node = sfree_node;
+    ServeNode* entry = NULL;
+    char* copy = strdup(name);
+
+    if (NULL == copy)
+    {
+        return NO_NODE;
+    }
+    if ((slive_count + 1 > sbucket_mask + 1) && (0 != grow_buckets()))
+    {
+        free(copy);
+        return NO_NODE;
+    }
+    if (NO_NODE != node)
+    {
+        sfree_node = snodes[node].next_sibling;
+    }
+    else
+    {
+        if (snode_count == snode_capacity)
+        {
+            size_t capacity = (0 == snode_capacity) ? INITIAL_CAPACITY : 2 * snode_capacity;
+            ServeNode* nodes = (capacity >= NO_NODE) ? NULL
+                    : (ServeNode*) realloc(snodes, capacity * sizeof(ServeNode));
+
+            if (NULL == nodes)
+            {
+                free(copy);
+                return NO_NODE;
+            }
+            snodes = nodes;
+            snode_capacity = capacity;
+        }
+        node = (uint32_t) snode_count++;
+    }
+
+    entry = &snodes[node];
+    entry->record = *record;
+    entry->record.parent = parent;
+    entry->record.name_offset = 0;
+    entry->name = copy;
+    entry->first_child = NO_NODE;
+    entry->last_child = NO_NODE;
+    entry->next_sibling = NO_NODE;
+    entry->prev_sibling = NO_NODE;
+    entry->hash_next = NO_NODE;
+    entry->seen = sgeneration;
+    entry->wd = -1;
+    ++slive_count;
+
+    if (NO_NODE != parent)
+    {
+        size_t bucket = hash_child(parent, name) & sbucket_mask;
+
+        entry->prev_sibling = snodes[parent].last_child;
+        if (NO_NODE == snodes[parent].last_child)
+        {
+            snodes[parent].first_child = node;
+        }
+        else
+        {
+            snodes[snodes[parent].last_child].next_sibling = node;
+        }
+        snodes[parent].last_child = node;
+
+        entry->hash_next = sbuckets[bucket];
+        sbuckets[bucket] = node;
+    }
+    sdirty = 1;
+
+    return node;
+}
+
+/**
+ *
+ * \brief Removes a node and everything below it.
+ *
+ * \param node to be removed, not the root.
+ *
+ * \return void
+ */
+static void remove_node(const uint32_t node)
+{
+    uint32_t current = node;
+
+    /* the deepest first entry is always a leaf, removing it exposes the next one */
+    for (;;)
+    {
+        uint32_t parent = NO_NODE;
+
+        while (NO_NODE != snodes[current].first_child)
+        {
+            current = snodes[current].first_child;
+        }
+        parent = snodes[current].record.parent;
+        free_node(current);
+        if (current == node)
+        {
+            break;
+        }
+        current = parent;
+    }
+}
+
+/**
+ *
+ * \brief Unlinks a node without entries and puts it on the free list.
+ *
+ * \param node to be freed.
+ *
+ * \return void
+ */
+static void free_node(const uint32_t node)
+{
+    ServeNode* entry = &snodes[node];
+    const uint32_t parent = entry->record.parent;
+
+    if (entry->wd >= 0)
+    {
+        inotify_rm_watch(sinotify, entry->wd);
+        swatches[entry->wd] = NO_NODE;
+    }
+
+    if (NO_NODE != parent)
+    {
+        uint32_t* link = &sbuckets[hash_child(parent, entry->name) & sbucket_mask];
+
+        while (*link != node)
+        {
+            link = &snodes[*link].hash_next;
+        }
+        *link = entry->hash_next;
+
+        if (NO_NODE == entry->prev_sibling)
+        {
+            snodes[parent].first_child = entry->next_sibling;
+        }
+        else
+        {
+            snodes[entry->prev_sibling].next_sibling = entry->next_sibling;
+        }
+        if (NO_NODE == entry->next_sibling)
+        {
+            snodes[parent].last_child = entry->prev_sibling;
+        }
+        else
+        {
+            snodes[entry->next_sibling].prev_sibling = entry->prev_sibling;
+        }
+    }
+
+    free(entry->name);
+    entry->name = NULL;
+    entry->wd = -1;
+    entry->first_child = NO_NODE;
+    entry->next_sibling = sfree_node;
+    sfree_node = node;
+    --slive_count;
+    sdirty = 1;
+}
+
+/**
+ *
+ * \brief Finds the entry of a directory by name.
+ *
+ * \param parent the directory.
+ * \param name name of the entry.
+ *
+ * \return the entry, NO_NODE if there is none.
+ */
+static uint32_t find_child(const uint32_t parent, const char* name)
+{
+    uint32_t node = sbuckets[hash_child(parent, name) & sbucket_mask];
+
+    while ((NO_NODE != node)
+            && ((snodes[node].record.parent != parent) || (0 != strcmp(snodes[node].name, name))))
+    {
+        node = snodes[node].hash_next;
+    }
+    return node;
+}
+
+/**
+ *
+ * \brief Doubles the hash buckets and rehashes the nodes.
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+static int grow_buckets(void)
+{
+    size_t count = 2 * (sbucket_mask + 1);
+    uint32_t* buckets = (uint32_t*) malloc(count * sizeof(uint32_t));
+    size_t i = 0;
+
+    if (NULL == buckets)
+    {
+        return ENOMEM;
+    }
+    memset(buckets, 0xff, count * sizeof(uint32_t));
+    for (i = 0; i < snode_count; ++i)
+    {
+        if ((NULL != snodes[i].name) && (NO_NODE != snodes[i].record.parent))
+        {
+            size_t bucket = hash_child(snodes[i].record.parent, snodes[i].name) & (count - 1);
+
+            snodes[i].hash_next = buckets[bucket];
+            buckets[bucket] = (uint32_t) i;
+        }
+    }
+    free(sbuckets);
+    sbuckets = buckets;
+    sbucket_mask = count - 1;
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Hash value of an entry of a directory, FNV-1a over the name seeded with the parent.
+ *
+ * \param parent the directory.
+ * \param name name of the entry.
+ *
+ * \return hash value.
+ */
+static size_t hash_child(const uint32_t parent, const char* name)
+{
+    uint64_t hash = 14695981039346656037ULL ^ parent;
+
+    for (; '\0' != *name; ++name)
+    {
+        hash ^= (unsigned char) *name;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) hash;
+}
+
+/**
+ *
+ * \brief Builds the path of a node, or of an entry of it.
+ *
+ * \param node the node.
+ * \param name name of an entry of the node to be appended, NULL for the node itself.
+ *
+ * \return the path, valid until the next call; NULL out of memory.
+ */
+static const char* build_path(const uint32_t node, const char* name)
+{
+    size_t length = (NULL == name) ? 0 : strlen(name) + 1;
+    uint32_t current = node;
+    char* end = NULL;
+
+    for (; NO_NODE != current; current = snodes[current].record.parent)
+    {
+        length += strlen(snodes[current].name) + 1;
+    }
+    if (length > spath_capacity)
+    {
+        char* path = (char*) realloc(spath, 2 * length);
+
+        if (NULL == path)
+        {
+            return NULL;
+        }
+        spath = path;
+        spath_capacity = 2 * length;
+    }
+
+    /* filled in from the end, the root comes last */
+    end = spath + length - 1;
+    *end = '\0';
+    if (NULL != name)
+    {
+        end -= strlen(name);
+        memcpy(end, name, strlen(name));
+        *--end = '/';
+    }
+    for (current = node; NO_NODE != current; current = snodes[current].record.parent)
+    {
+        size_t name_length = strlen(snodes[current].name);
+
+        end -= name_length;
+        memcpy(end, snodes[current].name, name_length);
+        if (end > spath)
+        {
+            *--end = '/';
+        }
+    }
+
+    return spath;
+}
+
+/**
+ *
+ * \brief Starts watching a directory, if not done yet.
+ *
+ * \param node the directory.
+ *
+ * \return void
+ */
+static void watch_dir(const uint32_t node)
+{
+    const char* path = NULL;
+    int wd = -1;
+
+    if (snodes[node].wd >= 0)
+    {
+        return;
+    }
+    path = build_path(node, NULL);
+    wd = (NULL == path) ? -1 : inotify_add_watch(sinotify, path, WATCH_MASK);
+    if (wd < 0)
+    {
+        /* not readable, or the watches are exhausted: the directory stays as it is */
+        return;
+    }
+    if ((size_t) wd >= swatch_capacity)
+    {
+        size_t capacity = (0 == swatch_capacity) ? INITIAL_CAPACITY : swatch_capacity;
+        uint32_t* watches = NULL;
+
+        while ((size_t) wd >= capacity)
+        {
+            capacity *= 2;
+        }
+        watches = (uint32_t*) realloc(swatches, capacity * sizeof(uint32_t));
+        if (NULL == watches)
+        {
+            inotify_rm_watch(sinotify, wd);
+            return;
+        }
+        memset(watches + swatch_capacity, 0xff, (capacity - swatch_capacity) * sizeof(uint32_t));
+        swatches = watches;
+        swatch_capacity = capacity;
+    }
+    swatches[wd] = node;
+    snodes[node].wd = wd;
+}
+
+/**
+ *
+ * \brief Queues a directory to be read again.
+ *
+ * \param node the directory.
+ *
+ * \return void
+ */
+static void push_work(const uint32_t node)
+{
+    if (swork_count == swork_capacity)
+    {
+        size_t capacity = (0 == swork_capacity) ? INITIAL_CAPACITY : 2 * swork_capacity;
+        uint32_t* worklist = (uint32_t*) realloc(sworklist, capacity * sizeof(uint32_t));
+
+        if (NULL == worklist)
+        {
+            return;
+        }
+        sworklist = worklist;
+        swork_capacity = capacity;
+    }
+    sworklist[swork_count++] = node;
+}
+
+/**
+ *
+ * \brief Reads the queued directories, including the new directories found meanwhile.
+ *
+ * \return void
+ */
+static void process_work(void)
+{
+    while (swork_count > 0)
+    {
+        const uint32_t node = sworklist[--swork_count];
+
+        /* the directory may have been removed since it was queued */
+        if ((NULL != snodes[node].name) && S_ISDIR(snodes[node].record.mode))
+        {
+            sync_dir(node);
+        }
+    }
+}
+
+/**
+ *
+ * \brief Reads a directory and brings its entries up to date.
+ *
+ * The watch is set up before the directory is read, so no change gets lost in between.
+ *
+ * \param node the directory.
+ *
+ * \return void
+ */
+static void sync_dir(const uint32_t node)
+{
+    const char* path = NULL;
+    struct stat info;
+    struct dirent* dir_entry = NULL;
+    uint32_t child = NO_NODE;
+    uint32_t generation = 0;
+    DIR* dir = NULL;
+
+    watch_dir(node);
+    path = build_path(node, NULL);
+    if ((NULL == path) || (lstat(path, &info) < 0) || !S_ISDIR(info.st_mode))
+    {
+        if ((NULL != path) && (0 != node))
+        {
+            /* gone or replaced, the event of its parent tells */
+            refresh_entry(snodes[node].record.parent, snodes[node].name);
+        }
+        return;
+    }
+    restat_node(node, &info);
+
+    dir = opendir(path);
+    if (NULL == dir)
+    {
+        return;
+    }
+    generation = ++sgeneration;
+    while (NULL != (dir_entry = readdir(dir)))
+    {
+        if ((0 == strcmp(dir_entry->d_name, ".")) || (0 == strcmp(dir_entry->d_name, "..")))
+        {
+            continue;
+        }
+        refresh_entry(node, dir_entry->d_name);
+        child = find_child(node, dir_entry->d_name);
+        if (NO_NODE != child)
+        {
+            snodes[child].seen = generation;
+        }
+    }
+    closedir(dir);
+
+    /* entries which are not there any more */
+    child = snodes[node].first_child;
+    while (NO_NODE != child)
+    {
+        const uint32_t next = snodes[child].next_sibling;
+
+        if (generation != snodes[child].seen)
+        {
+            remove_node(child);
+        }
+        child = next;
+    }
+}
+
+/**
+ *
+ * \brief Brings an entry of a directory up to date: adds, updates or removes it.
+ *
+ * A new directory is queued to be read.
+ *
+ * \param dir the directory.
+ * \param name name of the entry.
+ *
+ * \return void
+ */
+static void refresh_entry(const uint32_t dir, const char* name)
+{
+    const char* path = build_path(dir, name);
+    uint32_t child = find_child(dir, name);
+    IndexRecord record;
+    struct stat info;
+
+    if ((NULL == path) || (lstat(path, &info) < 0))
+    {
+        if (NO_NODE != child)
+        {
+            remove_node(child);
+        }
+        return;
+    }
+
+    index_record_fill(&record, &info);
+    if ((NO_NODE != child) && ((snodes[child].record.mode & S_IFMT) != (record.mode & S_IFMT)))
+    {
+        /* replaced by a file of another type */
+        remove_node(child);
+        child = NO_NODE;
+    }
+    if (NO_NODE == child)
+    {
+        child = new_node(dir, name, &record);
+        if ((NO_NODE != child) && S_ISDIR(info.st_mode))
+        {
+            push_work(child);
+        }
+        return;
+    }
+
+    restat_node(child, &info);
+}
+
+/**
+ *
+ * \brief Updates the stat fields of a node.
+ *
+ * \param node the node.
+ * \param info its current file information.
+ *
+ * \return void
+ */
+static void restat_node(const uint32_t node, const struct stat* info)
+{
+    const uint32_t parent = snodes[node].record.parent;
+
+    index_record_fill(&snodes[node].record, info);
+    snodes[node].record.parent = parent;
+    sdirty = 1;
+}
+
+/**
+ *
+ * \brief Reads the pending inotify events and updates the tree.
+ *
+ * \return void
+ */
+static void read_events(void)
+{
+    char buffer[EVENT_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int overflow = 0;
+    ssize_t length = 0;
+
+    while ((length = read(sinotify, buffer, sizeof(buffer))) > 0)
+    {
+        ssize_t offset = 0;
+
+        while (offset < length)
+        {
+            const struct inotify_event* event = (const struct inotify_event*) (buffer + offset);
+            uint32_t node = NO_NODE;
+
+            offset += sizeof(struct inotify_event) + event->len;
+            if (0 != (event->mask & IN_Q_OVERFLOW))
+            {
+                overflow = 1;
+                continue;
+            }
+            if ((event->wd < 0) || ((size_t) event->wd >= swatch_capacity))
+            {
+                continue;
+            }
+            node = swatches[event->wd];
+            if (NO_NODE == node)
+            {
+                continue;
+            }
+            if (0 != (event->mask & IN_IGNORED))
+            {
+                /* the directory is gone, its parent's event removes the node */
+                swatches[event->wd] = NO_NODE;
+                snodes[node].wd = -1;
+                continue;
+            }
+
+            if (0 == event->len)
+            {
+                /* the directory itself changed or is gone, the root has no parent to ask */
+                if (0 != node)
+                {
+                    refresh_entry(snodes[node].record.parent, snodes[node].name);
+                }
+                else
+                {
+                    push_work(node);
+                }
+                continue;
+            }
+            refresh_entry(node, event->name);
+
+            /* creating, removing and renaming entries changes the mtime of the directory */
+            if (0 != (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)))
+            {
+                struct stat info;
+                const char* path = build_path(node, NULL);
+
+                if ((NULL != path) && (0 == lstat(path, &info)))
+                {
+                    restat_node(node, &info);
+                }
+            }
+        }
+    }
+
+    if (overflow)
+    {
+        size_t i = 0;
+
+        /* events got lost, every directory is read again */
+        for (i = 0; i < snode_count; ++i)
+        {
+            if ((NULL != snodes[i].name) && S_ISDIR(snodes[i].record.mode))
+            {
+                push_work((uint32_t) i);
+            }
+        }
+    }
+    process_work();
+}
+
+/**
+ *
+ * \brief Writes the tree into a new sealed memfd, in the order of a traversal.
+ *
+ * \return 0 on success, else errno.
+ */
+static int make_snapshot(void)
+{
+    IndexWriter writer;
+    uint32_t* stack = NULL;
+    size_t depth = 0;
+    size_t capacity = INITIAL_CAPACITY;
+    uint32_t record = 0;
+    int error = 0;
+    int fd = -1;
+
+    /* depth first, two entries per level: the next node to be written and its parent record */
+    index_writer_init(&writer, sflags);
+    stack = (uint32_t*) malloc(2 * capacity * sizeof(uint32_t));
+    error = (NULL == stack) ? ENOMEM : index_writer_add_record(&writer, INDEX_NO_PARENT,
+            snodes[0].name, &snodes[0].record, &record);
+    if (0 == error)
+    {
+        stack[0] = snodes[0].first_child;
+        stack[1] = record;
+        depth = 1;
+    }
+    while ((0 == error) && (depth > 0))
+    {
+        uint32_t* level = &stack[2 * (depth - 1)];
+        const uint32_t node = level[0];
+
+        if (NO_NODE == node)
+        {
+            --depth;
+            continue;
+        }
+        level[0] = snodes[node].next_sibling;
+        error = index_writer_add_record(&writer, level[1], snodes[node].name,
+                &snodes[node].record, &record);
+        if ((0 != error) || (NO_NODE == snodes[node].first_child))
+        {
+            continue;
+        }
+        if (depth == capacity)
+        {
+            uint32_t* more = (uint32_t*) realloc(stack, 4 * capacity * sizeof(uint32_t));
+
+            if (NULL == more)
+            {
+                error = ENOMEM;
+                continue;
+            }
+            stack = more;
+            capacity *= 2;
+        }
+        stack[2 * depth] = snodes[node].first_child;
+        stack[2 * depth + 1] = record;
+        ++depth;
+    }
+    free(stack);
+
+    if (0 == error)
+    {
+        fd = memfd_create("myfind-index", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        error = (-1 == fd) ? errno : index_writer_write(&writer, fd);
+    }
+    index_writer_free(&writer);
+    if (0 != error)
+    {
+        if (-1 != fd)
+        {
+            close(fd);
+        }
+        return error;
+    }
+
+    /* the clients share the snapshot, nobody may change it */
+    (void) fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    if (-1 != ssnapshot)
+    {
+        close(ssnapshot);
+    }
+    ssnapshot = fd;
+    sdirty = 0;
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Accepts a client and sends it the current snapshot.
+ *
+ * Events which are already queued are applied first. If no snapshot can be written the
+ * client gets no file descriptor.
+ *
+ * \param listen_fd the listening socket.
+ *
+ * \return void
+ */
+static void answer_client(const int listen_fd)
+{
+    union
+    {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr message;
+    struct iovec vector;
+    char byte = 'I';
+    int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+    if (-1 == client)
+    {
+        return;
+    }
+    read_events();
+    if (sdirty || (-1 == ssnapshot))
+    {
+        (void) make_snapshot();
+    }
+
+    memset(&message, 0, sizeof(message));
+    memset(&control, 0, sizeof(control));
+    vector.iov_base = &byte;
+    vector.iov_len = 1;
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    if (-1 != ssnapshot)
+    {
+        struct cmsghdr* header = NULL;
+
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+        header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(header), &ssnapshot, sizeof(int));
+    }
+    (void) sendmsg(client, &message, MSG_NOSIGNAL);
+    close(client);
+}
+
+/**
+ *
+ * \brief Creates the listening socket, a stale socket of a dead server is replaced.
+ *
+ * \param socket_path path of the socket.
+ *
+ * \return file descriptor of the socket, else -errno.
+ */
+static int open_socket(const char* socket_path)
+{
+    struct sockaddr_un address;
+    struct stat info;
+    int sock = -1;
+    int error = 0;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        return -ENAMETOOLONG;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (-1 == sock)
+    {
+        return -errno;
+    }
+    if (0 == connect(sock, (struct sockaddr*) &address, sizeof(address)))
+    {
+        /* somebody answers there */
+        close(sock);
+        return -EADDRINUSE;
+    }
+    close(sock);
+    if ((0 == lstat(socket_path, &info)) && S_ISSOCK(info.st_mode))
+    {
+        /* left behind by a server which did not stop cleanly */
+        unlink(socket_path);
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (-1 == sock)
+    {
+        return -errno;
+    }
+    if ((bind(sock, (struct sockaddr*) &address, sizeof(address)) < 0)
+            || (listen(sock, SOMAXCONN) < 0))
+    {
+        error = errno;
+        close(sock);
+        return -error;
+    }
+
+    return sock;
+}
+
+/**
+ *
+ * \brief Signal handler for SIGINT and SIGTERM, lets the server stop.
+ *
+ * \param signal_number unused.
+ *
+ * \return void
+ */
+static void on_signal(int signal_number)
+{
+    (void) signal_number;
+    sstop = 1;
+}
+
+#else /* HAVE_SERVE */
+
+int serve_run(const IndexWriter* initial, const char* socket_path)
+{
+    (void) initial;
+    (void) socket_path;
+    return ENOSYS;
+}
+
+int serve_fetch(const char* socket_path, int* fd)
+{
+    (void) socket_path;
+    *fd = -1;
+    return ENOSYS;
+}
+
+#endif /* HAVE_SERVE */
+
+/*
+ * =================================================================== eof ==
+ */
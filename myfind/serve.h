@@ -0,0 +1,52 @@
+/**
+ * @file serve.h
+ * \brief Live index server for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _SERVE_H_
+#define _SERVE_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include "fsindex.h"
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Keeps a tree current with inotify and hands out snapshots of it until SIGINT/SIGTERM.
+ *
+ * Every client connecting to the socket receives a file descriptor of a sealed in-memory
+ * index of the tree (SCM_RIGHTS), see serve_fetch().
+ *
+ * \param initial records of the initial traversal, the root first.
+ * \param socket_path Unix domain socket to listen on, created and removed again.
+ *
+ * \return 0 after a signal, else errno of the setup (EADDRINUSE if a server is running,
+ *         ENOSYS without inotify).
+ */
+extern int serve_run(const IndexWriter* initial, const char* socket_path);
+
+/**
+ *
+ * \brief Fetches the current index from a server.
+ *
+ * \param socket_path Unix domain socket of the server.
+ * \param fd receives the file descriptor of the index, see index_open_fd().
+ *
+ * \return 0 on success, else errno.
+ */
+extern int serve_fetch(const char* socket_path, int* fd);
+
+#endif /* _SERVE_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
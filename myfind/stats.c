@@ -0,0 +1,116 @@
+/**
+ * @file stats.c
+ * \brief Traversal statistics for myfind.
+ *
+ * --stats counts per worker into plain fields, no atomic operation or lock on the hot path;
+ * the workers are summed up when they are done. Only the open file descriptors are counted
+ * process wide, to get their peak.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "stats.h"
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Nanoseconds per second. */
+#define STATS_NS_PER_SECOND 1000000000
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+/** File descriptors of myfind open at the moment. */
+static atomic_long sopen_fds = 0;
+
+/** Most file descriptors of myfind open at the same time. */
+static atomic_long speak_fds = 0;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+int stats_init(StatsCounters* counters, const size_t instruction_count)
+{
+    memset(counters, 0, sizeof(*counters));
+    counters->evaluations = (unsigned long*) calloc(instruction_count + 1, sizeof(unsigned long));
+    counters->passes = (unsigned long*) calloc(instruction_count + 1, sizeof(unsigned long));
+    if ((NULL == counters->evaluations) || (NULL == counters->passes))
+    {
+        stats_free(counters);
+        return ENOMEM;
+    }
+    counters->instruction_count = instruction_count;
+
+    return 0;
+}
+
+void stats_free(StatsCounters* counters)
+{
+    free(counters->evaluations);
+    free(counters->passes);
+    memset(counters, 0, sizeof(*counters));
+}
+
+void stats_merge(StatsCounters* total, const StatsCounters* part)
+{
+    size_t i = 0;
+
+    total->dirs_opened += part->dirs_opened;
+    total->entries_read += part->entries_read;
+    total->stat_calls += part->stat_calls;
+    total->syscall_ns += part->syscall_ns;
+    total->match_ns += part->match_ns;
+    total->output_ns += part->output_ns;
+    for (i = 0; (i < total->instruction_count) && (i < part->instruction_count); ++i)
+    {
+        total->evaluations[i] += part->evaluations[i];
+        total->passes[i] += part->passes[i];
+    }
+}
+
+uint64_t stats_now(void)
+{
+    struct timespec now;
+
+    /* served from the vDSO, no system call */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * STATS_NS_PER_SECOND + (uint64_t) now.tv_nsec;
+}
+
+void stats_open_fds(const long change)
+{
+    long open_fds = atomic_fetch_add(&sopen_fds, change) + change;
+    long peak = atomic_load(&speak_fds);
+
+    while ((open_fds > peak) && !atomic_compare_exchange_weak(&speak_fds, &peak, open_fds))
+    {
+        /* another worker raised the peak in between, peak was reloaded */
+    }
+}
+
+long stats_peak_fds(void)
+{
+    return atomic_load(&speak_fds);
+}
+
+/*
+ * =================================================================== eof ==
+ */
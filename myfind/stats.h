@@ -0,0 +1,120 @@
+/**
+ * @file stats.h
+ * \brief Traversal statistics for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * Counters of one worker, plain fields which only the worker itself writes.
+ */
+typedef struct statsCountersStruct
+{
+    /** Directories opened. */
+    unsigned long dirs_opened;
+    /** Entries read from the directories. */
+    unsigned long entries_read;
+    /** lstat() calls: start path and entries, synchronously, with io_uring or prefetched. */
+    unsigned long stat_calls;
+    /** Nanoseconds in the system calls of the traversal: open, read, stat and close. */
+    uint64_t syscall_ns;
+    /** Nanoseconds examining the files, output_ns included. */
+    uint64_t match_ns;
+    /** Nanoseconds in -print, -ls and -exec. */
+    uint64_t output_ns;
+    /** Number of instructions of the program, the size of evaluations and passes. */
+    size_t instruction_count;
+    /** How often every instruction of the program was evaluated. */
+    unsigned long* evaluations;
+    /** How often every instruction of the program was true. */
+    unsigned long* passes;
+} StatsCounters;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Sets all counters of a worker to 0.
+ *
+ * \param counters the counters.
+ * \param instruction_count number of instructions of the program.
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+extern int stats_init(StatsCounters* counters, const size_t instruction_count);
+
+/**
+ *
+ * \brief Frees the counters of a worker.
+ *
+ * \param counters the counters.
+ *
+ * \return void
+ */
+extern void stats_free(StatsCounters* counters);
+
+/**
+ *
+ * \brief Adds the counters of a worker to the total.
+ *
+ * \param total the sum, initialized with the same number of instructions.
+ * \param part the counters of the worker.
+ *
+ * \return void
+ */
+extern void stats_merge(StatsCounters* total, const StatsCounters* part);
+
+/**
+ *
+ * \brief Monotonic clock for the phases.
+ *
+ * \return nanoseconds since an arbitrary point in time.
+ */
+extern uint64_t stats_now(void);
+
+/**
+ *
+ * \brief Records that file descriptors were opened or closed.
+ *
+ * The only counter shared by the workers, as the limit on open files is per process. Every
+ * descriptor myfind opens itself is counted: directories, also the ones opened ahead, the
+ * io_uring, the index, the -name-from patterns and the directories of -execdir batches. Not
+ * counted are stdin, stdout and stderr and the files the C library opens for its user and
+ * group lookups.
+ *
+ * \param change number of descriptors opened, negative if closed.
+ *
+ * \return void
+ */
+extern void stats_open_fds(const long change);
+
+/**
+ *
+ * \brief Most directory descriptors open at the same time.
+ *
+ * \return the peak of stats_open_fds(), stdin, stdout and stderr not included.
+ */
+extern long stats_peak_fds(void);
+
+#endif /* _STATS_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,372 @@
+/**
+ * @file table.c
+ * \brief Columnar file table for myfind.
+ *
+ * --group-by loads the files into one array per field instead of one record per file. The
+ * filters on the type and the owner then become scans over the mode and uid arrays which
+ * narrow down a selection bitmap, 64 rows per word; the group-by sums up the sizes of the
+ * selected rows per value of the uid, gid or type.
+ *
+ * With SSE2 four rows are compared with one instruction and the results are gathered into the
+ * bitmap with movemask, otherwise one row after the other.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "table.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Number of hash slots of a new group-by, must be a power of two. */
+#define TABLE_INITIAL_SLOTS 64
+
+/** No group in a hash slot. */
+#define TABLE_NO_GROUP SIZE_MAX
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+static uint64_t match_block(const uint32_t* block, const size_t count, const uint32_t mask,
+        const uint32_t value);
+static size_t hash_key(const uint32_t key);
+static int compare_groups(const void* left, const void* right);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+int table_load(FileTable* table, const IndexRecord* records, const size_t count,
+        const char* names)
+{
+    size_t i = 0;
+
+    memset(table, 0, sizeof(*table));
+    table->ino = (uint64_t*) malloc((count + 1) * sizeof(uint64_t));
+    table->size = (uint64_t*) malloc((count + 1) * sizeof(uint64_t));
+    table->uid = (uint32_t*) malloc((count + 1) * sizeof(uint32_t));
+    table->gid = (uint32_t*) malloc((count + 1) * sizeof(uint32_t));
+    table->mode = (uint32_t*) malloc((count + 1) * sizeof(uint32_t));
+    table->mtime = (int64_t*) malloc((count + 1) * sizeof(int64_t));
+    table->name_offset = (uint64_t*) malloc((count + 1) * sizeof(uint64_t));
+    table->parent = (uint32_t*) malloc((count + 1) * sizeof(uint32_t));
+    if ((NULL == table->ino) || (NULL == table->size) || (NULL == table->uid)
+            || (NULL == table->gid) || (NULL == table->mode) || (NULL == table->mtime)
+            || (NULL == table->name_offset) || (NULL == table->parent))
+    {
+        table_free(table);
+        return ENOMEM;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        const IndexRecord* record = &records[i];
+
+        table->ino[i] = record->ino;
+        table->size[i] = record->size;
+        table->uid[i] = record->uid;
+        table->gid[i] = record->gid;
+        table->mode[i] = record->mode;
+        table->mtime[i] = record->mtime;
+        table->name_offset[i] = record->name_offset;
+        table->parent[i] = record->parent;
+    }
+    table->names = names;
+    table->count = count;
+    table->words = (count + TABLE_WORD_BITS - 1) / TABLE_WORD_BITS;
+
+    return 0;
+}
+
+void table_free(FileTable* table)
+{
+    free(table->ino);
+    free(table->size);
+    free(table->uid);
+    free(table->gid);
+    free(table->mode);
+    free(table->mtime);
+    free(table->name_offset);
+    free(table->parent);
+    memset(table, 0, sizeof(*table));
+}
+
+void table_select_from(const FileTable* table, const size_t first, uint64_t* bitmap)
+{
+    size_t i = 0;
+
+    if (0 == table->words)
+    {
+        return;
+    }
+    memset(bitmap, 0xff, table->words * sizeof(uint64_t));
+    if (0 != (table->count % TABLE_WORD_BITS))
+    {
+        bitmap[table->words - 1] = (UINT64_C(1) << (table->count % TABLE_WORD_BITS)) - 1;
+    }
+    for (i = 0; (i < first) && (i < table->count); ++i)
+    {
+        bitmap[i / TABLE_WORD_BITS] &= ~(UINT64_C(1) << (i % TABLE_WORD_BITS));
+    }
+}
+
+void table_filter_equal(const uint32_t* column, const size_t count, const uint32_t mask,
+        const uint32_t value, uint64_t* bitmap)
+{
+    size_t word = 0;
+
+    for (word = 0; word * TABLE_WORD_BITS < count; ++word)
+    {
+        const size_t first = word * TABLE_WORD_BITS;
+        const size_t rows = (count - first < TABLE_WORD_BITS) ? count - first : TABLE_WORD_BITS;
+
+        if (0 != bitmap[word])
+        {
+            bitmap[word] &= match_block(column + first, rows, mask, value);
+        }
+    }
+}
+
+const char* table_name(const FileTable* table, const size_t row)
+{
+    return table->names + table->name_offset[row];
+}
+
+int table_path(const FileTable* table, const size_t row, char** buffer, size_t* capacity)
+{
+    size_t length = 0;
+    size_t current = row;
+    char* end = NULL;
+
+    for (current = row; INDEX_NO_PARENT != current; current = table->parent[current])
+    {
+        length += strlen(table_name(table, current)) + 1;
+    }
+    if (length > *capacity)
+    {
+        char* path = (char*) realloc(*buffer, 2 * length);
+
+        if (NULL == path)
+        {
+            return ENOMEM;
+        }
+        *buffer = path;
+        *capacity = 2 * length;
+    }
+
+    /* filled in from the end, the start path comes last */
+    end = *buffer + length - 1;
+    *end = '\0';
+    for (current = row; INDEX_NO_PARENT != current; current = table->parent[current])
+    {
+        const char* name = table_name(table, current);
+        size_t name_length = strlen(name);
+
+        end -= name_length;
+        memcpy(end, name, name_length);
+        if (end > *buffer)
+        {
+            *--end = '/';
+        }
+    }
+
+    return 0;
+}
+
+int table_group_by(const FileTable* table, const uint32_t* column, const uint32_t mask,
+        const uint64_t* bitmap, TableGroup** groups, size_t* group_count)
+{
+    size_t slot_mask = TABLE_INITIAL_SLOTS - 1;
+    size_t* slots = (size_t*) malloc(TABLE_INITIAL_SLOTS * sizeof(size_t));
+    TableGroup* found = NULL;
+    size_t capacity = 0;
+    size_t count = 0;
+    size_t word = 0;
+
+    *groups = NULL;
+    *group_count = 0;
+    if (NULL == slots)
+    {
+        return ENOMEM;
+    }
+    memset(slots, 0xff, TABLE_INITIAL_SLOTS * sizeof(size_t));
+
+    for (word = 0; word < table->words; ++word)
+    {
+        uint64_t bits = bitmap[word];
+
+        /* only the selected rows, lowest bit first */
+        while (0 != bits)
+        {
+            const size_t row = word * TABLE_WORD_BITS + (size_t) __builtin_ctzll(bits);
+            const uint32_t key = column[row] & mask;
+            size_t slot = hash_key(key) & slot_mask;
+
+            bits &= bits - 1;
+            while ((TABLE_NO_GROUP != slots[slot]) && (found[slots[slot]].key != key))
+            {
+                slot = (slot + 1) & slot_mask;
+            }
+            if (TABLE_NO_GROUP == slots[slot])
+            {
+                if (count == capacity)
+                {
+                    size_t more = (0 == capacity) ? TABLE_INITIAL_SLOTS : 2 * capacity;
+                    TableGroup* grown = (TableGroup*) realloc(found, more * sizeof(TableGroup));
+
+                    if (NULL == grown)
+                    {
+                        free(found);
+                        free(slots);
+                        return ENOMEM;
+                    }
+                    found = grown;
+                    capacity = more;
+                }
+                found[count].key = key;
+                found[count].files = 0;
+                found[count].bytes = 0;
+                slots[slot] = count++;
+
+                if (2 * count > slot_mask)
+                {
+                    /* half full: double the slots and insert the groups again */
+                    size_t* grown = (size_t*) malloc(2 * (slot_mask + 1) * sizeof(size_t));
+                    size_t i = 0;
+
+                    if (NULL == grown)
+                    {
+                        free(found);
+                        free(slots);
+                        return ENOMEM;
+                    }
+                    free(slots);
+                    slots = grown;
+                    slot_mask = 2 * (slot_mask + 1) - 1;
+                    memset(slots, 0xff, (slot_mask + 1) * sizeof(size_t));
+                    for (i = 0; i < count; ++i)
+                    {
+                        size_t free_slot = hash_key(found[i].key) & slot_mask;
+
+                        while (TABLE_NO_GROUP != slots[free_slot])
+                        {
+                            free_slot = (free_slot + 1) & slot_mask;
+                        }
+                        slots[free_slot] = i;
+                    }
+                    slot = hash_key(key) & slot_mask;
+                    while (found[slots[slot]].key != key)
+                    {
+                        slot = (slot + 1) & slot_mask;
+                    }
+                }
+            }
+            ++found[slots[slot]].files;
+            found[slots[slot]].bytes += table->size[row];
+        }
+    }
+    free(slots);
+
+    if (count > 0)
+    {
+        qsort(found, count, sizeof(TableGroup), compare_groups);
+    }
+    *groups = found;
+    *group_count = count;
+
+    return 0;
+}
+
+/**
+ *
+ * \brief Compares up to 64 rows of a field with a value.
+ *
+ * \param block first row.
+ * \param count number of rows, at most TABLE_WORD_BITS.
+ * \param mask bits of the field to be compared.
+ * \param value value of the masked field.
+ *
+ * \return bitmap of the matching rows, bit 0 for the first row.
+ */
+static uint64_t match_block(const uint32_t* block, const size_t count, const uint32_t mask,
+        const uint32_t value)
+{
+    uint64_t bits = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i masks = _mm_set1_epi32((int) mask);
+    const __m128i values = _mm_set1_epi32((int) value);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i rows = _mm_loadu_si128((const __m128i*) (block + i));
+        __m128i equal = _mm_cmpeq_epi32(_mm_and_si128(rows, masks), values);
+
+        bits |= (uint64_t) _mm_movemask_ps(_mm_castsi128_ps(equal)) << i;
+    }
+#endif /* __SSE2__ */
+    for (; i < count; ++i)
+    {
+        bits |= (uint64_t) ((block[i] & mask) == value) << i;
+    }
+
+    return bits;
+}
+
+/**
+ *
+ * \brief Hash value of a group-by key.
+ *
+ * \param key the key.
+ *
+ * \return hash value.
+ */
+static size_t hash_key(const uint32_t key)
+{
+    /* multiplicative hash, user and group ids are often consecutive */
+    return (size_t) ((key * UINT64_C(11400714819323198485)) >> 32);
+}
+
+/**
+ *
+ * \brief qsort() comparison of groups: more bytes first, then by key.
+ *
+ * \param left a group.
+ * \param right another group.
+ *
+ * \return < 0 if left comes first, > 0 if right comes first.
+ */
+static int compare_groups(const void* left, const void* right)
+{
+    const TableGroup* a = (const TableGroup*) left;
+    const TableGroup* b = (const TableGroup*) right;
+
+    if (a->bytes != b->bytes)
+    {
+        return (a->bytes > b->bytes) ? -1 : 1;
+    }
+    return (a->key < b->key) ? -1 : (a->key > b->key);
+}
+
+/*
+ * =================================================================== eof ==
+ */
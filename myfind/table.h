@@ -0,0 +1,177 @@
+/**
+ * @file table.h
+ * \brief Columnar file table for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _TABLE_H_
+#define _TABLE_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fsindex.h"
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+/** Rows per word of a selection bitmap. */
+#define TABLE_WORD_BITS 64
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * The files of a traversal or an index, one array per field.
+ *
+ * A predicate on one field only reads that array, sequentially. The rows are in the order of
+ * the traversal, so the parent of a row comes before it.
+ */
+typedef struct fileTableStruct
+{
+    /** st_ino of every row. */
+    uint64_t* ino;
+    /** st_size of every row. */
+    uint64_t* size;
+    /** st_uid of every row. */
+    uint32_t* uid;
+    /** st_gid of every row. */
+    uint32_t* gid;
+    /** st_mode of every row. */
+    uint32_t* mode;
+    /** st_mtime of every row. */
+    int64_t* mtime;
+    /** Offset of the name of every row in names. */
+    uint64_t* name_offset;
+    /** Row of the parent directory of every row, INDEX_NO_PARENT for the start path. */
+    uint32_t* parent;
+    /** Names of the rows, borrowed from the records the table was loaded from. */
+    const char* names;
+    /** Number of rows. */
+    size_t count;
+    /** Number of words of a selection bitmap. */
+    size_t words;
+} FileTable;
+
+/**
+ * Files and bytes of one value of the group-by field.
+ */
+typedef struct tableGroupStruct
+{
+    /** Value of the field. */
+    uint32_t key;
+    /** Number of selected rows with this value. */
+    uint64_t files;
+    /** Sum of their sizes. */
+    uint64_t bytes;
+} TableGroup;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Splits records into the columns of a table.
+ *
+ * \param table receives the columns.
+ * \param records the records, in the order of the traversal.
+ * \param count number of records.
+ * \param names names of the records, must stay valid while the table is used.
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+extern int table_load(FileTable* table, const IndexRecord* records, const size_t count,
+        const char* names);
+
+/**
+ *
+ * \brief Frees the columns of a table.
+ *
+ * \param table the table.
+ *
+ * \return void
+ */
+extern void table_free(FileTable* table);
+
+/**
+ *
+ * \brief Selects every row from first on.
+ *
+ * \param table the table.
+ * \param first first row to be selected, the rows before are not.
+ * \param bitmap receives the selection, table->words words.
+ *
+ * \return void
+ */
+extern void table_select_from(const FileTable* table, const size_t first, uint64_t* bitmap);
+
+/**
+ *
+ * \brief Keeps the selected rows whose masked field equals a value.
+ *
+ * Words without a selected row are skipped, so later filters get cheaper.
+ *
+ * \param column the field, e.g. table->mode.
+ * \param count number of rows.
+ * \param mask bits of the field to be compared.
+ * \param value value of the masked field.
+ * \param bitmap the selection, rows not matching are cleared.
+ *
+ * \return void
+ */
+extern void table_filter_equal(const uint32_t* column, const size_t count, const uint32_t mask,
+        const uint32_t value, uint64_t* bitmap);
+
+/**
+ *
+ * \brief Name of a row.
+ *
+ * \param table the table.
+ * \param row the row.
+ *
+ * \return '\0' terminated name, the path as given for the start path.
+ */
+extern const char* table_name(const FileTable* table, const size_t row);
+
+/**
+ *
+ * \brief Builds the path of a row from the names of its parents.
+ *
+ * \param table the table.
+ * \param row the row.
+ * \param buffer the path, grown as needed.
+ * \param capacity size of buffer.
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+extern int table_path(const FileTable* table, const size_t row, char** buffer, size_t* capacity);
+
+/**
+ *
+ * \brief Counts files and bytes of the selected rows for every value of a field.
+ *
+ * \param table the table.
+ * \param column the field, e.g. table->uid.
+ * \param mask bits of the field which make up the key.
+ * \param bitmap the selection.
+ * \param groups receives the groups, largest number of bytes first; free() it.
+ * \param group_count receives the number of groups.
+ *
+ * \return 0 on success, else ENOMEM.
+ */
+extern int table_group_by(const FileTable* table, const uint32_t* column, const uint32_t mask,
+        const uint64_t* bitmap, TableGroup** groups, size_t* group_count);
+
+#endif /* _TABLE_H_ */
+
+/*
+ * =================================================================== eof ==
+ */
@@ -0,0 +1,372 @@
+/**
+ * @file uring.c
+ * \brief Batched stat with io_uring for myfind.
+ *
+ * A directory batch is stat'ed by queueing one IORING_OP_STATX per entry: the kernel works on
+ * many of them at once instead of one fstatat() after the other blocking the thread. The ring
+ * is driven by the raw system calls, liburing is not needed.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+/*
+ * -------------------------------------------------------------- review --
+ */
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "uring.h"
+
+#ifdef __linux__
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <linux/stat.h>
+#include <linux/io_uring.h>
+#endif /* __linux__ */
+
+/*
+ * --------------------------------------------------------------- defines --
+ */
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+/** The kernel headers know io_uring, whether the kernel does is found out at run time. */
+#define HAVE_IO_URING 1
+#else
+#define HAVE_IO_URING 0
+#endif
+
+#if HAVE_IO_URING
+
+/*
+ * --------------------------------------------------------------- static --
+ */
+
+static void* map_ring(const int fd, const size_t size, const off_t offset);
+static void submit_statx(StatRing* ring, const int dir_fd, StatRequest* request,
+        const unsigned int mask);
+static void complete(StatRing* ring, const struct io_uring_cqe* cqe);
+static void statx_to_stat(const struct statx* source, struct stat* dest);
+static unsigned int get_statx_mask(const int fields);
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+int stat_ring_init(StatRing* ring, const unsigned int entries)
+{
+    struct io_uring_params params;
+    unsigned int i = 0;
+    long fd = 0;
+
+    memset(ring, 0, sizeof(StatRing));
+    ring->fd = -1;
+
+    memset(&params, 0, sizeof(params));
+    fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+    {
+        return errno;
+    }
+    ring->fd = (int) fd;
+    ring->entries = params.sq_entries;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (0 != (params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        /* both rings share one mapping */
+        if (ring->cq_ring_size > ring->sq_ring_size)
+        {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = 0;
+    }
+
+    ring->sq_ring = map_ring(ring->fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->sq_ring;
+    if ((NULL != ring->sq_ring) && (0 != ring->cq_ring_size))
+    {
+        ring->cq_ring = map_ring(ring->fd, ring->cq_ring_size, IORING_OFF_CQ_RING);
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = map_ring(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+
+    ring->results = malloc(ring->entries * sizeof(struct statx));
+    ring->slot_requests = (StatRequest**) malloc(ring->entries * sizeof(StatRequest*));
+    ring->free_slots = (unsigned int*) malloc(ring->entries * sizeof(unsigned int));
+    if ((NULL == ring->sq_ring) || (NULL == ring->cq_ring) || (NULL == ring->sqes)
+            || (NULL == ring->results) || (NULL == ring->slot_requests)
+            || (NULL == ring->free_slots))
+    {
+        stat_ring_free(ring);
+        return ENOMEM;
+    }
+
+    ring->sq_head = (unsigned int*) ((char*) ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned int*) ((char*) ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned int*) ((char*) ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int*) ((char*) ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned int*) ((char*) ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned int*) ((char*) ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned int*) ((char*) ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (char*) ring->cq_ring + params.cq_off.cqes;
+
+    for (i = 0; i < ring->entries; ++i)
+    {
+        ring->free_slots[i] = i;
+    }
+    ring->free_count = ring->entries;
+
+    return 0;
+}
+
+int stat_ring_run(StatRing* ring, const int dir_fd, StatRequest* requests,
+        const size_t count, const int fields)
+{
+    const unsigned int mask = get_statx_mask(fields);
+    const struct io_uring_cqe* cqes = (const struct io_uring_cqe*) ring->cqes;
+    size_t next = 0;
+    size_t i = 0;
+
+    if (ring->broken)
+    {
+        return EIO;
+    }
+    for (i = 0; i < count; ++i)
+    {
+        requests[i].error = EINPROGRESS;
+    }
+
+    while ((next < count) || (ring->free_count < ring->entries))
+    {
+        unsigned int head = 0;
+        unsigned int tail = 0;
+        unsigned int to_submit = 0;
+        long result = 0;
+
+        /* refill the free slots */
+        while ((next < count) && (ring->free_count > 0))
+        {
+            submit_statx(ring, dir_fd, &requests[next], mask);
+            ++next;
+        }
+
+        to_submit = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        result = syscall(__NR_io_uring_enter, ring->fd, to_submit, 1, IORING_ENTER_GETEVENTS,
+                NULL, 0);
+        if ((result < 0) && (EINTR != errno) && (EAGAIN != errno) && (EBUSY != errno))
+        {
+            /* requests in flight may still write to the results, they are kept until freed */
+            ring->broken = 1;
+            return errno;
+        }
+
+        /* handle the completions as they arrive */
+        head = *ring->cq_head;
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            complete(ring, &cqes[head & *ring->cq_mask]);
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return 0;
+}
+
+void stat_ring_free(StatRing* ring)
+{
+    if (NULL != ring->sqes)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if ((NULL != ring->cq_ring) && (ring->cq_ring != ring->sq_ring))
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (NULL != ring->sq_ring)
+    {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0)
+    {
+        close(ring->fd);
+    }
+    if (!ring->broken)
+    {
+        /* a broken ring may still have requests writing to the results */
+        free(ring->results);
+    }
+    free(ring->slot_requests);
+    free(ring->free_slots);
+    memset(ring, 0, sizeof(StatRing));
+    ring->fd = -1;
+}
+
+/**
+ *
+ * \brief Maps a part of the ring into memory.
+ *
+ * \param fd file descriptor of the ring.
+ * \param size size of the part.
+ * \param offset IORING_OFF_* of the part.
+ *
+ * \return the mapping, NULL on failure.
+ */
+static void* map_ring(const int fd, const size_t size, const off_t offset)
+{
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+            offset);
+
+    return (MAP_FAILED == mapping) ? NULL : mapping;
+}
+
+/**
+ *
+ * \brief Queues the statx of a request in a free slot.
+ *
+ * \param ring the ring, has a free slot.
+ * \param dir_fd file descriptor of the directory.
+ * \param request the request.
+ * \param mask statx mask.
+ *
+ * \return void
+ */
+static void submit_statx(StatRing* ring, const int dir_fd, StatRequest* request,
+        const unsigned int mask)
+{
+    const unsigned int slot = ring->free_slots[--ring->free_count];
+    const unsigned int tail = *ring->sq_tail;
+    const unsigned int index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &((struct io_uring_sqe*) ring->sqes)[index];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = dir_fd;
+    sqe->addr = (uint64_t) (uintptr_t) request->name;
+    sqe->len = mask;
+    sqe->off = (uint64_t) (uintptr_t) &((struct statx*) ring->results)[slot];
+    sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+    sqe->user_data = slot;
+
+    ring->slot_requests[slot] = request;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ *
+ * \brief Hands the result of a completion to its request and frees the slot.
+ *
+ * \param ring the ring.
+ * \param cqe the completion.
+ *
+ * \return void
+ */
+static void complete(StatRing* ring, const struct io_uring_cqe* cqe)
+{
+    const unsigned int slot = (unsigned int) cqe->user_data;
+    StatRequest* request = ring->slot_requests[slot];
+
+    if (cqe->res < 0)
+    {
+        request->error = -cqe->res;
+    }
+    else
+    {
+        statx_to_stat(&((const struct statx*) ring->results)[slot], request->info);
+        request->error = 0;
+    }
+    ring->free_slots[ring->free_count++] = slot;
+}
+
+/**
+ *
+ * \brief Converts the result of statx() to the struct stat the predicates work with.
+ *
+ * \param source result of statx().
+ * \param dest receives the file information.
+ *
+ * \return void
+ */
+static void statx_to_stat(const struct statx* source, struct stat* dest)
+{
+    memset(dest, 0, sizeof(struct stat));
+    dest->st_dev = makedev(source->stx_dev_major, source->stx_dev_minor);
+    dest->st_ino = (ino_t) source->stx_ino;
+    dest->st_mode = (mode_t) source->stx_mode;
+    dest->st_nlink = (nlink_t) source->stx_nlink;
+    dest->st_uid = (uid_t) source->stx_uid;
+    dest->st_gid = (gid_t) source->stx_gid;
+    dest->st_rdev = makedev(source->stx_rdev_major, source->stx_rdev_minor);
+    dest->st_size = (off_t) source->stx_size;
+    dest->st_blksize = (blksize_t) source->stx_blksize;
+    dest->st_blocks = (blkcnt_t) source->stx_blocks;
+    dest->st_atim.tv_sec = (time_t) source->stx_atime.tv_sec;
+    dest->st_atim.tv_nsec = (long) source->stx_atime.tv_nsec;
+    dest->st_mtim.tv_sec = (time_t) source->stx_mtime.tv_sec;
+    dest->st_mtim.tv_nsec = (long) source->stx_mtime.tv_nsec;
+    dest->st_ctim.tv_sec = (time_t) source->stx_ctime.tv_sec;
+    dest->st_ctim.tv_nsec = (long) source->stx_ctime.tv_nsec;
+}
+
+/**
+ *
+ * \brief Translates the fields needed into a statx mask.
+ *
+ * \param fields StatFields.
+ *
+ * \return the statx mask.
+ */
+static unsigned int get_statx_mask(const int fields)
+{
+    unsigned int mask = STATX_TYPE;
+
+    if (0 != (fields & STAT_FIELDS_OWNER))
+    {
+        mask |= STATX_UID;
+    }
+    if (0 != (fields & STAT_FIELDS_ALL))
+    {
+        mask |= STATX_BASIC_STATS;
+    }
+
+    return mask;
+}
+
+#else /* HAVE_IO_URING */
+
+int stat_ring_init(StatRing* ring, __attribute__((unused)) const unsigned int entries)
+{
+    memset(ring, 0, sizeof(StatRing));
+    ring->fd = -1;
+    return ENOSYS;
+}
+
+int stat_ring_run(__attribute__((unused)) StatRing* ring, __attribute__((unused)) const int dir_fd,
+        __attribute__((unused)) StatRequest* requests, __attribute__((unused)) const size_t count,
+        __attribute__((unused)) const int fields)
+{
+    return ENOSYS;
+}
+
+void stat_ring_free(StatRing* ring)
+{
+    ring->fd = -1;
+}
+
+#endif /* HAVE_IO_URING */
+
+/*
+ * =================================================================== eof ==
+ */
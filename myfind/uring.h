@@ -0,0 +1,148 @@
+/**
+ * @file uring.h
+ * \brief Batched stat with io_uring for myfind.
+ *
+ * @author agent <agent@local>
+ * @date 2026/10/17
+ */
+
+#ifndef _URING_H_
+#define _URING_H_
+
+/*
+ * -------------------------------------------------------------- includes --
+ */
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*
+ * -------------------------------------------------------------- typedefs --
+ */
+
+/**
+ * Fields a stat request has to fill in, the kernel may skip the others.
+ */
+typedef enum statFieldsEnum
+{
+    /** File type of st_mode. */
+    STAT_FIELDS_TYPE = 1,
+    /** st_uid. */
+    STAT_FIELDS_OWNER = 2,
+    /** Everything of struct stat. */
+    STAT_FIELDS_ALL = 4
+} StatFields;
+
+/**
+ * One entry of a directory to be stat'ed.
+ */
+typedef struct statRequestStruct
+{
+    /** Name of the entry relative to the directory. */
+    const char* name;
+    /** Receives the file information. */
+    struct stat* info;
+    /** 0 if info is valid, else errno; EINPROGRESS if the request was not completed. */
+    int error;
+} StatRequest;
+
+/**
+ * io_uring instance of one thread, submitting IORING_OP_STATX requests.
+ */
+typedef struct statRingStruct
+{
+    /** File descriptor of the ring, -1 if not set up. */
+    int fd;
+    /** The ring failed, it must not be used any more. */
+    int broken;
+    /** Number of submission queue entries. */
+    unsigned int entries;
+    /** Mapping of the submission queue ring. */
+    void* sq_ring;
+    /** Size of sq_ring. */
+    size_t sq_ring_size;
+    /** Mapping of the completion queue ring, may be the same as sq_ring. */
+    void* cq_ring;
+    /** Size of cq_ring. */
+    size_t cq_ring_size;
+    /** Mapping of the submission queue entries. */
+    void* sqes;
+    /** Size of sqes. */
+    size_t sqes_size;
+    /** Head of the submission queue, written by the kernel. */
+    unsigned int* sq_head;
+    /** Tail of the submission queue, written by us. */
+    unsigned int* sq_tail;
+    /** Mask of the submission queue indexes. */
+    unsigned int* sq_mask;
+    /** Indirection array of the submission queue. */
+    unsigned int* sq_array;
+    /** Head of the completion queue, written by us. */
+    unsigned int* cq_head;
+    /** Tail of the completion queue. */
+    unsigned int* cq_tail;
+    /** Mask of the completion queue indexes. */
+    unsigned int* cq_mask;
+    /** Completion queue entries. */
+    void* cqes;
+    /** Result buffers of the requests in flight, one per slot. */
+    void* results;
+    /** Request of every slot. */
+    StatRequest** slot_requests;
+    /** Free slots. */
+    unsigned int* free_slots;
+    /** Number of free slots. */
+    unsigned int free_count;
+} StatRing;
+
+/*
+ * ------------------------------------------------------------- functions --
+ */
+
+/**
+ *
+ * \brief Sets up an io_uring for stat requests.
+ *
+ * \param ring to be set up.
+ * \param entries number of requests in flight at most.
+ *
+ * \return 0 on success, else errno (ENOSYS if the kernel has no io_uring, EPERM if it is
+ *         disabled, ENOMEM); the ring must then not be used.
+ */
+extern int stat_ring_init(StatRing* ring, const unsigned int entries);
+
+/**
+ *
+ * \brief Stats entries of a directory with IORING_OP_STATX.
+ *
+ * The requests are submitted in order, as many at a time as the ring holds, and refilled as
+ * the completions arrive.
+ *
+ * \param ring set up by stat_ring_init().
+ * \param dir_fd file descriptor of the directory.
+ * \param requests the entries, error receives the result of each.
+ * \param count number of requests.
+ * \param fields StatFields the caller needs.
+ *
+ * \return 0 on success, else errno of the ring; requests left with error EINPROGRESS were not
+ *         completed and the ring is unusable.
+ */
+extern int stat_ring_run(StatRing* ring, const int dir_fd, StatRequest* requests,
+        const size_t count, const int fields);
+
+/**
+ *
+ * \brief Tears down an io_uring.
+ *
+ * \param ring to be freed, may have failed to set up.
+ *
+ * \return void
+ */
+extern void stat_ring_free(StatRing* ring);
+
+#endif /* _URING_H_ */
+
+/*
+ * =================================================================== eof ==
+ */